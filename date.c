@@ -10,14 +10,40 @@
  */
 
 #include "date.h"
+#include "lex.h"
+
+
+int date_read(char **in, Date *date) {
+
+    if (!lex_int(in, &date->dd)) return 0;
+    if (!lex_char(in, '-') || !lex_int(in, &date->mm)) return 1;
+    if (!lex_char(in, '-') || !lex_int(in, &date->yy)) return 2;
+    return 3;
+}
+
+
+int date_key(Date date) {
+
+    return date.yy * 10000 + date.mm * 100 + date.dd;
+}
+
+
+Date date_unkey(int key) {
+    Date date;
+
+    date.yy = key / 10000;
+    date.mm = key / 100 % 100;
+    date.dd = key % 100;
+    return date;
+}
 
 
 int compare_dates(Date date_1, Date date_2) {
     int date1, date2;
 
     // Convert both dates to a comparable integer format (yyyyMMdd)
-    date1 = date_1.yy * 10000 + date_1.mm * 100 + date_1.dd;
-    date2 = date_2.yy * 10000 + date_2.mm * 100 + date_2.dd;
+    date1 = date_key(date_1);
+    date2 = date_key(date_2);
 
     // Compare the integer representations
     if (date1 > date2) return -1;
@@ -27,7 +53,7 @@ int compare_dates(Date date_1, Date date_2) {
     return 0;
 }
 
-int is_date_valid(Date current_date, Date date, int is_before) {
+int is_day_valid(Date date) {
     int dia_lim;
 
     if (!(1 <= date.mm && date.mm <= 12)) return 0;
@@ -41,7 +67,12 @@ int is_date_valid(Date current_date, Date date, int is_before) {
 
     else dia_lim = 30;
 
-    if (!(1 <= date.dd && date.dd <= dia_lim)) return 0;
+    return 1 <= date.dd && date.dd <= dia_lim;
+}
+
+int is_date_valid(Date current_date, Date date, int is_before) {
+
+    if (!is_day_valid(date)) return 0;
 
     // Check if the date is valid - before or after the current date
     if (is_before && compare_dates(date, current_date) == -1) return 0;
@@ -27,6 +27,37 @@ typedef struct {
 } Date;
 
 
+/**
+ * @brief Reads a date written as dd-mm-yy, like `%d-%d-%d`.
+ * 
+ * @param in    Read position, advanced past what was read.
+ * @param date  Where to store the date fields.
+ * 
+ * @return Number of fields read (0 to 3).
+ */
+int date_read(char **in, Date *date);
+
+
+/**
+ * @brief Packs a date into an integer that orders like the date (yyyymmdd).
+ * 
+ * @param date  The date to pack.
+ * 
+ * @return The packed date.
+ */
+int date_key(Date date);
+
+
+/**
+ * @brief Unpacks a date packed by `date_key`.
+ * 
+ * @param key   The packed date.
+ * 
+ * @return The date.
+ */
+Date date_unkey(int key);
+
+
 /**
  * @brief Compares two dates.
  * 
@@ -39,6 +70,16 @@ typedef struct {
 int compare_dates(Date date_1, Date date_2);
 
 
+/**
+ * @brief Checks if a date exists in the calendar.
+ * 
+ * @param date  The date to check.
+ * 
+ * @return 1 if the date is valid, 0 if invalid.
+ */
+int is_day_valid(Date date);
+
+
 /**
  * @brief Validates if a given date is valid based on the current date and 
  *          calendar rules.
@@ -16,6 +16,28 @@
 #ifndef _ERRORS_H_
 #define _ERRORS_H_
 
+/**
+ * @brief Status codes returned instead of printing the messages below; each 
+ * error matches the message of the same name.
+ */
+typedef enum {
+    VMS_OK = 0,         /**< success    */
+    VMS_ENOMEMORY,      /**< memory exausted    */
+    VMS_E2MANYVAC,      /**< too many vaccines  */
+    VMS_EDUPBATCH,      /**< duplicate batch    */
+    VMS_EINVBATCH,      /**< invalid batch  */
+    VMS_EINVNAME,       /**< invalid name   */
+    VMS_EINVDATE,       /**< invalid date   */
+    VMS_EINVQUANT,      /**< invalid quantity   */
+    VMS_ENOVACINE,      /**< inexisting vaccine */
+    VMS_ENOSTOCK,       /**< no stock   */
+    VMS_EDOUBLEVAC,     /**< already vaccinated */
+    VMS_ENOBATCH,       /**< inexisting batch   */
+    VMS_EINVUSER,       /**< inexisting user    */
+    VMS_EFILE,          /**< file not read or written   */
+    VMS_EINVCURSOR      /**< invalid cursor */
+} VmsStatus;
+
 /** Error messages in English **/
 #define ENOMEMORY_EN    "No memory."        /**< memory exausted    */
 #define E2MANYVAC_EN    "too many vaccines"     /**< too many vaccines  */
@@ -29,6 +51,8 @@
 #define EDOUBLEVAC_EN   "already vaccinated"        /**< already vaccinated */
 #define ENOBATCH_EN     ": no such batch"       /**< inexisting batch   */
 #define EINVUSER_EN     ": no such user"        /**< inexisting user    */
+#define EFILE_EN        ": cannot access file"      /**< file not accessed  */
+#define EINVCURSOR_EN   "invalid cursor"        /**< invalid cursor */
 
 /** Error messages in Portuguese **/
 #define ENOMEMORY_PT    "sem memória."      /**< memory exausted    */
@@ -43,5 +67,7 @@
 #define EDOUBLEVAC_PT   "já vacinado"       /**< already vaccinated */
 #define ENOBATCH_PT     ": lote inexistente"        /**< inexisting batch   */
 #define EINVUSER_PT     ": utente inexistente"      /**< inexisting user    */
+#define EFILE_PT        ": ficheiro inacessível"    /**< file not accessed  */
+#define EINVCURSOR_PT   "cursor inválido"       /**< invalid cursor */
 
 #endif
\ No newline at end of file
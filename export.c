@@ -0,0 +1,348 @@
+/**
+ * @file export.c
+ * @brief Export of the batches and inoculations to CSV or to a columnar
+ *          binary format.
+ *
+ * Columnar row groups are encoded into one buffer and written with a single
+ * `fwrite`, so the file grows in large sequential writes.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "export.h"
+#include "par.h"
+
+
+/**
+ * @struct ExpCol
+ * @brief A column of an exported table.
+ */
+typedef struct {
+    char type;      /**< `EXPORT_STR`, `EXPORT_DATE` or `EXPORT_INT`    */
+    const char *name;       /**< Column name    */
+} ExpCol;
+
+
+/**
+ * @struct ExpBuf
+ * @brief Growable buffer holding a row group.
+ */
+typedef struct {
+    unsigned char *buf;     /**< Encoded bytes  */
+    size_t len, cap;        /**< Bytes used and allocated   */
+    int err;        /**< 1 once memory ran out  */
+} ExpBuf;
+
+
+/** Columns of the batches table */
+static const ExpCol BATCHCOLS[] = {
+    {EXPORT_STR, "batch"}, {EXPORT_STR, "vaccine"}, {EXPORT_DATE, "date"},
+    {EXPORT_INT, "avdoses"}, {EXPORT_INT, "apdoses"}
+};
+
+/** Columns of the inoculations table */
+static const ExpCol INOCCOLS[] = {
+    {EXPORT_STR, "user"}, {EXPORT_STR, "batch"}, {EXPORT_STR, "vaccine"},
+    {EXPORT_DATE, "date"}
+};
+
+
+/**
+ * @brief Appends bytes to a buffer, growing it as needed.
+ */
+static void buf_put(ExpBuf *b, const void *src, size_t n) {
+    unsigned char *buf;
+    size_t cap;
+
+    if (b->err) return;
+    if (b->len + n > b->cap) {
+        cap = 2 * b->cap > b->len + n ? 2 * b->cap : b->len + n + EXPBUFMEM;
+        if (!(buf = (unsigned char *) realloc(b->buf, cap))) {
+            b->err = 1;
+            return;
+        }
+        b->buf = buf;
+        b->cap = cap;
+    }
+    memcpy(b->buf + b->len, src, n);
+    b->len += n;
+}
+
+
+/**
+ * @brief Appends a little-endian u32 to a buffer.
+ */
+static void buf_u32(ExpBuf *b, uint32_t v) {
+    unsigned char le[4];
+
+    le[0] = (unsigned char) v;
+    le[1] = (unsigned char) (v >> 8);
+    le[2] = (unsigned char) (v >> 16);
+    le[3] = (unsigned char) (v >> 24);
+    buf_put(b, le, 4);
+}
+
+
+/**
+ * @brief Writes out a buffer and empties it.
+ *
+ * @return VMS_OK, VMS_EFILE or VMS_ENOMEMORY.
+ */
+static int buf_flush(ExpBuf *b, FILE *out) {
+
+    if (b->err) return VMS_ENOMEMORY;
+    if (b->len && fwrite(b->buf, 1, b->len, out) != b->len) return VMS_EFILE;
+    b->len = 0;
+    return VMS_OK;
+}
+
+
+/**
+ * @brief Appends a string column of a row group: the end offset of each
+ *          string, then their bytes.
+ */
+static void put_strs(ExpBuf *b, const char **strs, long n) {
+    uint32_t end = 0;
+    long i;
+
+    for (i = 0; i < n; i++) buf_u32(b, end += strlen(strs[i]));
+    for (i = 0; i < n; i++) buf_put(b, strs[i], strlen(strs[i]));
+}
+
+
+/**
+ * @brief Appends a date or integer column of a row group.
+ */
+static void put_ints(ExpBuf *b, const int *vals, long n) {
+    long i;
+
+    for (i = 0; i < n; i++) buf_u32(b, (uint32_t) vals[i]);
+}
+
+
+/**
+ * @brief Starts a table: the CSV header line, or the columnar header.
+ */
+static void put_header(ExpBuf *b, const ExpCol *cols, int ncol,
+                        int columns) {
+    unsigned char head[2];
+    int c;
+
+    if (columns) {
+        buf_put(b, "VMSC", 4);
+        head[0] = 1;
+        head[1] = (unsigned char) ncol;
+        buf_put(b, head, 2);
+    }
+
+    for (c = 0; c < ncol; c++) {
+        if (columns) {
+            head[0] = (unsigned char) cols[c].type;
+            head[1] = (unsigned char) strlen(cols[c].name);
+            buf_put(b, head, 2);
+        }
+        buf_put(b, cols[c].name, strlen(cols[c].name));
+        if (!columns) buf_put(b, c + 1 < ncol ? "," : "\n", 1);
+    }
+}
+
+
+/**
+ * @brief Writes a character of a CSV line, if it fits.
+ *
+ * @return Length of the line so far.
+ */
+static size_t csv_char(char *dst, size_t room, size_t at, char c) {
+
+    if (at < room) dst[at] = c;
+    return at + 1;
+}
+
+
+/**
+ * @brief Writes a CSV field and the character after it, quoting the field
+ *          if it holds commas, quotes or line breaks.
+ *
+ * @return Length of the line so far.
+ */
+static size_t csv_field(char *dst, size_t room, size_t at, const char *s,
+                        char end) {
+    int quote = s[strcspn(s, ",\"\r\n")] != '\0';
+
+    if (quote) at = csv_char(dst, room, at, '"');
+    for (; *s; s++) {
+        if (*s == '"') at = csv_char(dst, room, at, '"');
+        at = csv_char(dst, room, at, *s);
+    }
+    if (quote) at = csv_char(dst, room, at, '"');
+    return csv_char(dst, room, at, end);
+}
+
+
+/**
+ * @brief Writes formatted CSV fields, like `snprintf`.
+ *
+ * @return Length of the line so far.
+ */
+static size_t csv_printf(char *dst, size_t room, size_t at, const char *fmt,
+                        ...) {
+    va_list args;
+    int n;
+
+    va_start(args, fmt);
+    n = vsnprintf(at < room ? dst + at : NULL, at < room ? room - at : 0,
+                fmt, args);
+    va_end(args);
+    return at + n;
+}
+
+
+/**
+ * @brief Formats one inoculation as a CSV line (`FormatFn`).
+ */
+static int format_csv_inoc(char *dst, size_t room, void *inocs, long i) {
+    Inoc *inoc = &((Inoc *) inocs)[i];
+    size_t at;
+
+    at = csv_field(dst, room, 0, inoc->user, ',');
+    at = csv_field(dst, room, at, inoc->vaccine->batch, ',');
+    at = csv_field(dst, room, at, inoc->vaccine->name, ',');
+    return (int) csv_printf(dst, room, at, "%d-%02d-%02d\n", inoc->apdate.yy,
+                            inoc->apdate.mm, inoc->apdate.dd);
+}
+
+
+/**
+ * @brief Formats one batch as a CSV line (`FormatFn`).
+ */
+static int format_csv_vac(char *dst, size_t room, void *batches, long i) {
+    Vaccine *vac = ((Vaccine **) batches)[i];
+    size_t at;
+
+    at = csv_field(dst, room, 0, vac->batch, ',');
+    at = csv_field(dst, room, at, vac->name, ',');
+    return (int) csv_printf(dst, room, at, "%d-%02d-%02d,%d,%d\n",
+                            vac->expdate.yy, vac->expdate.mm,
+                            vac->expdate.dd, vac->avdoses, vac->apdoses);
+}
+
+
+int export_batches(FILE *out, Vaccine **batches, int nb, int columns) {
+    const char **strs = (const char **) calloc(nb ? nb : 1, sizeof(char *));
+    int *ints = (int *) calloc(nb ? nb : 1, sizeof(int)), i;
+    ExpBuf b = {NULL, 0, 0, 0};
+    int status;
+
+    put_header(&b, BATCHCOLS, 5, columns);
+    if (!strs || !ints) b.err = 1;
+
+    // There are few batches: a single row group holds them all
+    if (columns && nb && !b.err) {
+        buf_u32(&b, nb);
+        for (i = 0; i < nb; i++) strs[i] = batches[i]->batch;
+        put_strs(&b, strs, nb);
+        for (i = 0; i < nb; i++) strs[i] = batches[i]->name;
+        put_strs(&b, strs, nb);
+        for (i = 0; i < nb; i++) ints[i] = date_key(batches[i]->expdate);
+        put_ints(&b, ints, nb);
+        for (i = 0; i < nb; i++) ints[i] = batches[i]->avdoses;
+        put_ints(&b, ints, nb);
+        for (i = 0; i < nb; i++) ints[i] = batches[i]->apdoses;
+        put_ints(&b, ints, nb);
+    }
+    if (columns) buf_u32(&b, 0);
+
+    status = buf_flush(&b, out);
+    if (!status && !columns &&
+        par_fprint(out, nb, format_csv_vac, batches)) status = VMS_ENOMEMORY;
+    if (!status && ferror(out)) status = VMS_EFILE;
+
+    free(b.buf);
+    free(strs);
+    free(ints);
+    return status;
+}
+
+
+/**
+ * @brief Appends a row group of inoculations.
+ */
+static void group_inocs(ExpBuf *b, const Inoc *rows, long n,
+                        const char **strs, int *ints) {
+    long i;
+
+    buf_u32(b, n);
+    for (i = 0; i < n; i++) strs[i] = rows[i].user;
+    put_strs(b, strs, n);
+    for (i = 0; i < n; i++) strs[i] = rows[i].vaccine->batch;
+    put_strs(b, strs, n);
+    for (i = 0; i < n; i++) strs[i] = rows[i].vaccine->name;
+    put_strs(b, strs, n);
+    for (i = 0; i < n; i++) ints[i] = date_key(rows[i].apdate);
+    put_ints(b, ints, n);
+}
+
+
+int export_inocs(FILE *out, Shard *shards, int nshards, int columns,
+                long *n) {
+    InocIter its[MAXSHARDS];
+    Inoc *chunk = (Inoc *) malloc(EXPCHUNK * sizeof(Inoc));
+    const char **strs = (const char **) malloc(EXPCHUNK * sizeof(char *));
+    int *ints = (int *) malloc(EXPCHUNK * sizeof(int));
+    ExpBuf b = {NULL, 0, 0, 0};
+    int s, min, started, status = VMS_OK;
+    Shard *shard;
+    long k = EXPCHUNK;
+
+    *n = 0;
+    if (!chunk || !strs || !ints) status = VMS_ENOMEMORY;
+    for (started = 0; !status && started < nshards; started++) {
+        shard = &shards[started];
+        if (iter_ini(&its[started], shard->cold, shard->inocs,
+                    shard->cols.user, 0, shard->ni, -1, 0, 0, INT_MAX)) {
+            status = VMS_ENOMEMORY;
+            break;
+        }
+    }
+
+    put_header(&b, INOCCOLS, 4, columns);
+    if (!status) status = buf_flush(&b, out);
+
+    // Each chunk is merged from the shards in order of application, then
+    // written
+    while (!status && k == EXPCHUNK) {
+        for (k = 0; k < EXPCHUNK; k++) {
+            for (s = 0, min = -1; s < nshards; s++)
+                if (its[s].at &&
+                    (min == -1 || inoc_before(its[s].at, its[min].at)))
+                    min = s;
+            if (min == -1) break;
+
+            chunk[k] = *its[min].at;
+            iter_next(&its[min]);
+        }
+        *n += k;
+
+        if (columns && k) group_inocs(&b, chunk, k, strs, ints);
+        if (columns && k < EXPCHUNK) buf_u32(&b, 0);
+        if (columns) status = buf_flush(&b, out);
+        else if (par_fprint(out, k, format_csv_inoc, chunk))
+            status = VMS_ENOMEMORY;
+        if (!status && ferror(out)) status = VMS_EFILE;
+    }
+
+    for (s = 0; s < started; s++) iter_free(&its[s]);
+    free(b.buf);
+    free(chunk);
+    free(strs);
+    free(ints);
+    return status;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file export.h
+ * @brief Export of the batches and inoculations to CSV or to a columnar
+ *          binary format.
+ *
+ * The batches and the inoculations go to separate files, one table each:
+ * - batches: batch, vaccine, date (expiration), avdoses, apdoses;
+ * - inoculations: user, batch, vaccine, date (application), in order of
+ *   application.
+ *
+ * Inoculations are read a chunk at a time, so memory stays the same however
+ * many there are. CSV chunks are formatted in parallel (par.h) and every
+ * file is written through a large buffer.
+ *
+ * CSV files start with a header line; fields with commas, quotes or line
+ * breaks are quoted, with quotes doubled, and dates are YYYY-MM-DD.
+ *
+ * Columnar files are little-endian:
+ * - header: "VMSC", u8 version (1), u8 number of columns, then for each
+ *   column u8 type (`EXPORT_STR`, `EXPORT_DATE` or `EXPORT_INT`), u8 name
+ *   length and the name's bytes;
+ * - row groups of up to EXPCHUNK rows, each a u32 number of rows followed
+ *   by each column in turn, ending with a group of 0 rows.
+ *
+ * In a row group a string column is a u32 end offset per row followed by
+ * the strings' bytes; a date column is an i32 `date_key` (yyyymmdd) per row
+ * and an integer column an i32 per row.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _EXPORT_H_
+#define _EXPORT_H_
+
+#include <stdio.h>
+
+#include "shard.h"
+#include "vaccine.h"
+
+#define EXPCHUNK        (1 << 16)       /**< Rows per chunk and row group */
+#define EXPBUFMEM       (1 << 20)       /**< Write buffer of a file */
+
+#define EXPORT_STR      's'     /**< string column  */
+#define EXPORT_DATE     'd'     /**< date column    */
+#define EXPORT_INT      'i'     /**< integer column */
+
+
+/**
+ * @brief Writes the batches to a file, as one table.
+ *
+ * @param out       The file.
+ * @param batches   The batches.
+ * @param nb        Number of batches.
+ * @param columns   1 for the columnar format, 0 for CSV.
+ *
+ * @return VMS_OK, VMS_EFILE if the file could not be written or
+ *          VMS_ENOMEMORY.
+ */
+int export_batches(FILE *out, Vaccine **batches, int nb, int columns);
+
+
+/**
+ * @brief Writes the inoculations of every shard to a file, as one table, in
+ *          order of application.
+ *
+ * @param out       The file.
+ * @param shards    The shards.
+ * @param nshards   Number of shards.
+ * @param columns   1 for the columnar format, 0 for CSV.
+ * @param n         Where to store the number of inoculations written.
+ *
+ * @return VMS_OK, VMS_EFILE if the file could not be written or
+ *          VMS_ENOMEMORY.
+ */
+int export_inocs(FILE *out, Shard *shards, int nshards, int columns,
+                long *n);
+
+#endif
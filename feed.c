@@ -0,0 +1,311 @@
+/**
+ * @file feed.c
+ * @brief Change feed in a shared-memory ring.
+ *
+ * The producer keeps its own copy of the head and of the limit up to which
+ * it may write, so writing an event is a copy and one release store; the
+ * consumers' acknowledgements are only read when the limit is reached,
+ * about once per ring.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "feed.h"
+
+/** Bytes of an event, padded to 8 */
+#define FEEDALIGN(n)        (((n) + 7) & ~(size_t) 7)
+
+
+/**
+ * @brief Name of the shared memory object, with a leading "/".
+ *
+ * @return The name (to be freed by the caller), or NULL if out of memory.
+ */
+static char *feed_name(const char *name) {
+    char *full = (char *) malloc(strlen(name) + 2);
+
+    if (full) sprintf(full, "%s%s", *name == '/' ? "" : "/", name);
+    return full;
+}
+
+
+/**
+ * @brief Maps a shared memory object.
+ *
+ * @return The mapping, or NULL if it failed.
+ */
+static FeedRing *feed_map(int fd) {
+    void *ring = mmap(NULL, sizeof(FeedRing) + FEEDMEM, PROT_READ |
+                    PROT_WRITE, MAP_SHARED, fd, 0);
+
+    close(fd);
+    return ring == MAP_FAILED ? NULL : (FeedRing *) ring;
+}
+
+
+Feed feed_ini(void) {
+    Feed feed;
+
+    feed.ring = NULL;
+    feed.name = NULL;
+    feed.head = feed.limit = feed.id = 0;
+    return feed;
+}
+
+
+int feed_open(Feed *feed, const char *name) {
+    char *full = feed_name(name);
+    int fd, r;
+
+    if (!full) return -1;
+    fd = shm_open(full, O_CREAT | O_TRUNC | O_RDWR, 0600);
+    if (fd == -1 || ftruncate(fd, sizeof(FeedRing) + FEEDMEM) ||
+        !(feed->ring = feed_map(fd))) {
+        if (fd != -1) shm_unlink(full);
+        free(full);
+        return -1;
+    }
+
+    // A new object is zeroed: the slots are free and the head is 0
+    feed->ring->magic = FEEDMAGIC;
+    feed->ring->version = FEEDVERSION;
+    feed->ring->cap = FEEDMEM;
+    atomic_init(&feed->ring->head, 0);
+    for (r = 0; r < FEEDREADERS; r++) {
+        atomic_init(&feed->ring->reader[r].state, FEED_FREE);
+        atomic_init(&feed->ring->reader[r].ack, 0);
+    }
+
+    feed->name = full;
+    feed->head = feed->id = 0;
+    feed->limit = FEEDMEM;
+    return 0;
+}
+
+
+void feed_close(Feed *feed) {
+
+    if (!feed->ring) return;
+    munmap(feed->ring, sizeof(FeedRing) + FEEDMEM);
+    shm_unlink(feed->name);
+    free(feed->name);
+    *feed = feed_ini();
+}
+
+
+/**
+ * @brief Moves the limit forward so that `len` more bytes can be written,
+ * dropping the consumers that are too far behind.
+ */
+static void feed_room(Feed *feed, uint64_t len) {
+    FeedRing *ring = feed->ring;
+    uint64_t end = feed->head + len, low = feed->head, ack;
+    unsigned state;
+    int r;
+
+    for (r = 0; r < FEEDREADERS; r++) {
+        if (atomic_load_explicit(&ring->reader[r].state,
+                                memory_order_acquire) != FEED_ACTIVE)
+            continue;
+        ack = atomic_load_explicit(&ring->reader[r].ack,
+                                memory_order_acquire);
+
+        // The producer never waits: a consumer a ring behind is dropped
+        if (ack + ring->cap < end) {
+            state = FEED_ACTIVE;
+            atomic_compare_exchange_strong(&ring->reader[r].state, &state,
+                                            FEED_LAGGED);
+            continue;
+        }
+        if (ack < low) low = ack;
+    }
+    feed->limit = low + ring->cap;
+}
+
+
+/**
+ * @brief Makes room for `len` bytes at the head.
+ *
+ * @return Where to write them.
+ */
+static unsigned char *feed_claim(Feed *feed, uint64_t len) {
+
+    if (feed->head + len > feed->limit) feed_room(feed, len);
+    return feed->ring->data + (feed->head & (feed->ring->cap - 1));
+}
+
+
+void feed_emit(Feed *feed, int type, Date date, int n1, int n2, int nstr,
+                ...) {
+    const char *str[FEEDMAXSTR];
+    size_t slen[FEEDMAXSTR], len = sizeof(FeedEvent), room;
+    FeedEvent ev, *pad;
+    unsigned char *at;
+    va_list args;
+    int i;
+
+    if (!feed->ring) return;
+
+    va_start(args, nstr);
+    for (i = 0; i < nstr && i < FEEDMAXSTR; i++) {
+        str[i] = va_arg(args, const char *);
+        len += slen[i] = strlen(str[i]) + 1;
+    }
+    va_end(args);
+    nstr = i;
+    len = FEEDALIGN(len);
+    if (len > FEEDMAXEVENT) return;
+
+    // Events do not wrap: the rest of the ring is skipped
+    room = feed->ring->cap - (feed->head & (feed->ring->cap - 1));
+    if (room < len) {
+        pad = (FeedEvent *) feed_claim(feed, room);
+        pad->len = (uint32_t) room;
+        pad->type = FEED_PAD;
+        feed->head += room;
+    }
+
+    ev.len = (uint32_t) len;
+    ev.type = (uint16_t) type;
+    ev.nstr = (uint16_t) nstr;
+    ev.id = ++feed->id;
+    ev.date = date.yy ? (uint32_t) date_key(date) : 0;
+    ev.n1 = n1;
+    ev.n2 = n2;
+    ev.zero = 0;
+
+    at = feed_claim(feed, len);
+    memcpy(at, &ev, sizeof(FeedEvent));
+    for (i = 0, at += sizeof(FeedEvent); i < nstr; at += slen[i++])
+        memcpy(at, str[i], slen[i]);
+
+    // Publish the event (and the padding before it, if any)
+    feed->head += len;
+    atomic_store_explicit(&feed->ring->head, feed->head,
+                        memory_order_release);
+}
+
+
+int feed_attach(FeedReader *reader, const char *name) {
+    char *full = feed_name(name);
+    FeedRing *ring = NULL;
+    unsigned state;
+    int fd, r;
+
+    if (full && (fd = shm_open(full, O_RDWR, 0)) != -1) ring = feed_map(fd);
+    free(full);
+    if (!ring) return -1;
+
+    reader->copy = (unsigned char *) malloc(FEEDMAXEVENT);
+    if (ring->magic != FEEDMAGIC || ring->version != FEEDVERSION ||
+        ring->cap != FEEDMEM || !reader->copy) {
+        munmap(ring, sizeof(FeedRing) + FEEDMEM);
+        free(reader->copy);
+        return -1;
+    }
+
+    // Claim a slot, then start from the head before the producer sees it
+    for (r = 0; r < FEEDREADERS; r++) {
+        state = FEED_FREE;
+        if (!atomic_compare_exchange_strong(&ring->reader[r].state, &state,
+                                            FEED_CLAIMED)) continue;
+
+        reader->ring = ring;
+        reader->slot = r;
+        reader->pos = reader->acked = atomic_load_explicit(&ring->head,
+                                                    memory_order_acquire);
+        atomic_store_explicit(&ring->reader[r].ack, reader->pos,
+                            memory_order_release);
+        atomic_store_explicit(&ring->reader[r].state, FEED_ACTIVE,
+                            memory_order_release);
+        return 0;
+    }
+
+    munmap(ring, sizeof(FeedRing) + FEEDMEM);
+    free(reader->copy);
+    return -1;
+}
+
+
+/**
+ * @brief Checks that the producer has not dropped the consumer.
+ */
+static int feed_active(FeedReader *reader) {
+
+    return atomic_load_explicit(&reader->ring->reader[reader->slot].state,
+                                memory_order_acquire) == FEED_ACTIVE;
+}
+
+
+/**
+ * @brief Decodes the event copied by `feed_next`.
+ */
+static void feed_decode(FeedReader *reader, FeedMsg *msg) {
+    FeedEvent *ev = (FeedEvent *) reader->copy;
+    const char *p = (const char *) (ev + 1);
+    int i;
+
+    msg->type = ev->type;
+    msg->id = ev->id;
+    msg->date = date_unkey((int) ev->date);
+    msg->n1 = ev->n1;
+    msg->n2 = ev->n2;
+    msg->nstr = ev->nstr < FEEDMAXSTR ? ev->nstr : FEEDMAXSTR;
+    for (i = 0; i < msg->nstr; p += strlen(p) + 1) msg->str[i++] = p;
+}
+
+
+int feed_next(FeedReader *reader, FeedMsg *msg) {
+    FeedRing *ring = reader->ring;
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    size_t at, len;
+
+    while (reader->pos < head) {
+        at = reader->pos & (ring->cap - 1);
+        len = ((FeedEvent *) (ring->data + at))->len;
+        if (len < 8 || len > FEEDMAXEVENT || len > ring->cap - at ||
+            len % 8) return feed_active(reader) ? 0 : -1;
+
+        // Copy first, then check that the event was not overwritten
+        memcpy(reader->copy, ring->data + at, len);
+        atomic_thread_fence(memory_order_acquire);
+        if (!feed_active(reader)) return -1;
+
+        reader->pos += len;
+        if (reader->pos - reader->acked >= FEEDACKSTEP) feed_ack(reader);
+        if (((FeedEvent *) reader->copy)->type == FEED_PAD) continue;
+
+        reader->copy[len - 1] = '\0';
+        feed_decode(reader, msg);
+        return 1;
+    }
+    return feed_active(reader) ? 0 : -1;
+}
+
+
+void feed_ack(FeedReader *reader) {
+
+    reader->acked = reader->pos;
+    atomic_store_explicit(&reader->ring->reader[reader->slot].ack,
+                        reader->pos, memory_order_release);
+}
+
+
+void feed_detach(FeedReader *reader) {
+
+    atomic_store_explicit(&reader->ring->reader[reader->slot].state,
+                        FEED_FREE, memory_order_release);
+    munmap(reader->ring, sizeof(FeedRing) + FEEDMEM);
+    free(reader->copy);
+    reader->ring = NULL;
+    reader->copy = NULL;
+}
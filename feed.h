@@ -0,0 +1,237 @@
+/**
+ * @file feed.h
+ * @brief Change feed: events of every change, in a shared-memory ring.
+ *
+ * Every successful change ('c', 'a', 'r', 'd' and a new date) is written
+ * as an event into a ring of bytes in POSIX shared memory, so consumers on
+ * the same machine can tail it by reading memory, without system calls.
+ *
+ * There is one producer (the system) and up to FEEDREADERS consumers, each
+ * with a slot in the ring's header. A consumer acknowledges the events it
+ * is done with by storing its position, in batches; the producer only
+ * reads the acknowledgements when it is about to overwrite old events, and
+ * never waits: a consumer more than a ring behind is marked as lagged and
+ * must attach again (and resynchronize, e.g. from an export).
+ *
+ * Integers are in host byte order. An event is a FeedEvent header followed
+ * by `nstr` NUL-terminated strings, padded to a multiple of 8 bytes; events
+ * never wrap around the end of the ring, which is skipped with `FEED_PAD`.
+ * Dates are `yyyymmdd` (see `date_key`), 0 when there is none.
+ *
+ * | Type           | Strings                  | date       | n1      | n2  |
+ * |----------------|--------------------------|------------|---------|-----|
+ * | `FEED_BATCH`   | batch, vaccine           | expiration | av.     | ap. |
+ * | `FEED_APPLY`   | user, batch, vaccine     | applied    | av.     | ap. |
+ * | `FEED_REMOVE`  | batch, vaccine           | expiration | ap.     | 1 if|
+ * |                |                          |            |         | gone|
+ * | `FEED_DELETE`  | user[, batch]            | filter or 0| removed |     |
+ * | `FEED_DATE`    |                          | new date   | expired |     |
+ *
+ * (av. and ap. are the batch's available and applied doses after the
+ * change.)
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _FEED_H_
+#define _FEED_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "pipeline.h"
+#include "date.h"
+
+#define FEEDMAGIC       0x46534D56u     /**< "VMSF", first bytes of a ring */
+#define FEEDVERSION     1       /**< Layout version */
+#define FEEDMEM         (1 << 22)       /**< Bytes of events (power of two) */
+#define FEEDMAXEVENT    (1 << 18)       /**< max. bytes of an event */
+#define FEEDACKSTEP     (FEEDMEM / 8)   /**< Bytes read between acks    */
+#define FEEDREADERS     16      /**< max. num. of consumers */
+#define FEEDMAXSTR      3       /**< max. num. of strings in an event   */
+
+#define FEED_PAD        0       /**< skip to the start of the ring  */
+#define FEED_BATCH      'c'     /**< batch added    */
+#define FEED_APPLY      'a'     /**< vaccine applied    */
+#define FEED_REMOVE     'r'     /**< batch disabled or removed  */
+#define FEED_DELETE     'd'     /**< inoculations deleted   */
+#define FEED_DATE       't'     /**< date moved forward */
+
+#define FEED_FREE       0       /**< slot not in use    */
+#define FEED_CLAIMED    1       /**< slot being attached    */
+#define FEED_ACTIVE     2       /**< consumer attached  */
+#define FEED_LAGGED     3       /**< consumer fell a ring behind    */
+
+
+/**
+ * @struct FeedEvent
+ * @brief Header of an event in the ring.
+ */
+typedef struct {
+    uint32_t len;       /**< Bytes of the event, padding included   */
+    uint16_t type;      /**< `FEED_BATCH`, `FEED_APPLY`, ...    */
+    uint16_t nstr;      /**< Strings after the header   */
+    uint64_t id;        /**< Event number, from 1   */
+    uint32_t date;      /**< Date of the event (`yyyymmdd`) */
+    int32_t n1, n2;     /**< Counts (see the table above)   */
+    uint32_t zero;      /**< Always 0   */
+} FeedEvent;
+
+
+/**
+ * @struct FeedSlot
+ * @brief A consumer's slot in the ring's header.
+ */
+typedef struct {
+    _Alignas(CACHELINE) atomic_uint state;      /**< `FEED_FREE`, ...   */
+    atomic_uint_least64_t ack;      /**< Position read up to    */
+} FeedSlot;
+
+
+/**
+ * @struct FeedRing
+ * @brief Layout of the shared memory: header, then the events.
+ *
+ * Positions count bytes written since the ring was created; an event at
+ * position p is at `data[p % cap]`.
+ */
+typedef struct {
+    uint32_t magic;     /**< FEEDMAGIC  */
+    uint32_t version;       /**< FEEDVERSION    */
+    uint64_t cap;       /**< Bytes of events (a power of two)   */
+    _Alignas(CACHELINE) atomic_uint_least64_t head;     /**< Bytes published */
+    FeedSlot reader[FEEDREADERS];       /**< Consumers  */
+    _Alignas(CACHELINE) unsigned char data[];       /**< The events */
+} FeedRing;
+
+
+/**
+ * @struct Feed
+ * @brief The producer's side of a ring.
+ */
+typedef struct {
+    FeedRing *ring;     /**< Mapped ring, NULL when there is no feed    */
+    char *name;     /**< Name of the shared memory object   */
+    uint64_t head;      /**< Bytes written  */
+    uint64_t limit;     /**< Bytes that can be written before the next check
+                            of the acknowledgements */
+    uint64_t id;        /**< Number of the last event   */
+} Feed;
+
+
+/**
+ * @struct FeedReader
+ * @brief A consumer's side of a ring.
+ */
+typedef struct {
+    FeedRing *ring;     /**< Mapped ring    */
+    int slot;       /**< Slot in the ring's header  */
+    uint64_t pos;       /**< Position of the next event */
+    uint64_t acked;     /**< Position last acknowledged */
+    unsigned char *copy;        /**< Private copy of the last event */
+} FeedReader;
+
+
+/**
+ * @struct FeedMsg
+ * @brief An event, as read by a consumer.
+ */
+typedef struct {
+    int type;       /**< `FEED_BATCH`, `FEED_APPLY`, ...    */
+    uint64_t id;        /**< Event number   */
+    Date date;      /**< Date of the event ({0, 0, 0} if none)  */
+    int n1, n2;     /**< Counts */
+    int nstr;       /**< Number of strings  */
+    const char *str[FEEDMAXSTR];        /**< Strings (valid until the next
+                                            event is read) */
+} FeedMsg;
+
+
+/**
+ * @brief Initializes a producer without a ring: events are ignored.
+ *
+ * @return Initialized Feed structure.
+ */
+Feed feed_ini(void);
+
+
+/**
+ * @brief Creates the ring as a shared memory object (replacing any old one
+ * with the same name).
+ *
+ * @param feed  Pointer to the producer.
+ * @param name  Name of the object ("/" is added in front if missing).
+ *
+ * @return 0 on success, -1 if it could not be created.
+ */
+int feed_open(Feed *feed, const char *name);
+
+
+/**
+ * @brief Unmaps and removes the ring; attached consumers keep their
+ * mapping but see no new events.
+ *
+ * @param feed  Pointer to the producer.
+ */
+void feed_close(Feed *feed);
+
+
+/**
+ * @brief Writes an event, overwriting events that every consumer is done
+ * with. Does nothing when there is no ring.
+ *
+ * @param feed  Pointer to the producer.
+ * @param type  Event type.
+ * @param date  Date of the event.
+ * @param n1    First count.
+ * @param n2    Second count.
+ * @param nstr  Number of strings that follow (at most FEEDMAXSTR).
+ */
+void feed_emit(Feed *feed, int type, Date date, int n1, int n2, int nstr,
+                ...);
+
+
+/**
+ * @brief Attaches a consumer to a ring, from the next event written.
+ *
+ * @param reader    Pointer to the consumer.
+ * @param name      Name of the ring.
+ *
+ * @return 0 on success, -1 if the ring could not be mapped, has another
+ *          layout or has no free slot.
+ */
+int feed_attach(FeedReader *reader, const char *name);
+
+
+/**
+ * @brief Reads the next event, without system calls. Positions are
+ * acknowledged every FEEDACKSTEP bytes.
+ *
+ * @param reader    Pointer to the consumer.
+ * @param msg       Where to store the event.
+ *
+ * @return 1 if an event was read, 0 if there is none yet, -1 if the
+ *          consumer lagged a ring behind (then it must attach again).
+ */
+int feed_next(FeedReader *reader, FeedMsg *msg);
+
+
+/**
+ * @brief Acknowledges every event read so far, letting the producer
+ * overwrite them.
+ *
+ * @param reader    Pointer to the consumer.
+ */
+void feed_ack(FeedReader *reader);
+
+
+/**
+ * @brief Detaches a consumer and frees its slot.
+ *
+ * @param reader    Pointer to the consumer.
+ */
+void feed_detach(FeedReader *reader);
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * @file heap.c
+ * @brief Indexed binary min-heap implementation.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include "heap.h"
+
+/** Position field of an item */
+#define POS(heap, item)     (*(int *) ((char *) (item) + (heap)->posoff))
+
+
+/**
+ * @brief Stores an item at a position and records the position in it.
+ */
+static void heap_set(Heap *heap, int i, void *item) {
+
+    heap->item[i] = item;
+    POS(heap, item) = i;
+}
+
+
+/**
+ * @brief Moves the item at position `i` up while it is smaller than its
+ *          parent.
+ */
+static void heap_up(Heap *heap, int i) {
+    void *item = heap->item[i];
+
+    while (i > 0 && heap->cmp(item, heap->item[(i - 1) / 2]) < 0) {
+        heap_set(heap, i, heap->item[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    heap_set(heap, i, item);
+}
+
+
+/**
+ * @brief Moves the item at position `i` down while a child is smaller.
+ */
+static void heap_down(Heap *heap, int i) {
+    void *item = heap->item[i];
+    int child;
+
+    while ((child = 2 * i + 1) < heap->n) {
+        if (child + 1 < heap->n &&
+            heap->cmp(heap->item[child + 1], heap->item[child]) < 0)
+            child++;
+
+        if (heap->cmp(heap->item[child], item) >= 0) break;
+
+        heap_set(heap, i, heap->item[child]);
+        i = child;
+    }
+    heap_set(heap, i, item);
+}
+
+
+Heap heap_ini(CmpFn cmp, size_t posoff) {
+    Heap heap;
+
+    heap.n = heap.cap = 0;
+    heap.item = NULL;
+    heap.cmp = cmp;
+    heap.posoff = posoff;
+
+    return heap;
+}
+
+
+void heap_free(Heap *heap) {
+
+    free(heap->item);
+}
+
+
+int heap_reserve(Heap *heap, int n) {
+    void **new_item;
+    int cap = heap->cap ? heap->cap : HEAPMEM;
+
+    if (n <= heap->cap) return 0;
+    while (cap < n) cap *= 2;
+
+    new_item = (void **) realloc(heap->item, cap * sizeof(void *));
+    if (!new_item) return -1;
+
+    heap->item = new_item;
+    heap->cap = cap;
+    return 0;
+}
+
+
+int heap_push(Heap *heap, void *item) {
+
+    if (heap->n == heap->cap && heap_reserve(heap, heap->n + 1)) return -1;
+
+    heap->item[heap->n] = item;
+    heap_up(heap, heap->n++);
+    return 0;
+}
+
+
+void *heap_top(Heap *heap) {
+
+    return heap->n ? heap->item[0] : NULL;
+}
+
+
+void heap_remove(Heap *heap, void *item) {
+    int i = POS(heap, item);
+
+    if (i < 0 || i >= heap->n || heap->item[i] != item) return;
+    POS(heap, item) = -1;
+
+    // Fill the hole with the last item and restore the order around it
+    if (i == --heap->n) return;
+
+    heap_set(heap, i, heap->item[heap->n]);
+    heap_update(heap, heap->item[i]);
+}
+
+
+void heap_update(Heap *heap, void *item) {
+    int i = POS(heap, item);
+
+    heap_up(heap, i);
+    heap_down(heap, POS(heap, item));
+}
+
+
+/**
+ * @brief Compares the items at two positions of the heap.
+ */
+static int heap_less(Heap *heap, int i, int j) {
+
+    return heap->cmp(heap->item[i], heap->item[j]) < 0;
+}
+
+
+int heap_smallest(Heap *heap, int k, void **out) {
+    int *front, nf = 0, n = 0, i, j, child, c;
+
+    if (k > heap->n) k = heap->n;
+    if (k <= 0) return 0;
+    if (!(front = (int *) malloc((k + 1) * sizeof(int)))) return -1;
+
+    // The next smallest item is always the smallest on the frontier, a
+    // small heap of positions whose parents were already taken
+    front[nf++] = 0;
+    while (n < k) {
+        i = front[0];
+        out[n++] = heap->item[i];
+
+        // Replace it by its children, sifting each one into place
+        front[0] = front[--nf];
+        for (j = 0; nf && (child = 2 * j + 1) < nf; j = child) {
+            if (child + 1 < nf && heap_less(heap, front[child + 1],
+                                            front[child])) child++;
+            if (!heap_less(heap, front[child], front[j])) break;
+            c = front[j];
+            front[j] = front[child];
+            front[child] = c;
+        }
+        for (c = 2 * i + 1; c <= 2 * i + 2 && c < heap->n; c++) {
+            for (j = nf++; j > 0 && heap_less(heap, c, front[(j - 1) / 2]);
+                j = (j - 1) / 2)
+                front[j] = front[(j - 1) / 2];
+            front[j] = c;
+        }
+    }
+
+    free(front);
+    return n;
+}
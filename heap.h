@@ -0,0 +1,120 @@
+/**
+ * @file heap.h
+ * @brief Indexed binary min-heap of pointers.
+ *
+ * Each item stores its own position in the heap (an `int` field at a fixed
+ * offset), so any item can be removed or re-positioned in O(log n) without
+ * searching for it. The k smallest items are read in O(k log k), without
+ * changing the heap.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _HEAP_H_
+#define _HEAP_H_
+
+#include <stdlib.h>
+#include <stddef.h>
+
+#include "par.h"
+
+#define HEAPMEM         64      /**< Initial heap capacity  */
+
+
+/**
+ * @struct Heap
+ * @brief Min-heap ordered by a comparison function.
+ */
+typedef struct {
+    int n, cap;     /**< Number of items and capacity   */
+    void **item;        /**< Items, in heap order   */
+    CmpFn cmp;      /**< Ordering: the smallest item is on top  */
+    size_t posoff;      /**< Offset of the position field in each item  */
+} Heap;
+
+
+/**
+ * @brief Initializes an empty heap.
+ *
+ * @param cmp       Comparison function, called with the stored pointers.
+ * @param posoff    Offset (`offsetof`) of the `int` field where each item
+ *                  keeps its position; it is -1 while not in the heap.
+ *
+ * @return Initialized Heap structure.
+ */
+Heap heap_ini(CmpFn cmp, size_t posoff);
+
+
+/**
+ * @brief Frees the heap (not the items).
+ *
+ * @param heap  Pointer to the heap.
+ */
+void heap_free(Heap *heap);
+
+
+/**
+ * @brief Adds an item.
+ *
+ * @param heap  Pointer to the heap.
+ * @param item  Item to add (not already in the heap).
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int heap_push(Heap *heap, void *item);
+
+
+/**
+ * @brief Makes room for `n` items, so that pushing up to that many never
+ * runs out of memory.
+ *
+ * @param heap  Pointer to the heap.
+ * @param n     Number of items to make room for.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int heap_reserve(Heap *heap, int n);
+
+
+/**
+ * @brief Gets the smallest item without removing it.
+ *
+ * @param heap  Pointer to the heap.
+ *
+ * @return The smallest item, or NULL if the heap is empty.
+ */
+void *heap_top(Heap *heap);
+
+
+/**
+ * @brief Removes an item, wherever it is in the heap.
+ *
+ * @param heap  Pointer to the heap.
+ * @param item  Item to remove; nothing happens if it is not in the heap.
+ */
+void heap_remove(Heap *heap, void *item);
+
+
+/**
+ * @brief Restores the heap order after an item's key changed.
+ *
+ * @param heap  Pointer to the heap.
+ * @param item  Item whose key changed (must be in the heap).
+ */
+void heap_update(Heap *heap, void *item);
+
+
+/**
+ * @brief Gets the `k` smallest items, in order, without removing them.
+ *
+ * @param heap  Pointer to the heap.
+ * @param k     Number of items wanted.
+ * @param out   Where to store the items (room for `k`).
+ *
+ * @return Number of items stored (fewer than `k` if the heap is smaller), 
+ *          or -1 if out of memory.
+ */
+int heap_smallest(Heap *heap, int k, void **out);
+
+#endif
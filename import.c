@@ -0,0 +1,214 @@
+/**
+ * @file import.c
+ * @brief Parallel reader of the CSV files written by the export.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "import.h"
+#include "errors.h"
+#include "par.h"
+
+
+/**
+ * @struct ImpSlice
+ * @brief The lines of a file read by one thread, and their rows.
+ */
+typedef struct {
+    char *lo, *hi;      /**< Lines of the slice */
+    int ncol;       /**< Fields to read per row */
+    int skip;       /**< 1 to skip the slice's first line (the header) */
+    ImpRow *rows;       /**< Rows read  */
+    long n, cap;        /**< Rows read and allocated    */
+    long lines;     /**< Lines in the slice */
+    int err;        /**< 1 if out of memory */
+} ImpSlice;
+
+
+/** Field of the rows that are too short */
+static char empty[] = "";
+
+
+/**
+ * @brief Splits a line into fields in place, undoing the quoting.
+ */
+static void split_line(char *p, char *end, ImpRow *row, int ncol) {
+    char *w;
+    int c;
+
+    for (c = 0; c < ncol; c++) row->field[c] = empty;
+
+    // Each field is moved back over the quotes and ends with a NUL
+    for (c = 0; c < ncol && p <= end; c++, p++) {
+        row->field[c] = w = p;
+        if (*p == '"') {
+            for (p++; p < end && (*p != '"' || p[1] == '"'); p++) {
+                if (*p == '"') p++;
+                *w++ = *p;
+            }
+            if (p < end) p++;
+        }
+        while (p < end && *p != ',') *w++ = *p++;
+        *w = '\0';
+    }
+}
+
+
+/**
+ * @brief Thread entry: reads the rows of a slice.
+ */
+static void *slice_job(void *arg) {
+    ImpSlice *s = (ImpSlice *) arg;
+    char *p, *end, *stop;
+    ImpRow *rows;
+
+    for (p = s->lo; p < s->hi && !s->err; p = end + 1) {
+        end = (char *) memchr(p, '\n', s->hi - p);
+        if (!end) end = s->hi;
+        s->lines++;
+
+        stop = end > p && end[-1] == '\r' ? end - 1 : end;
+        if ((s->skip && s->lines == 1) || stop == p) continue;
+
+        if (s->n == s->cap) {
+            s->cap = s->cap ? 2 * s->cap : IMPROWMEM;
+            rows = (ImpRow *) realloc(s->rows, s->cap * sizeof(ImpRow));
+            if (!rows) { s->err = 1; break; }
+            s->rows = rows;
+        }
+        split_line(p, stop, &s->rows[s->n], s->ncol);
+        s->rows[s->n++].line = s->lines;
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Reads a whole file into a NUL-terminated buffer.
+ *
+ * @return VMS_OK, VMS_EFILE or VMS_ENOMEMORY.
+ */
+static int read_file(const char *path, char **buf, long *size) {
+    FILE *file = fopen(path, "rb");
+    int status = VMS_OK;
+
+    *buf = NULL;
+    if (!file) return VMS_EFILE;
+    if (fseek(file, 0, SEEK_END) || (*size = ftell(file)) < 0 ||
+        fseek(file, 0, SEEK_SET)) status = VMS_EFILE;
+    else if (!(*buf = (char *) malloc(*size + 1))) status = VMS_ENOMEMORY;
+    else if ((long) fread(*buf, 1, *size, file) != *size) status = VMS_EFILE;
+    else (*buf)[*size] = '\0';
+
+    fclose(file);
+    if (status != VMS_OK) {
+        free(*buf);
+        *buf = NULL;
+    }
+    return status;
+}
+
+
+int import_read(const char *path, int ncol, ImpTable *table) {
+    ImpSlice slice[PARMAXTHR];
+    long size, lines, k;
+    int nthr, i, status;
+    char *cut;
+
+    table->rows = NULL;
+    table->n = 0;
+    if ((status = read_file(path, &table->buf, &size)) != VMS_OK)
+        return status;
+
+    // One slice per thread, each ending after a line break
+    nthr = size < IMPPARMIN ? 1 : par_threads();
+    for (i = 0; i < nthr; i++) {
+        slice[i].lo = i ? slice[i - 1].hi : table->buf;
+        cut = table->buf + size * (i + 1) / nthr;
+        if (cut < slice[i].lo) cut = slice[i].lo;
+        if (i + 1 < nthr && (cut = (char *) memchr(cut, '\n',
+            table->buf + size - cut))) cut++;
+        slice[i].hi = i + 1 < nthr && cut ? cut : table->buf + size;
+
+        slice[i].ncol = ncol;
+        slice[i].skip = !i;
+        slice[i].rows = NULL;
+        slice[i].n = slice[i].cap = slice[i].lines = 0;
+        slice[i].err = 0;
+    }
+    par_run(slice_job, slice, sizeof(ImpSlice), nthr);
+
+    // Join the slices, numbering their lines from the start of the file
+    for (i = 0, k = 0; i < nthr; i++) {
+        if (slice[i].err) status = VMS_ENOMEMORY;
+        k += slice[i].n;
+    }
+    if (status == VMS_OK &&
+        !(table->rows = (ImpRow *) malloc((k ? k : 1) * sizeof(ImpRow))))
+        status = VMS_ENOMEMORY;
+
+    for (i = 0, lines = 0; i < nthr; i++) {
+        for (k = 0; status == VMS_OK && k < slice[i].n; k++) {
+            table->rows[table->n] = slice[i].rows[k];
+            table->rows[table->n++].line += lines;
+        }
+        lines += slice[i].lines;
+        free(slice[i].rows);
+    }
+
+    if (status != VMS_OK) import_free(table);
+    return status;
+}
+
+
+void import_free(ImpTable *table) {
+
+    free(table->buf);
+    free(table->rows);
+    table->buf = NULL;
+    table->rows = NULL;
+    table->n = 0;
+}
+
+
+/**
+ * @brief Reads the digits of a number, up to `max` of them.
+ *
+ * @return Number of digits read.
+ */
+static int read_digits(const char **p, int max, long *val) {
+    int n = 0;
+
+    for (*val = 0; n < max && **p >= '0' && **p <= '9'; n++, (*p)++)
+        *val = *val * 10 + (**p - '0');
+    return n;
+}
+
+
+int import_date(const char *field, Date *date) {
+    long yy, mm, dd;
+
+    if (read_digits(&field, 4, &yy) != 4 || *field++ != '-' ||
+        read_digits(&field, 2, &mm) != 2 || *field++ != '-' ||
+        read_digits(&field, 2, &dd) != 2 || *field) return 0;
+
+    date->yy = (int) yy;
+    date->mm = (int) mm;
+    date->dd = (int) dd;
+    return 1;
+}
+
+
+int import_int(const char *field, int *val) {
+    long v;
+    int n = read_digits(&field, 9, &v);
+
+    if (!n || *field) return 0;
+    *val = (int) v;
+    return 1;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file import.h
+ * @brief Parallel reader of the CSV files written by the export (export.h).
+ *
+ * A file is read whole and split into one slice of lines per thread. Each
+ * thread splits its lines into fields in place, undoing the quoting, so a
+ * row's fields point into the file's buffer. The first line (the header)
+ * and blank lines are skipped; fields may not span lines.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _IMPORT_H_
+#define _IMPORT_H_
+
+#include "date.h"
+
+#define IMPMAXCOL       8       /**< max. num. of fields read per row    */
+#define IMPROWMEM       1024        /**< Initial rows per slice    */
+#define IMPPARMIN       (1 << 20)       /**< min. bytes for a parallel read */
+
+
+/**
+ * @struct ImpRow
+ * @brief A row of a CSV file.
+ */
+typedef struct {
+    char *field[IMPMAXCOL];     /**< Fields ("" where the row is short)  */
+    long line;      /**< Line number in the file, from 1    */
+} ImpRow;
+
+
+/**
+ * @struct ImpTable
+ * @brief The rows of a CSV file.
+ */
+typedef struct {
+    char *buf;      /**< Contents of the file, split into fields    */
+    ImpRow *rows;       /**< Rows, in order */
+    long n;     /**< Number of rows */
+} ImpTable;
+
+
+/**
+ * @brief Reads a CSV file.
+ *
+ * @param path  Path of the file.
+ * @param ncol  Number of fields to read per row (at most IMPMAXCOL).
+ * @param table Where to store the rows.
+ *
+ * @return VMS_OK, VMS_EFILE if the file could not be read or VMS_ENOMEMORY
+ *          (then there is nothing to free).
+ */
+int import_read(const char *path, int ncol, ImpTable *table);
+
+
+/**
+ * @brief Frees the rows of a file.
+ *
+ * @param table The rows.
+ */
+void import_free(ImpTable *table);
+
+
+/**
+ * @brief Reads a date written as YYYY-MM-DD.
+ *
+ * @param field The field.
+ * @param date  Where to store the date.
+ *
+ * @return 1 if the whole field is a date, 0 otherwise.
+ */
+int import_date(const char *field, Date *date);
+
+
+/**
+ * @brief Reads a non-negative integer.
+ *
+ * @param field The field.
+ * @param val   Where to store the integer.
+ *
+ * @return 1 if the whole field is an integer, 0 otherwise.
+ */
+int import_int(const char *field, int *val);
+
+#endif
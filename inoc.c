@@ -10,141 +10,139 @@
 
 #include "inoc.h"
 
-int dup_inoc(char username[], char vac_name[], Hash *hash, Inoc *inocs, 
-            Date current_date, int is_pt) {
-    int i, key;
-    Inoc inoc;
-
-    key = hash_get_key(username);       // Get hash key for the username.
-    for(i = 0; i < hash->niIdx[key]; i++) {
-        inoc = inocs[hash->inocsIdx[key][i]];       // Access inoc record.
-
-        // Check if the same user, vaccine, and date exist in the records.
-        if (!strcmp(username, inoc.user) && 
-            !compare_dates(current_date, inoc.apdate) && 
-            !strcmp(vac_name, inoc.vaccine->name)) {
-            
-            is_pt ? puts(EDOUBLEVAC_PT): puts(EDOUBLEVAC_EN);
-            return 1;
-        }
-    }
+/**
+ * @brief Grows one column to a new capacity.
+ * 
+ * @return 0 on success, -1 if out of memory (the column is unchanged).
+ */
+static int col_realloc(int **col, int cap) {
+    int *new_col = (int *) realloc(*col, cap * sizeof(int));
+
+    if (!new_col) return -1;
+    *col = new_col;
     return 0;
 }
 
-Inoc *inoc_realloc(int ni, int *incocCap, Inoc *inocs) {
+Inoc *inoc_realloc(int ni, int *incocCap, Inoc *inocs, InocCols *cols) {
+
+    return inoc_reserve(ni + 1, incocCap, inocs, cols);
+}
+
+
+Inoc *inoc_reserve(int need, int *incocCap, Inoc *inocs, InocCols *cols) {
     Inoc *new_inocs;
+    int cap = *incocCap;
+
+    if (need <= cap) return inocs;       // There is still room.
+    while (cap < need) cap *= 2;
 
-    if (ni == *incocCap) {      // Check if the capacity is full.
-        new_inocs = (Inoc*) realloc(inocs, (*incocCap+INOCMEM) * sizeof(Inoc));
-        *incocCap += INOCMEM;
+    // Grow the columns first: the records array is only replaced on success.
+    if (col_realloc(&cols->user, cap) || col_realloc(&cols->batch, cap) || 
+        col_realloc(&cols->date, cap)) return NULL;
 
-        if (!new_inocs) return NULL;        // Memory allocation fail
+    new_inocs = (Inoc*) realloc(inocs, cap * sizeof(Inoc));
+    if (!new_inocs) return NULL;        // Memory allocation fail
 
-        inocs = new_inocs;
+    *incocCap = cap;
+    return new_inocs;
+}
+
+
+void inoc_set(Inoc *inocs, InocCols *cols, int i, char *user, int uid, 
+                Vaccine *vac, Date date, long seq) {
+
+    inocs[i].user = user;
+    inocs[i].vaccine = vac;
+    inocs[i].apdate = date;
+    inocs[i].seq = seq;
+
+    cols->user[i] = uid;
+    cols->batch[i] = vac->bid;
+    cols->date[i] = date_key(date);
+}
+
+
+int inoc_lower_bound(int ni, int *dates, Date date) {
+    int low = 0, high = ni, mid, key = date_key(date);
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+
+        // Records before `date` are left of the answer
+        if (dates[mid] < key) low = mid + 1;
+        else high = mid;
     }
+    return low;
+}
+
 
-    return inocs;
+int inoc_before(const Inoc *a, const Inoc *b) {
+    int x = date_key(a->apdate), y = date_key(b->apdate);
+
+    return x < y || (x == y && a->seq < b->seq);
 }
 
 
 void print_l_inoc(Inoc *inoc) {
     
-    printf("%s %s %02d-%02d-%d\n", inoc->user, inoc->vaccine->batch, 
+    printf(LINOCFMT, inoc->user, inoc->vaccine->batch, 
             inoc->apdate.dd, inoc->apdate.mm, inoc->apdate.yy);
 }
 
 
-void inoc_hash_remove(Hash *hash, char username[], Inoc *inocs, int read_date, 
-                        int read_batch, char batch[], Date date) {
-    int i, j, key = hash_get_key(username);
-    Inoc *inoc;
-
-    // Loop through the hash table to find the matching inoculation record.
-    for (i = 0; i < hash->niIdx[key]; i++) {
-        
-        inoc = &inocs[hash->inocsIdx[key][i]];
-        if (!strcmp(username, inoc->user)) {
-            
-            if ((!read_date && !read_batch) ||
-                (!read_batch && !compare_dates(date, inoc->apdate)) ||
-                (!compare_dates(date, inoc->apdate) && 
-                !strcmp(batch, inoc->vaccine->batch))) {
-                
-                // Shift remaining records to remove the current one.
-                for (j = i; j < hash->niIdx[key] - 1; j++)
-                    hash->inocsIdx[key][j] = --hash->inocsIdx[key][j+1];
-            
-                hash->niIdx[key]--;
-                i--;        // Adjust index due to shifted records.
-            }
-        }
-    }
+int format_l_inoc(char *dst, size_t room, void *inocs, long i) {
+    Inoc *inoc = &((Inoc *) inocs)[i];
+
+    return snprintf(dst, room, LINOCFMT, inoc->user, inoc->vaccine->batch, 
+                    inoc->apdate.dd, inoc->apdate.mm, inoc->apdate.yy);
 }
 
 
-int inoc_remove(int ni, Inoc *inocs, char username[], int read_date,
-                int read_batch, int is_batch, Date date, char batch[]) {
-    int i, j, del_count = 0, is_user = 0;
-    Inoc *inoc;
-    
-    // Loop through the inoculations to find matching records.
-    for (i = 0; i < ni; i++) {
-        
-        inoc = &inocs[i];
-        if (!strcmp(username, inoc->user)) {
-        
-            if ((!read_date && !read_batch) ||
-                (!read_batch && !compare_dates(date, inoc->apdate)) ||
-                (!compare_dates(date, inoc->apdate) && 
-                !strcmp(batch, inoc->vaccine->batch))) {
-
-                free(inoc->user);
-
-                // Shift remaining records to remove the current one.
-                for (j = i; j < ni - 1; j++) inocs[j] = inocs[j+1];
-
-                ni--;
-                del_count++;
-                is_batch = 1;
-                i--;        // Adjust index due to shifted records.
-            }
-            is_user = 1;
-        }
-    }
+int format_l_inocp(char *dst, size_t room, void *inocps, long i) {
 
-    if (!is_user) return -1;
-    if (!is_batch) return -2;
-    return del_count;
+    return format_l_inoc(dst, room, ((Inoc **) inocps)[i], 0);
 }
 
-int inoc_del(char username[], char batch[], Hash *hash, Inoc *inocs, 
-            int read_date, int read_batch, int val_date, Date date, int ni, 
-            int is_batch, int is_pt) {
-    int removed;
-
-    // Remove the inoculation record from the hash table.
-    if (val_date)
-        inoc_hash_remove(hash, username, inocs, read_date, read_batch, 
-                        batch, date);
-
-    // Remove the inoculation record from the inoculations array.
-    removed = inoc_remove(ni, inocs, username, read_date, read_batch, 
-                            is_batch, date, batch);
-
-    // Error handle
-    if (removed == -1) {
-        printf("%s", username);
-        is_pt ? puts(EINVUSER_PT): puts(EINVUSER_EN);
-        return -1;
-    }
 
-    if (!val_date) { is_pt ? puts(EINVDATE_PT): puts(EINVDATE_EN); return -1; }
+/**
+ * @brief Moves records (and their columns) to an earlier position.
+ */
+static void inoc_move(Inoc *inocs, InocCols *cols, int to, int from, int n) {
+
+    memmove(inocs + to, inocs + from, n * sizeof(Inoc));
+    memmove(cols->user + to, cols->user + from, n * sizeof(int));
+    memmove(cols->batch + to, cols->batch + from, n * sizeof(int));
+    memmove(cols->date + to, cols->date + from, n * sizeof(int));
+}
+
+
+int inoc_remove(int ni, Inoc *inocs, InocCols *cols, int uid, int read_date,
+                int read_batch, Date date, int bid, Inoc *gone) {
+    int i, next, keep_from, w, del_count = 0, key = date_key(date);
+
+    // Find the user's first record; nothing moves before it.
+    w = i = uid == -1 ? ni : scan_eq(cols->user, 0, ni, uid);
+    if (i == ni) return -1;
+
+    // Visit the user's records, compacting the array as we go.
+    for (; i < ni; i = next) {
+        next = scan_eq(cols->user, i + 1, ni, uid);
+        keep_from = i;
 
-    if (removed == -2) {
-        printf("%s", batch);
-        is_pt ? puts(ENOBATCH_PT): puts(ENOBATCH_EN);        
-        return -1;
+        if (!read_date || (cols->date[i] == key && 
+            (!read_batch || cols->batch[i] == bid))) {
+
+            if (gone) gone[del_count] = inocs[i];
+            del_count++;
+            keep_from = i + 1;
+        }
+
+        // Shift the records kept, up to the user's next record.
+        if (w != keep_from) inoc_move(inocs, cols, w, keep_from, 
+                                        next - keep_from);
+        w += next - keep_from;
     }
 
-    return removed;
-}
\ No newline at end of file
+    if (read_batch && !del_count) return -2;
+    return del_count;
+}
@@ -6,7 +6,9 @@
  * inoculation records in the vaccine management system.
  * 
  * The structure `Inoc` holds the user, vaccine, and application date 
- * information for each inoculation.
+ * information for each inoculation. The same records are also kept in a 
+ * column layout (`InocCols`) of integer IDs, which the searches scan with 
+ * vector instructions instead of following the pointers of each record.
  */
 
 #ifndef _INOC_H_
@@ -17,9 +19,14 @@
 #include <stdlib.h>
 
 #include "vaccine.h"
+#include "stats.h"
+#include "today.h"
+#include "recall.h"
+#include "scan.h"
 #include "date.h"
 
 #define INOCMEM         100     /**< Initial memory for inoculations. */
+#define LINOCFMT        "%s %s %02d-%02d-%d\n"     /**< Inoculation listing. */
 
 
 /**
@@ -33,22 +40,20 @@ typedef struct {
     char *user;             /**< Username of the person who got vaccinated. */
     Vaccine *vaccine;       /**< Pointer to the vaccine used for inoculation. */
     Date apdate;            /**< Date the vaccination was applied. */
+    long seq;               /**< Order of application within a date. */
 } Inoc;
 
+
 /**
- * @brief Checks for a duplicate inoculation for a given user and vaccine.
- * 
- * @param username          The username of the user to check.
- * @param vac_name          The vaccine name to check.
- * @param hash              The hash table used for quick lookup.
- * @param inocs             The array of inoculations.
- * @param current_date      The current date to check against.
- * @param is_pt             The language flag (1 for Portuguese, 0 for English).
+ * @brief Column layout of the inoculation records.
  * 
- * @return  1 if a duplicate is found, 0 otherwise.
+ * Position i of each column describes record i of the inoculations array.
  */
-int dup_inoc(char username[], char vac_name[], Hash *hash, Inoc *inocs, 
-                Date current_date, int is_pt);
+typedef struct {
+    int *user;      /**< Interned username ID of each record. */
+    int *batch;     /**< Interned batch ID of each record. */
+    int *date;      /**< Packed application date (`date_key`) of each record. */
+} InocCols;
 
 
 /**
@@ -57,10 +62,69 @@ int dup_inoc(char username[], char vac_name[], Hash *hash, Inoc *inocs,
  * @param ni         The current number of inoculations.
  * @param incocCap   The current capacity of the inoculations array.
  * @param inocs      The array of inoculations.
+ * @param cols       The inoculation columns, grown with the array.
+ * 
+ * @return  The reallocated inoculations array / NULL if error.
+ */
+Inoc *inoc_realloc(int ni, int *incocCap, Inoc *inocs, InocCols *cols);
+
+
+/**
+ * @brief Grows the inoculations array, if needed, to hold `need` records.
+ * 
+ * @param need       The number of records to make room for.
+ * @param incocCap   The current capacity of the inoculations array.
+ * @param inocs      The array of inoculations.
+ * @param cols       The inoculation columns, grown with the array.
  * 
  * @return  The reallocated inoculations array / NULL if error.
  */
-Inoc *inoc_realloc(int ni, int *incocCap, Inoc *inocs);
+Inoc *inoc_reserve(int need, int *incocCap, Inoc *inocs, InocCols *cols);
+
+
+/**
+ * @brief Stores an inoculation record and its columns.
+ * 
+ * @param inocs     The array of inoculations.
+ * @param cols      The inoculation columns.
+ * @param i         Position of the record.
+ * @param user      Interned username.
+ * @param uid       ID of the interned username.
+ * @param vac       Batch applied.
+ * @param date      Application date.
+ * @param seq       Sequence number of the record.
+ */
+void inoc_set(Inoc *inocs, InocCols *cols, int i, char *user, int uid, 
+                Vaccine *vac, Date date, long seq);
+
+
+/**
+ * @brief Finds the first inoculation applied on or after a date.
+ * 
+ * Records are appended with the current system date, which never moves 
+ * back, and deletions keep the order, so the array is sorted by date and 
+ * can be binary searched.
+ * 
+ * @param ni    The current number of inoculations.
+ * @param dates The packed date column.
+ * @param date  The date to search for.
+ * 
+ * @return Index of the first record with `apdate` >= `date` (`ni` if none).
+ */
+int inoc_lower_bound(int ni, int *dates, Date date);
+
+
+/**
+ * @brief Compares two records in order of application: by date, then by 
+ * sequence number. Imported records may be dated before others; they get
+ * higher sequence numbers, so they go after those of the same date.
+ * 
+ * @param a     A record.
+ * @param b     Another record.
+ * 
+ * @return 1 if `a` goes before `b`, 0 otherwise.
+ */
+int inoc_before(const Inoc *a, const Inoc *b);
 
 
 /**
@@ -72,57 +136,51 @@ void print_l_inoc(Inoc *inoc);
 
 
 /**
- * @brief Removes an inoculation record from the hash table.
+ * @brief Formats an inoculation record, as printed by `print_l_inoc`.
  * 
- * @param hash       The hash table storing inoculation records.
- * @param username   The username of the inoculation that is to be removed.
- * @param inocs      The array of inoculations.
- * @param read_date  Flag indicating if date filtering is enabled.
- * @param read_batch Flag indicating if batch filtering is enabled.
- * @param batch      The batch number to filter by.
- * @param date       The date to filter by.
+ * @param dst   Where to write the text.
+ * @param room  Bytes available in `dst`.
+ * @param inocs The array of inoculations.
+ * @param i     Index of the record to format.
+ * 
+ * @return The length of the full text, like `snprintf`.
  */
-void inoc_hash_remove(Hash *hash, char username[], Inoc *inocs, int read_date, 
-                        int read_batch, char batch[], Date date);
+int format_l_inoc(char *dst, size_t room, void *inocs, long i);
 
 
 /**
- * @brief Removes an inoculation record from the inoculations array.
+ * @brief Formats an inoculation record from an array of record pointers.
+ * 
+ * @param dst       Where to write the text.
+ * @param room      Bytes available in `dst`.
+ * @param inocps    The array of pointers to inoculations.
+ * @param i         Index of the pointer to the record to format.
+ * 
+ * @return The length of the full text, like `snprintf`.
+ */
+int format_l_inocp(char *dst, size_t room, void *inocps, long i);
+
+
+/**
+ * @brief Removes a user's inoculation records from the inoculations array.
+ * 
+ * The records kept are compacted in a single pass.
  * 
  * @param ni         The current number of inoculations.
  * @param inocs      The array of inoculations.
- * @param username   The username of the inoculation that is to be removed.
+ * @param cols       The inoculation columns.
+ * @param uid        The user ID whose records are to be removed.
  * @param read_date  Flag indicating if date filtering is enabled.
  * @param read_batch Flag indicating if batch filtering is enabled.
- * @param is_batch   Flag indicating if the batch filter is applied.
  * @param date       The date to filter by.
- * @param batch      The batch number to filter by.
+ * @param bid        The batch ID to filter by (-1 if unknown).
+ * @param gone       Where to copy the records removed, with room for all
+ *                   of the user's records (NULL to drop them).
  * 
- * @return The number of records removed or error code.
- */
-int inoc_remove(int ni, Inoc *inocs, char username[], int read_date,
-                int read_batch, int is_batch, Date date, char batch[]);
-
-
-/**
- * @brief Deletes an inoculation record based on specific criteria.
- * 
- * @param username      The username of the inoculation that is to be removed.
- * @param batch         The batch number to filter by.
- * @param hash          The hash table storing inoculation records.
- * @param inocs         The array of inoculations.
- * @param read_date     Flag indicating if date filtering is enabled.
- * @param read_batch    Flag indicating if batch filtering is enabled.
- * @param val_date      Flag indicating if date is valid.
- * @param date          The date to filter by.
- * @param ni            The current number of inoculations.
- * @param is_batch      Flag indicating if the batch filter is applied.
- * @param is_pt         The language flag
- * 
- * @return The number of records removed or an error code.
+ * @return The number of records removed, -1 if the user has no records or 
+ *          -2 if filtering by batch and nothing matched.
  */
-int inoc_del(char username[], char batch[], Hash *hash, Inoc *inocs, 
-            int read_date, int read_batch, int val_date, Date date, int ni, 
-            int is_batch, int is_pt);
+int inoc_remove(int ni, Inoc *inocs, InocCols *cols, int uid, int read_date,
+                int read_batch, Date date, int bid, Inoc *gone);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,114 @@
+/**
+ * @file intern.c
+ * @brief String interning table implementation.
+ *
+ * Strings are hashed with FNV-1a into a linear-probing table that is kept
+ * at most half full. IDs index the `str` array, which grows with the table.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include "intern.h"
+
+
+unsigned intern_hash(const char *str) {
+    unsigned h = 2166136261u;
+
+    while (*str) h = (h ^ (unsigned char) *str++) * 16777619u;
+    return h;
+}
+
+
+/**
+ * @brief Finds the slot of a string, or the empty slot where it would go.
+ */
+static int intern_slot(Intern *tab, const char *str) {
+    int i = intern_hash(str) & (tab->cap - 1);
+
+    while (tab->slot[i] && strcmp(tab->str[tab->slot[i] - 1], str))
+        i = (i + 1) & (tab->cap - 1);
+    return i;
+}
+
+
+/**
+ * @brief Grows the table to `cap` slots and rehashes every string.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int intern_grow(Intern *tab, int cap) {
+    int *old = tab->slot, i;
+    char **str;
+
+    str = (char **) realloc(tab->str, (cap / 2) * sizeof(char *));
+    if (!str) return -1;
+    tab->str = str;
+
+    if (!(tab->slot = (int *) calloc(cap, sizeof(int)))) {
+        tab->slot = old;
+        return -1;
+    }
+
+    tab->cap = cap;
+    for (i = 0; i < tab->n; i++)
+        tab->slot[intern_slot(tab, tab->str[i])] = i + 1;
+
+    free(old);
+    return 0;
+}
+
+
+Intern intern_ini() {
+    Intern tab;
+
+    tab.n = 0;
+    tab.cap = INTERNMEM;
+    tab.slot = (int *) calloc(INTERNMEM, sizeof(int));
+    tab.str = (char **) malloc((INTERNMEM / 2) * sizeof(char *));
+
+    return tab;
+}
+
+
+void intern_free(Intern *tab) {
+    int i;
+
+    for (i = 0; i < tab->n; i++) free(tab->str[i]);
+    free(tab->str);
+    free(tab->slot);
+}
+
+
+int intern_find(Intern *tab, const char *str) {
+
+    return tab->slot[intern_slot(tab, str)] - 1;
+}
+
+
+int intern_reserve(Intern *tab, int n) {
+    int cap = tab->cap;
+
+    while (2 * (tab->n + n) > cap) cap *= 2;
+    return cap == tab->cap ? 0 : intern_grow(tab, cap);
+}
+
+
+int intern_add(Intern *tab, const char *str) {
+    int i = intern_slot(tab, str);
+    char *copy;
+
+    if (tab->slot[i]) return tab->slot[i] - 1;      // Already interned
+
+    // Keep the table at most half full
+    if (2 * (tab->n + 1) > tab->cap) {
+        if (intern_grow(tab, 2 * tab->cap)) return -1;
+        i = intern_slot(tab, str);
+    }
+
+    if (!(copy = strdup(str))) return -1;
+
+    tab->str[tab->n] = copy;
+    tab->slot[i] = ++tab->n;
+    return tab->n - 1;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file intern.h
+ * @brief String interning table.
+ *
+ * Each distinct string is stored once and given a dense integer ID
+ * (0, 1, 2, ...), so names can be compared and used as array indices
+ * without `strcmp`.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _INTERN_H_
+#define _INTERN_H_
+
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERNMEM       64      /**< Initial number of hash slots   */
+
+
+/**
+ * @struct Intern
+ * @brief Open-addressing hash table of interned strings.
+ */
+typedef struct {
+    int n;      /**< Number of interned strings */
+    int cap;        /**< Number of slots (a power of two)   */
+    int *slot;      /**< ID + 1 of the string in each slot, 0 if empty  */
+    char **str;     /**< String of each ID  */
+} Intern;
+
+
+/**
+ * @brief Hashes a string (FNV-1a).
+ *
+ * @param str   String to hash.
+ *
+ * @return Hash value.
+ */
+unsigned intern_hash(const char *str);
+
+
+/**
+ * @brief Initializes an empty interning table.
+ *
+ * @return Initialized Intern structure (`slot` is NULL if out of memory).
+ */
+Intern intern_ini();
+
+
+/**
+ * @brief Frees the table and all interned strings.
+ *
+ * @param tab   Pointer to the table.
+ */
+void intern_free(Intern *tab);
+
+
+/**
+ * @brief Looks up a string.
+ *
+ * @param tab   Pointer to the table.
+ * @param str   String to look up.
+ *
+ * @return ID of the string, or -1 if it was never interned.
+ */
+int intern_find(Intern *tab, const char *str);
+
+
+/**
+ * @brief Grows the table at once to hold `n` more strings, so that adding 
+ * them never rehashes.
+ *
+ * @param tab   Pointer to the table.
+ * @param n     Number of strings that may be added.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int intern_reserve(Intern *tab, int n);
+
+
+/**
+ * @brief Interns a string, copying it if it is new.
+ *
+ * @param tab   Pointer to the table.
+ * @param str   String to intern.
+ *
+ * @return ID of the string, or -1 if out of memory.
+ */
+int intern_add(Intern *tab, const char *str);
+
+#endif
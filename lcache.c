@@ -0,0 +1,107 @@
+/**
+ * @file lcache.c
+ * @brief Cache of the text of the batch listings.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lcache.h"
+
+
+/**
+ * @brief Makes room for `len` more bytes of text.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int ltext_grow(LText *lt, size_t len) {
+    size_t cap = lt->cap ? lt->cap : 256;
+    char *text;
+
+    if (lt->len + len <= lt->cap) return 0;
+
+    while (cap < lt->len + len) cap *= 2;
+    text = (char *) realloc(lt->text, cap);
+    if (!text) return -1;
+
+    lt->text = text;
+    lt->cap = cap;
+    return 0;
+}
+
+
+LCache lcache_ini(void) {
+    LCache cache;
+
+    memset(&cache.all, 0, sizeof(LText));
+    cache.vac = NULL;
+    cache.nvac = 0;
+
+    return cache;
+}
+
+
+void lcache_free(LCache *cache) {
+    int i;
+
+    for (i = 0; i < cache->nvac; i++) free(cache->vac[i].text);
+    free(cache->vac);
+    free(cache->all.text);
+}
+
+
+void lcache_touch(LCache *cache, int vid) {
+
+    cache->all.valid = 0;
+    if (vid >= 0 && vid < cache->nvac) cache->vac[vid].valid = 0;
+}
+
+
+LText *lcache_get(LCache *cache, int vid) {
+    int n = cache->nvac ? cache->nvac : LCACHEMEM;
+    LText *vac;
+
+    if (vid < 0) return &cache->all;
+
+    // Vaccine entries are added as the IDs grow, empty and invalid
+    if (vid >= cache->nvac) {
+        while (n <= vid) n *= 2;
+        vac = (LText *) realloc(cache->vac, n * sizeof(LText));
+        if (!vac) return NULL;
+
+        memset(vac + cache->nvac, 0, (n - cache->nvac) * sizeof(LText));
+        cache->vac = vac;
+        cache->nvac = n;
+    }
+    return &cache->vac[vid];
+}
+
+
+int ltext_add(LText *lt, const char *text, size_t len) {
+
+    if (ltext_grow(lt, len)) return -1;
+    memcpy(lt->text + lt->len, text, len);
+    lt->len += len;
+    return 0;
+}
+
+
+int ltext_format(LText *lt, FormatFn fmt, void *ctx, long i) {
+    size_t room = lt->cap - lt->len;
+    int n;
+
+    n = fmt(lt->text ? lt->text + lt->len : NULL, lt->text ? room : 0, ctx, i);
+    if (n < 0) return -1;
+
+    // Format again once there is room for the whole item
+    if ((size_t) n >= room) {
+        if (ltext_grow(lt, n + 1)) return -1;
+        fmt(lt->text + lt->len, n + 1, ctx, i);
+    }
+
+    lt->len += n;
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file lcache.h
+ * @brief Cache of the text of the batch listings.
+ *
+ * The full listing ('l') and the listing of each vaccine ('l <vaccine>')
+ * are kept as the text last printed. A change to a batch invalidates the
+ * listing of its vaccine and the full listing; the others stay valid and
+ * are printed again with a single write.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _LCACHE_H_
+#define _LCACHE_H_
+
+#include <stddef.h>
+
+#include "par.h"
+
+#define LCACHEMEM       16      /**< Initial number of vaccine entries  */
+
+
+/**
+ * @struct LText
+ * @brief The text of one listing.
+ */
+typedef struct {
+    char *text;     /**< Listing text   */
+    size_t len, cap;        /**< Bytes used and allocated   */
+    int valid;      /**< 1 if the text is up to date    */
+} LText;
+
+
+/**
+ * @struct LCache
+ * @brief The cached listings.
+ */
+typedef struct {
+    LText all;      /**< Full listing   */
+    LText *vac;     /**< Listing of each vaccine, by vaccine name ID */
+    int nvac;       /**< Number of vaccine entries allocated    */
+} LCache;
+
+
+/**
+ * @brief Initializes an empty cache.
+ *
+ * @return Initialized LCache structure.
+ */
+LCache lcache_ini(void);
+
+
+/**
+ * @brief Frees the cache.
+ *
+ * @param cache Pointer to the cache.
+ */
+void lcache_free(LCache *cache);
+
+
+/**
+ * @brief Invalidates the listings that show a batch of a vaccine.
+ *
+ * @param cache Pointer to the cache.
+ * @param vid   ID of the vaccine name.
+ */
+void lcache_touch(LCache *cache, int vid);
+
+
+/**
+ * @brief Gets the entry of a listing.
+ *
+ * @param cache Pointer to the cache.
+ * @param vid   ID of the vaccine name, or -1 for the full listing.
+ *
+ * @return The entry (to be rendered if not valid), or NULL if out of memory.
+ */
+LText *lcache_get(LCache *cache, int vid);
+
+
+/**
+ * @brief Appends text to a listing.
+ *
+ * @param lt    The listing.
+ * @param text  Bytes to append.
+ * @param len   Number of bytes.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int ltext_add(LText *lt, const char *text, size_t len);
+
+
+/**
+ * @brief Appends one formatted item to a listing.
+ *
+ * @param lt    The listing.
+ * @param fmt   Function that formats the item.
+ * @param ctx   Context passed to `fmt`.
+ * @param i     Index of the item.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int ltext_format(LText *lt, FormatFn fmt, void *ctx, long i);
+
+#endif
@@ -0,0 +1,499 @@
+/**
+ * @file lex.c
+ * @brief AVX2/SSE2/scalar byte classification with run-time dispatch, and
+ *          the field readers built on it.
+ *
+ * Bounded checks load the bytes unaligned and finish with a scalar tail. The
+ * spans over NUL-terminated strings load aligned blocks instead, so they
+ * never cross into the next page; the bytes before the string are shifted
+ * out of the mask.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "lex.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LEXX86      1
+#include <immintrin.h>
+#endif
+
+
+/** Signature of the bounded checks */
+typedef int (*LexCheck)(const char *, int);
+
+/** Signature of the spans */
+typedef int (*LexSpan)(const char *);
+
+
+/**
+ * @brief Checks for white-space as `isspace` does in the "C" locale.
+ */
+static int is_space(unsigned char c) {
+
+    return c == ' ' || (unsigned) (c - '\t') <= '\r' - '\t';
+}
+
+
+static int is_hex_scalar(const char *str, int n) {
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (!(('A' <= str[i] && str[i] <= 'F') ||
+            ('0' <= str[i] && str[i] <= '9')))
+            return 0;
+    return 1;
+}
+
+
+static int has_blank_scalar(const char *str, int n) {
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (str[i] == ' ' || str[i] == '\n' || str[i] == '\t') return 1;
+    return 0;
+}
+
+
+static int span_word_scalar(const char *str) {
+    int i;
+
+    for (i = 0; str[i] != '\0' && !is_space(str[i]); i++);
+    return i;
+}
+
+
+static int span_quoted_scalar(const char *str) {
+    int i;
+
+    for (i = 0; str[i] != '\0' && str[i] != '"'; i++);
+    return i;
+}
+
+
+#ifdef LEXX86
+
+/*
+ * There are no unsigned byte compares before AVX-512, so a range test
+ * `lo <= c <= lo + k` is done as `min(c - lo, k) == c - lo`.
+ */
+
+__attribute__((target("sse2")))
+static int is_hex_sse2(const char *str, int n) {
+    __m128i v, dig, hex;
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        v = _mm_loadu_si128((const __m128i *) (str + i));
+        dig = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+        hex = _mm_sub_epi8(v, _mm_set1_epi8('A'));
+        dig = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_min_epu8(dig, _mm_set1_epi8(9)), dig),
+                _mm_cmpeq_epi8(_mm_min_epu8(hex, _mm_set1_epi8(5)), hex));
+        if (_mm_movemask_epi8(dig) != 0xFFFF) return 0;
+    }
+    return is_hex_scalar(str + i, n - i);
+}
+
+
+__attribute__((target("sse2")))
+static int has_blank_sse2(const char *str, int n) {
+    __m128i v, m;
+    int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        v = _mm_loadu_si128((const __m128i *) (str + i));
+        m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+        if (_mm_movemask_epi8(m)) return 1;
+    }
+    return has_blank_scalar(str + i, n - i);
+}
+
+
+__attribute__((target("sse2"), no_sanitize_address))
+static int span_word_sse2(const char *str) {
+    const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 15);
+    unsigned mask, skip = str - p;
+    __m128i v, ws;
+
+    for (;; p += 16, skip = 0) {
+        v = _mm_load_si128((const __m128i *) p);
+        ws = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+        ws = _mm_or_si128(
+                _mm_cmpeq_epi8(_mm_min_epu8(ws, _mm_set1_epi8(4)), ws),
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                            _mm_cmpeq_epi8(v, _mm_setzero_si128())));
+        mask = (unsigned) _mm_movemask_epi8(ws) >> skip;
+        if (mask) return p + skip - str + __builtin_ctz(mask);
+    }
+}
+
+
+__attribute__((target("sse2"), no_sanitize_address))
+static int span_quoted_sse2(const char *str) {
+    const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 15);
+    unsigned mask, skip = str - p;
+    __m128i v;
+
+    for (;; p += 16, skip = 0) {
+        v = _mm_load_si128((const __m128i *) p);
+        mask = (unsigned) _mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')),
+                            _mm_cmpeq_epi8(v, _mm_setzero_si128()))) >> skip;
+        if (mask) return p + skip - str + __builtin_ctz(mask);
+    }
+}
+
+
+__attribute__((target("avx2")))
+static int is_hex_avx2(const char *str, int n) {
+    __m256i v, dig, hex;
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *) (str + i));
+        dig = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        hex = _mm256_sub_epi8(v, _mm256_set1_epi8('A'));
+        dig = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(dig, _mm256_set1_epi8(9)), dig),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(hex, _mm256_set1_epi8(5)), hex));
+        if (_mm256_movemask_epi8(dig) != -1) return 0;
+    }
+    return is_hex_sse2(str + i, n - i);
+}
+
+
+__attribute__((target("avx2")))
+static int has_blank_avx2(const char *str, int n) {
+    __m256i v, m;
+    int i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *) (str + i));
+        m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+        if (_mm256_movemask_epi8(m)) return 1;
+    }
+    return has_blank_sse2(str + i, n - i);
+}
+
+
+__attribute__((target("avx2"), no_sanitize_address))
+static int span_word_avx2(const char *str) {
+    const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 31);
+    unsigned mask, skip = str - p;
+    __m256i v, ws;
+
+    for (;; p += 32, skip = 0) {
+        v = _mm256_load_si256((const __m256i *) p);
+        ws = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+        ws = _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(ws, _mm256_set1_epi8(4)), ws),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_setzero_si256())));
+        mask = (unsigned) _mm256_movemask_epi8(ws) >> skip;
+        if (mask) return p + skip - str + __builtin_ctz(mask);
+    }
+}
+
+
+__attribute__((target("avx2"), no_sanitize_address))
+static int span_quoted_avx2(const char *str) {
+    const char *p = (const char *) ((uintptr_t) str & ~(uintptr_t) 31);
+    unsigned mask, skip = str - p;
+    __m256i v;
+
+    for (;; p += 32, skip = 0) {
+        v = _mm256_load_si256((const __m256i *) p);
+        mask = (unsigned) _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')),
+                            _mm256_cmpeq_epi8(v, _mm256_setzero_si256())))
+            >> skip;
+        if (mask) return p + skip - str + __builtin_ctz(mask);
+    }
+}
+
+#endif
+
+
+static int is_hex_pick(const char *str, int n);
+static int has_blank_pick(const char *str, int n);
+static int span_word_pick(const char *str);
+static int span_quoted_pick(const char *str);
+
+static LexCheck hex_fn = is_hex_pick;       /**< Selected hex check */
+static LexCheck blank_fn = has_blank_pick;      /**< Selected blank check */
+static LexSpan word_fn = span_word_pick;        /**< Selected word span */
+static LexSpan quoted_fn = span_quoted_pick;    /**< Selected quoted span */
+
+
+/**
+ * @brief Selects the kernels for this CPU.
+ */
+static void lex_pick(void) {
+
+    hex_fn = is_hex_scalar;
+    blank_fn = has_blank_scalar;
+    word_fn = span_word_scalar;
+    quoted_fn = span_quoted_scalar;
+
+#ifdef LEXX86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        hex_fn = is_hex_avx2;
+        blank_fn = has_blank_avx2;
+        word_fn = span_word_avx2;
+        quoted_fn = span_quoted_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        hex_fn = is_hex_sse2;
+        blank_fn = has_blank_sse2;
+        word_fn = span_word_sse2;
+        quoted_fn = span_quoted_sse2;
+    }
+#endif
+}
+
+
+static int is_hex_pick(const char *str, int n) {
+
+    lex_pick();
+    return hex_fn(str, n);
+}
+
+
+static int has_blank_pick(const char *str, int n) {
+
+    lex_pick();
+    return blank_fn(str, n);
+}
+
+
+static int span_word_pick(const char *str) {
+
+    lex_pick();
+    return word_fn(str);
+}
+
+
+static int span_quoted_pick(const char *str) {
+
+    lex_pick();
+    return quoted_fn(str);
+}
+
+
+int lex_is_hex(const char *str, int n) {
+
+    return hex_fn(str, n);
+}
+
+
+int lex_has_blank(const char *str, int n) {
+
+    return blank_fn(str, n);
+}
+
+
+int lex_span_word(const char *str) {
+
+    return word_fn(str);
+}
+
+
+int lex_span_quoted(const char *str) {
+
+    return quoted_fn(str);
+}
+
+
+char *lex_skip(char *in) {
+
+    while (is_space(*in)) in++;
+    return in;
+}
+
+
+int lex_word(char **in, char *dst) {
+    char *p = lex_skip(*in);
+    int n;
+
+    *in = p;
+    if (*p == '\0') return 0;
+
+    n = lex_span_word(p);
+    if (dst) {
+        memcpy(dst, p, n);
+        dst[n] = '\0';
+    }
+    *in = p + n;
+    return 1;
+}
+
+
+int lex_quoted(char **in, char *dst) {
+    char *p = lex_skip(*in);
+    int n;
+
+    if (*p != '"' || !(n = lex_span_quoted(p + 1))) return 0;
+
+    memcpy(dst, p + 1, n);
+    dst[n] = '\0';
+    *in = p + 1 + n;
+
+    if (**in != '"') return 1;
+    (*in)++;
+    return 2;
+}
+
+
+int lex_int(char **in, int *val) {
+    char *p = lex_skip(*in);
+    unsigned num = 0;
+    int neg = 0;
+
+    if (*p == '-' || *p == '+') neg = *p++ == '-';
+    if (*p < '0' || *p > '9') return 0;
+
+    while ('0' <= *p && *p <= '9') num = num * 10 + (*p++ - '0');
+
+    *val = (int) (neg ? 0u - num : num);
+    *in = p;
+    return 1;
+}
+
+
+int lex_char(char **in, char c) {
+
+    if (**in != c) return 0;
+    (*in)++;
+    return 1;
+}
+
+
+#ifdef LEXCHECK
+
+/*
+ * Self-check of the vector kernels: `gcc -DLEXCHECK -o lexcheck lex.c`
+ * builds a program that runs every kernel this CPU supports on random and
+ * boundary-length inputs, at every alignment, and compares the results with
+ * the scalar kernels.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define CHECKROUNDS     20000       /**< Random inputs per length   */
+#define CHECKROOM       256     /**< Bytes of the input buffer  */
+
+
+/**
+ * @struct LexKernels
+ * @brief One set of kernels.
+ */
+typedef struct {
+    const char *name;       /**< Instruction set    */
+    LexCheck hex, blank;        /**< Bounded checks */
+    LexSpan word, quoted;       /**< Spans  */
+} LexKernels;
+
+
+/** Bytes the inputs are made of (with the NUL that ends the literal) */
+static const char check_bytes[] = "0189AFafGg \t\n\v\f\r\"x,*\x80\xff";
+
+/** Lengths around the vector widths */
+static const int check_lens[] = {0, 1, 2, 15, 16, 17, 31, 32, 33, 47, 48,
+                                49, 63, 64, 65, 95, 96, 97};
+
+
+/**
+ * @brief Fills `n` bytes: random ones, or hex digits with one random byte
+ *          at the start or the end, or none.
+ */
+static void check_fill(char *p, int n, int mode) {
+    int i;
+
+    for (i = 0; i < n; i++)
+        p[i] = mode ? "0123456789ABCDEF"[rand() % 16] :
+                check_bytes[rand() % sizeof(check_bytes)];
+    if (n && mode == 1) p[0] = check_bytes[rand() % sizeof(check_bytes)];
+    if (n && mode == 2) p[n - 1] = check_bytes[rand() % sizeof(check_bytes)];
+}
+
+
+/**
+ * @brief Runs one set of kernels on an input and compares with the scalar
+ *          ones.
+ *
+ * @return Number of kernels that disagree.
+ */
+static int check_one(const LexKernels *k, char *p, int n) {
+    int bad = 0;
+
+    bad += k->hex(p, n) != is_hex_scalar(p, n);
+    bad += k->blank(p, n) != has_blank_scalar(p, n);
+
+    // The spans read up to a NUL, which may come before `n`
+    p[n] = '\0';
+    bad += k->word(p) != span_word_scalar(p);
+    bad += k->quoted(p) != span_quoted_scalar(p);
+    if (bad) fprintf(stderr, "lex: %s kernels disagree on %d bytes at "
+                    "offset %d\n", k->name, n, (int) ((uintptr_t) p % 64));
+    return bad;
+}
+
+
+int main(void) {
+    static char buf[CHECKROOM] __attribute__((aligned(64)));
+    LexKernels sets[2];
+    int nsets = 0, s, l, r, off, n, bad = 0;
+    long inputs = 0;
+
+#ifdef LEXX86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2")) {
+        sets[nsets].name = "sse2";
+        sets[nsets].hex = is_hex_sse2;
+        sets[nsets].blank = has_blank_sse2;
+        sets[nsets].word = span_word_sse2;
+        sets[nsets++].quoted = span_quoted_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        sets[nsets].name = "avx2";
+        sets[nsets].hex = is_hex_avx2;
+        sets[nsets].blank = has_blank_avx2;
+        sets[nsets].word = span_word_avx2;
+        sets[nsets++].quoted = span_quoted_avx2;
+    }
+#endif
+
+    srand(1);
+    for (s = 0; s < nsets && bad < 10; s++)
+        for (l = 0; l < (int) (sizeof(check_lens) / sizeof(int)) + 64; l++)
+            for (r = 0; r < CHECKROUNDS / 64 && bad < 10; r++) {
+                n = l < (int) (sizeof(check_lens) / sizeof(int)) ?
+                    check_lens[l] : rand() % 128;
+                off = rand() % 64;
+
+                // Random bytes around the input too: the spans read
+                // whole aligned blocks
+                check_fill(buf, CHECKROOM, 0);
+                check_fill(buf + off, n, rand() % 4);
+                bad += check_one(&sets[s], buf + off, n);
+                inputs++;
+            }
+
+    for (s = 0; s < nsets; s++) printf("%s ", sets[s].name);
+    printf("%s: %ld inputs, %s\n", nsets ? "kernels" : "no vector kernels",
+            inputs, bad ? "MISMATCH" : "all agree with the scalar ones");
+    return bad != 0;
+}
+
+#endif
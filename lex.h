@@ -0,0 +1,115 @@
+/**
+ * @file lex.h
+ * @brief Vectorized byte classification and field splitting for input lines.
+ *
+ * The kernels classify 32 (AVX2) or 16 (SSE2) bytes per instruction, with
+ * the instruction set picked at run time and a scalar fallback. The field
+ * readers on top of them follow the `sscanf` conversions the commands used
+ * (`%s`, `"%[^"]"`, `%d` and literal characters), so a line splits the same
+ * way it did before.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _LEX_H_
+#define _LEX_H_
+
+
+/**
+ * @brief Checks that every byte is an uppercase hexadecimal digit.
+ *
+ * @param str   The bytes to check.
+ * @param n     Number of bytes.
+ *
+ * @return 1 if all `n` bytes are in [0-9A-F], 0 otherwise.
+ */
+int lex_is_hex(const char *str, int n);
+
+
+/**
+ * @brief Checks for a space, tab or newline among some bytes.
+ *
+ * @param str   The bytes to check.
+ * @param n     Number of bytes.
+ *
+ * @return 1 if any of the `n` bytes is ' ', '\\t' or '\\n', 0 otherwise.
+ */
+int lex_has_blank(const char *str, int n);
+
+
+/**
+ * @brief Measures the run of bytes up to the next white-space character.
+ *
+ * @param str   NUL-terminated string.
+ *
+ * @return Number of bytes before the first white-space (as `isspace`) or NUL.
+ */
+int lex_span_word(const char *str);
+
+
+/**
+ * @brief Measures the run of bytes up to the next double quote.
+ *
+ * @param str   NUL-terminated string.
+ *
+ * @return Number of bytes before the first '"' or NUL.
+ */
+int lex_span_quoted(const char *str);
+
+
+/**
+ * @brief Skips white-space, like a blank in a `sscanf` format.
+ *
+ * @param in    NUL-terminated string.
+ *
+ * @return The first character of `in` that is not white-space.
+ */
+char *lex_skip(char *in);
+
+
+/**
+ * @brief Reads a white-space delimited field, like `%s`.
+ *
+ * @param in    Read position, advanced past the field.
+ * @param dst   Where to copy the field (NUL-terminated), or NULL to skip it.
+ *
+ * @return 1 if a field was read, 0 if the line ended first.
+ */
+int lex_word(char **in, char *dst);
+
+
+/**
+ * @brief Reads a double-quoted field, like `"%[^"]"`.
+ *
+ * @param in    Read position, advanced past what was read.
+ * @param dst   Where to copy the text between the quotes (NUL-terminated).
+ *
+ * @return 0 if there is no opening quote or the quotes are empty, 1 if the
+ *          text was read but the closing quote is missing, 2 otherwise.
+ */
+int lex_quoted(char **in, char *dst);
+
+
+/**
+ * @brief Reads a decimal integer, like `%d`.
+ *
+ * @param in    Read position, advanced past the number.
+ * @param val   Where to store the number.
+ *
+ * @return 1 if a number was read, 0 otherwise.
+ */
+int lex_int(char **in, int *val);
+
+
+/**
+ * @brief Matches one literal character.
+ *
+ * @param in    Read position, advanced past the character if it matches.
+ * @param c     The expected character.
+ *
+ * @return 1 if the next character is `c`, 0 otherwise.
+ */
+int lex_char(char **in, char c);
+
+#endif
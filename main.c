@@ -8,17 +8,31 @@
  * the management of vaccine batches, registration of users for vaccination and 
  * tracking of inoculations.
  * 
- * The program uses a hash table for quick lookup of inoculation records.
+ * Names are interned, and the inoculation records are also kept as columns 
+ * of integer IDs, which are searched with vector instructions. The records 
+ * may be split into shards by username, each kept by a worker thread.
+ * 
+ * The commands that change the system are run through the library interface 
+ * (vms.h); this file reads their arguments and prints their results.
  * 
  * The system's operations depend on user input provided through a command-line 
  * interface, with commands starting with specific characters:
  * - 'c' for introducing a new batch.
  * - 'l' for listing vaccine batches.
  * - 'a' for applying a vaccine to a user.
+ * - 'b' for applying a vaccine to many users.
  * - 'r' for disabling a batch.
  * - 'd' for deleting a vaccination record.
  * - 'u' for listing vaccination records.
+ * - 'i' for listing vaccination records applied in a date range.
+ * - 's' for reporting doses per vaccine, per batch or per day.
  * - 't' for changing or displaying the system's date.
+ * - 'e' for exporting the batches and vaccination records to files.
+ * - 'm' for importing batches and vaccination records from files.
+ * - 'k' for the batches expiring first and the users most vaccinated.
+ * - 'n' for listing the users in alphabetical order.
+ * - 'w' for listing who received a batch, for a recall.
+ * - 'p' for listing vaccination records or batches a page at a time.
  * 
  * @author ist1114493 (Tomás Gomes)
  * @date 2025
@@ -27,16 +41,74 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
 
 #include "errors.h"
 #include "system.h"
 #include "inoc.h"
 #include "vaccine.h"
-#include "hash.h"
+#include "intern.h"
+#include "stats.h"
 #include "date.h"
+#include "pipeline.h"
+#include "lex.h"
+#include "shard.h"
+#include "vms.h"
+#include "wire.h"
 
 
 #define BUFMAX      65535       /**< max. len. of input line    */
+#define TOPDEFAULT  10      /**< Entries shown by 'k' by default    */
+#define LISTPAGE    256     /**< Entries read per page by 'n' and 'w' */
+#define PREFIXUSERS 8       /**< max. users of a prefix listed one by one */
+
+
+/** 
+ * @brief Prints the message of an error status, in the system's language. 
+ * Running out of memory ends the program.
+ * 
+ * @param sys	system data
+ * @param status	status returned by the library
+ * @param name	    name the message refers to, for the errors about a name
+ */
+static void print_error(Sys *sys, int status, const char *name) {
+    int pt = sys->is_pt;
+
+    switch (status) {
+        case VMS_OK: break;
+        case VMS_ENOMEMORY: no_mem(sys); break;
+        case VMS_E2MANYVAC: pt ? puts(E2MANYVAC_PT): puts(E2MANYVAC_EN); break;
+        case VMS_EDUPBATCH: pt ? puts(EDUPBATCH_PT): puts(EDUPBATCH_EN); break;
+        case VMS_EINVBATCH: pt ? puts(EINVBATCH_PT): puts(EINVBATCH_EN); break;
+        case VMS_EINVNAME: pt ? puts(EINVNAME_PT): puts(EINVNAME_EN); break;
+        case VMS_EINVDATE: pt ? puts(EINVDATE_PT): puts(EINVDATE_EN); break;
+        case VMS_EINVQUANT: pt ? puts(EINVQUANT_PT): puts(EINVQUANT_EN); break;
+        case VMS_ENOSTOCK: pt ? puts(ENOSTOCK_PT): puts(ENOSTOCK_EN); break;
+        case VMS_EDOUBLEVAC: 
+            pt ? puts(EDOUBLEVAC_PT): puts(EDOUBLEVAC_EN); 
+            break;
+        case VMS_ENOVACINE:
+            printf("%s", name);
+            pt ? puts(ENOVACINE_PT): puts(ENOVACINE_EN);
+            break;
+        case VMS_ENOBATCH:
+            printf("%s", name);
+            pt ? puts(ENOBATCH_PT): puts(ENOBATCH_EN);
+            break;
+        case VMS_EINVUSER:
+            printf("%s", name);
+            pt ? puts(EINVUSER_PT): puts(EINVUSER_EN);
+            break;
+        case VMS_EFILE:
+            printf("%s", name);
+            pt ? puts(EFILE_PT): puts(EFILE_EN);
+            break;
+        case VMS_EINVCURSOR: 
+            pt ? puts(EINVCURSOR_PT): puts(EINVCURSOR_EN); 
+            break;
+    }
+}
 
 
 /** 
@@ -47,77 +119,120 @@
  */
 static void command_c(Sys *sys, char *in) {
     char batch[BUFMAX], name[BUFMAX];
-    int doses;
+    int doses, status;
     Date date;
 
     if (sys->nb == MAXBATCHES) {
-        sys->is_pt ? puts(E2MANYVAC_PT): puts(E2MANYVAC_EN); return;
+        print_error(sys, VMS_E2MANYVAC, NULL);
+        return;
     }
 
-    sscanf(in, "%*s %s %d-%d-%d %d %s", batch, &date.dd, &date.mm, &date.yy, 
-        &doses, name);
+    *batch = *name = '\0';
+    lex_word(&in, NULL);
+    if (lex_word(&in, batch) && date_read(&in, &date) == 3 && 
+        lex_int(&in, &doses))
+        lex_word(&in, name);
 
-    if (!verify_new_batch(sys->nb, batch, &sys->batches[0], sys->is_pt, name, 
-        sys->date, date, doses)) return;
+    status = vms_add_batch(sys, batch, date, doses, name);
+    if (status == VMS_OK) printf("%s\n", batch);
+    else print_error(sys, status, NULL);
+}
 
-    // Allocate and store batch information and check for memory failure
-    sys->batches[sys->nb].name = strdup(name);
-    sys->batches[sys->nb].batch = strdup(batch);
-    
-    if (!sys->batches[sys->nb].name || !sys->batches[sys->nb].batch) 
-        no_mem(sys);
 
-    sys->batches[sys->nb].expdate = date;
-    sys->batches[sys->nb].avdoses = doses;
-    sys->batches[sys->nb].apdoses = 0;
-    sys->nb++;
+/**
+ * @brief Lists the batches of the vaccines whose name starts with a prefix,
+ * in the order of 'l', from the table of batches by name.
+ *
+ * @param sys	system data
+ * @param prefix	the prefix (a filter of 'l' without its final '*')
+ * @param len	length of the prefix
+ */
+static void list_prefix(Sys *sys, const char *prefix, int len) {
+    Vaccine *match[MAXBATCHES];
+    int i, n = match_prefix(sys->byname, sys->nb, prefix, len, match);
+
+    if (n == -1) no_mem(sys);
+    for (i = 0; i < n; i++) print_l_vac(match[i]);
 
-    printf("%s\n", batch);
+    // A pattern that matches no batch is shown as it was given
+    if (!n) {
+        printf("%.*s*", len, prefix);
+        sys->is_pt ? puts(ENOVACINE_PT): puts(ENOVACINE_EN);
+    }
 }
 
 
 /** 
  * @brief Lists the vaccine batches in the system, optionally filtered by 
- * vaccine name.
+ * vaccine names or by name prefixes (name*). A quoted name ("name*") is
+ * never a prefix.
  *
  * @param sys	system data
  * @param in	input line with optional vaccine filter
  */
 static void command_l(Sys *sys, char *in) {
-    int i, batch_ex;
-    char *vac_name;
-
-    quicksort_batches(sys->batches, 0, sys->nb - 1);
+    const char *err = sys->is_pt ? ENOVACINE_PT "\n" : ENOVACINE_EN "\n";
+    char vac_name[BUFMAX], *p;
+    LText *list;
+    int i, vid, len, quoted;
 
     in += 2;
 
     /*if there is no vaccine filter - list all batches*/
     if (*in == '\n' || *in == '\0') {
-        for (i = 0; i < sys->nb; i ++)
-            print_l_vac(&sys->batches[i]);
+        list = lcache_get(&sys->lcache, -1);
+
+        // Render the listing again only after a batch changed
+        if (!list->valid) {
+            if (sort_batches(sys->batches, sys->nb)) no_mem(sys);
+            for (i = 0, list->len = 0; i < sys->nb; i++)
+                if (ltext_format(list, format_l_vac, sys->batches, i)) 
+                    no_mem(sys);
+            list->valid = 1;
+        }
+        if (list->len) fwrite(list->text, 1, list->len, stdout);
         return;
     }
 
     /*if there is a vaccine filter - process each filter*/
-    vac_name = strtok(in, " \t\n");
-    while (vac_name) {
-        batch_ex = 0;
-
-        // Search for matching batches and print them
-        for (i = 0; i < sys->nb; i++) {
-            if (!strcmp(sys->batches[i].name, vac_name)) {
-                batch_ex = 1;
-                print_l_vac(&sys->batches[i]);
-            }
+    for (;;) {
+
+        // A quoted name is taken as it is, never as a pattern
+        p = in;
+        if (!(quoted = lex_quoted(&p, vac_name) == 2)) {
+            p = in;
+            if (!lex_word(&p, vac_name)) break;
         }
+        in = p;
 
-        if (!batch_ex) {
-            printf("%s", vac_name);
-            sys->is_pt ? puts(ENOVACINE_PT): puts(ENOVACINE_EN);
+        len = strlen(vac_name);
+        if (!quoted && vac_name[len - 1] == '*') {
+            list_prefix(sys, vac_name, len - 1);
+            continue;
         }
+        vid = intern_find(&sys->vacnames, vac_name);
 
-        // Process the next vaccine name in the filter
-        vac_name = strtok(NULL, " \t\n");
+        // A name never seen has no batches
+        if (vid == -1) {
+            printf("%s", vac_name);
+            fputs(err, stdout);
+            continue;
+        }
+        if (!(list = lcache_get(&sys->lcache, vid))) no_mem(sys);
+
+        // Render the vaccine's batches, or the error if there are none
+        if (!list->valid) {
+            if (sort_batches(sys->batches, sys->nb)) no_mem(sys);
+            for (i = 0, list->len = 0; i < sys->nb; i++)
+                if (sys->batches[i]->vid == vid && 
+                    ltext_format(list, format_l_vac, sys->batches, i)) 
+                    no_mem(sys);
+
+            if (!list->len && (ltext_add(list, vac_name, strlen(vac_name)) ||
+                ltext_add(list, err, strlen(err)))) no_mem(sys);
+            list->valid = 1;
+        }
+        if (list->len) fwrite(list->text, 1, list->len, stdout);
     }
 }
 
@@ -130,39 +245,70 @@ static void command_l(Sys *sys, char *in) {
  */
 static void command_a(Sys *sys, char *in) {
     char username[BUFMAX], vac_name[BUFMAX];
-    Inoc *new_inocs;
-    Vaccine *temp;
-    
-    if(sscanf(in, "%*s \"%[^\"]\" %s", username, vac_name) != 2) 
-        sscanf(in, "%*s %s %s", username, vac_name);
-           
-    if (dup_inoc(username, vac_name, &sys->hash, sys->inocs, sys->date, 
-        sys->is_pt)) return;
-
-    // Reallocate memory for inoculations if necessary, checking for mem failure
-    new_inocs = inoc_realloc(sys->ni, &sys->incocCap, sys->inocs);
-    new_inocs ? sys->inocs = new_inocs : no_mem(sys);
-
-    // Sorts and removes vac from system, checking for stock
-    quicksort_batches(sys->batches, 0, sys->nb - 1);
-    temp = aplly_bacth(sys->nb, &sys->batches[0], vac_name);
+    const char *batch;
+    char *p;
+    int status;
     
-    if (!temp) { 
-        sys->is_pt ? puts(ENOSTOCK_PT): puts(ENOSTOCK_EN); 
-        return;
+    *username = *vac_name = '\0';
+    lex_word(&in, NULL);
+    p = in;
+    if (lex_quoted(&p, username) != 2 || !lex_word(&p, vac_name)) {
+        p = in;
+        lex_word(&p, username);
+        lex_word(&p, vac_name);
     }
 
-    // Add the new inoculation to the system, checking for mem failure
-    sys->inocs[sys->ni].user = strdup(username);
-    if (!sys->inocs[sys->ni].user) no_mem(sys);
-    
-    sys->inocs[sys->ni].vaccine = temp;
-    sys->inocs[sys->ni].apdate = sys->date;
-    
-    // Insert the inoculation record into the hash table
-    hash_insert(&sys->hash, hash_get_key(username), sys->ni);
+    status = vms_apply(sys, username, vac_name, &batch);
+    if (status == VMS_OK) puts(batch);
+    else print_error(sys, status, NULL);
+}
+
 
-    sys->ni++;
+/** 
+ * @brief Applies a vaccine to many users, printing what 'a' would print for 
+ * each of them in turn.
+ *
+ * @param sys	system data
+ * @param in	input line with the vaccine name and the usernames
+ */
+static void command_b(Sys *sys, char *in) {
+    char vac_name[BUFMAX], *names, *p, *q;
+    const char **users, **batches;
+    int k, n, *status;
+
+    // A line holds at most BUFMAX / 2 users, and their names fit in it
+    names = (char *) malloc(BUFMAX + 1);
+    users = (const char **) malloc((BUFMAX / 2 + 1) * sizeof(char *));
+    batches = (const char **) malloc((BUFMAX / 2 + 1) * sizeof(char *));
+    status = (int *) malloc((BUFMAX / 2 + 1) * sizeof(int));
+    if (!names || !users || !batches || !status) no_mem(sys);
+
+    *vac_name = '\0';
+    lex_word(&in, NULL);
+    lex_word(&in, vac_name);
+
+    // Each username is quoted, or a single word
+    for (n = 0, p = names; ; n++) {
+        q = in;
+        if (lex_quoted(&q, p) != 2) {
+            q = in;
+            if (!lex_word(&q, p)) break;
+        }
+        in = q;
+        users[n] = p;
+        p += strlen(p) + 1;
+    }
+
+    if (vms_apply_bulk(sys, vac_name, users, n, batches, status)) no_mem(sys);
+    for (k = 0; k < n; k++) {
+        if (status[k] == VMS_OK) puts(batches[k]);
+        else print_error(sys, status[k], NULL);
+    }
+
+    free(names);
+    free(users);
+    free(batches);
+    free(status);
 }
 
 
@@ -173,41 +319,16 @@ static void command_a(Sys *sys, char *in) {
  * @param in	input line containing the batch ID to be disabled
  */
 static void command_r(Sys *sys, char *in) {
-    char batch[MAXBATCHNAME];
-    int i, j, has_batch;
-
-    sscanf(in, "%*s %s", batch);
-
-    // Look for the batch in the system
-    for (i = 0, has_batch = 0; i < sys->nb && !has_batch; i++) {
-        
-        // Check if the batch exists
-        if (!strcmp(batch, sys->batches[i].batch)) {
-            has_batch = 1;
-            printf("%d\n", sys->batches[i].apdoses);
-
-            // If the batch has doses applied, disable
-            if (sys->batches[i].apdoses > 0)
-                sys->batches[i].avdoses = 0;
-
-            // Remove the batch completely if no doses are applied
-            else { 
-                free(sys->batches[i].batch);
-                free(sys->batches[i].name);
-
-                for (j = i; j < sys->nb; j++) {
-                    sys->batches[j] = sys->batches[j+1];
-
-                }
-                sys->nb--;
-            }
-        }
-    }
+    char batch[BUFMAX];
+    int apdoses, status;
 
-    if (!has_batch) {
-        printf("%s", batch);
-        sys->is_pt ? puts(ENOBATCH_PT): puts(ENOBATCH_EN);
-    }
+    *batch = '\0';
+    lex_word(&in, NULL);
+    lex_word(&in, batch);
+
+    status = vms_remove_batch(sys, batch, &apdoses);
+    if (status == VMS_OK) printf("%d\n", apdoses);
+    else print_error(sys, status, batch);
 }
 
 
@@ -219,75 +340,185 @@ static void command_r(Sys *sys, char *in) {
  *              to delete the record
  */
 static void command_d(Sys *sys, char *in) {
-    int is_batch = 1, read_date = 0, read_batch = 0, val_date = 1, 
-        narg, deletion;
-    char username[BUFMAX], batch[MAXBATCHNAME];
+    int narg, removed, quoted, status;
+    char username[BUFMAX], batch[BUFMAX];
     Date date;
     
-    // Check for opptional paramethers and set according variables
-    if (*(in+2) == '\"')
-        narg = sscanf(in, "%*s \"%[^\"]\" %d-%d-%d %s", username, &date.dd, 
-                        &date.mm, &date.yy, batch);
-    else
-        narg = sscanf(in, "%*s %s %d-%d-%d %s", username, &date.dd, &date.mm, 
-                        &date.yy, batch);
-
-    if (narg >= 4) {
-        if (!is_date_valid(sys->date, date, 1)) val_date = 0;
-        read_date = 1;
-
-        if (narg == 5) {
-            read_batch = 1;
-            is_batch = 0;
-        }
+    // Check for opptional paramethers
+    *username = '\0';
+    quoted = *(in+2) == '\"';
+    lex_word(&in, NULL);
+    narg = quoted ? lex_quoted(&in, username) : lex_word(&in, username);
+
+    if (narg == 2 || (!quoted && narg == 1)) {
+        narg = 1 + date_read(&in, &date);
+        if (narg == 4) narg += lex_word(&in, batch);
     }
 
-    // Delete the inoculation record
-    deletion = inoc_del(username, batch, &sys->hash, sys->inocs, read_date, 
-                        read_batch, val_date, date, sys->ni, is_batch, 
-                        sys->is_pt);
-    
-    // Stop if error found
-    if (deletion == -1) return;
+    // The user's shard worker may delete the records and show the number
+    // of deletions in place
+    status = vms_delete_defer(sys, username, narg >= 4 ? &date : NULL, 
+                            narg == 5 ? batch : NULL);
+    if (status == -1) no_mem(sys);
+    if (status == 1) return;
+
+    // Delete the inoculation records and show the number of deletions
+    status = vms_delete(sys, username, narg >= 4 ? &date : NULL, 
+                        narg == 5 ? batch : NULL, &removed);
+    if (status == VMS_OK) printf("%d\n", removed);
+    else print_error(sys, status, status == VMS_ENOBATCH ? batch : username);
+}
+
+
+/** 
+ * @brief Lists the inoculations of the users whose name starts with a 
+ * prefix, user by user in alphabetical order.
+ * 
+ * The users are found in the ordered index of the usernames. A few of them
+ * are listed one by one from their shards; more are listed by one pass 
+ * over every shard.
+ * 
+ * @param sys	 system data
+ * @param pattern the prefix, followed by '*'
+ * @param len	 length of the prefix
+ */
+static void list_users(Sys *sys, const char *pattern, size_t len) {
+    const char *name, *users[PREFIXUSERS];
+    int uid, n = 0, i;
+    NameIter it;
+
+    if (vms_settle(sys) || names_sync(&sys->names, &sys->usernames))
+        no_mem(sys);
+    names_find(&sys->names, pattern, len, &it);
 
-    // Update the total number of inoculations and show number of delitions
-    sys->ni -= deletion;
-    printf("%d\n", deletion);
+    // Find the users with records, up to one more than listed one by one
+    while (n <= PREFIXUSERS && (name = names_next(&it))) {
+        uid = intern_find(&sys->usernames, name);
+        if (!rank_count(&sys->rank, uid)) continue;
+        if (n++ < PREFIXUSERS) users[n - 1] = name;
+    }
+
+    if (!n) {
+        printf("%s", pattern);
+        sys->is_pt ? puts(EINVUSER_PT): puts(EINVUSER_EN);
+    }
+    else if (n > PREFIXUSERS) {
+        if (shard_list_prefix(sys->shards, sys->nshards, &sys->lister, 
+            pattern, len)) no_mem(sys);
+    }
+    else for (i = 0; i < n; i++) {
+        uid = intern_find(&sys->usernames, users[i]);
+        if (shard_list_user(&sys->shards[shard_of(users[i], sys->nshards)],
+            &sys->lister, uid, users[i], sys->is_pt)) no_mem(sys);
+    }
 }
 
 
 /** 
- * @brief Lists inoculations for a specific user or all users.
+ * @brief Lists inoculations for a specific user or all users; an unquoted 
+ * username ending in '*' lists every user whose name starts with the rest.
  * 
  * @param sys	system data
  * @param in	input line with the optional username filter
  */
 static void command_u(Sys *sys, char *in) {
-    int i, is_user = 0;
-    char username[BUFMAX];
+    char username[BUFMAX], *p;
+    size_t len;
+    int uid;
 
     // Check if a username is provided
-    if(sscanf(in, "%*s \"%[^\"]\"", username) != 1) {
-        if (sscanf(in, "%*s %s", username) != 1) {
+    lex_word(&in, NULL);
+    p = in;
+    if (!lex_quoted(&p, username)) {
+        p = in;
+        if (!lex_word(&p, username)) {
 
             // If no username, print all inoculations
-            for (i = 0; i < sys->ni; i++)
-                print_l_inoc(&sys->inocs[i]);
+            if (shard_list(sys->shards, sys->nshards, &sys->lister, NULL, 
+                NULL, NULL)) no_mem(sys);
             return;
         }
-    }    
 
-    // Search for the inoculations of the given user
-    for (i = 0; i < sys->ni; i++)
-        if (!strcmp(username, sys->inocs[i].user)) {
-            is_user = 1;
-            print_l_inoc(&sys->inocs[i]);
+        // A pattern lists the inoculations of every user it matches
+        len = strlen(username);
+        if (username[len - 1] == '*') {
+            list_users(sys, username, len - 1);
+            return;
         }
-    
-    if (!is_user) {
+    }    
+
+    // The user's shard lists the user's inoculations
+    uid = intern_find(&sys->usernames, username);
+    if (uid == -1) {
         printf("%s", username);
         sys->is_pt ? puts(EINVUSER_PT): puts(EINVUSER_EN);
-    } 
+    }
+    else if (shard_list_user(&sys->shards[shard_of(username, sys->nshards)], 
+            &sys->lister, uid, username, sys->is_pt)) no_mem(sys);
+}
+
+
+/** 
+ * @brief Lists the inoculations applied between two dates (inclusive), 
+ * optionally only those of a vaccine or of a batch.
+ * 
+ * @param sys	system data
+ * @param in	input line with the first and last dates and the optional 
+ *              vaccine name or batch ID
+ */
+static void command_i(Sys *sys, char *in) {
+    char filter[BUFMAX];
+    int i, narg, is_filter = 0;
+    Date from, to;
+
+    lex_word(&in, NULL);
+    narg = date_read(&in, &from);
+    if (narg == 3) narg += date_read(&in, &to);
+    if (narg == 6) narg += lex_word(&in, filter);
+
+    if (narg < 6 || !is_day_valid(from) || !is_day_valid(to) || 
+        compare_dates(from, to) == -1) {
+        sys->is_pt ? puts(EINVDATE_PT): puts(EINVDATE_EN);
+        return;
+    }
+
+    // The filter must name a vaccine or a batch known to the system
+    for (i = 0; narg == 7 && i < sys->nb && !is_filter; i++)
+        is_filter = !strcmp(filter, sys->batches[i]->name) || 
+                    !strcmp(filter, sys->batches[i]->batch);
+
+    if (narg == 7 && !is_filter) {
+        printf("%s", filter);
+        sys->is_pt ? puts(ENOVACINE_PT): puts(ENOVACINE_EN);
+        return;
+    }
+
+    if (shard_list(sys->shards, sys->nshards, &sys->lister, &from, &to, 
+        is_filter ? filter : NULL)) no_mem(sys);
+}
+
+
+/** 
+ * @brief Reports the doses on file per vaccine ('v', the default), per batch 
+ * ('b') or per day ('d'), from counters kept up to date by 'a' and 'd'.
+ * 
+ * @param sys	system data
+ * @param in	input line with the optional report kind
+ */
+static void command_s(Sys *sys, char *in) {
+    char kind = 'v';
+
+    lex_word(&in, NULL);
+    if (*lex_skip(in)) kind = *lex_skip(in);
+
+    switch (kind) {
+        case 'b':
+            if (sort_batches(sys->batches, sys->nb)) no_mem(sys);
+            stats_print_batch(sys->batches, sys->nb);
+            break;
+        case 'd': stats_print_day(&sys->stats); break;
+        default: stats_print_vac(&sys->stats, &sys->vacnames); break;
+    }
 }
 
 
@@ -299,17 +530,322 @@ static void command_u(Sys *sys, char *in) {
  */
 static void command_t(Sys *sys, char *in) {
     Date in_date;
+    int status;
 
-    if (sscanf(in, "%*s %d-%d-%d", &in_date.dd, &in_date.mm, &in_date.yy)==3) {       
-        if (!is_date_valid(sys->date, in_date, 0)) {
-            sys->is_pt ? puts(EINVDATE_PT): puts(EINVDATE_EN);
-            return;
-        }
-        sys->date = in_date;        // Update the system date if valid
+    lex_word(&in, NULL);
+    if (date_read(&in, &in_date) == 3) {
+        status = vms_set_date(sys, in_date);
+        if (status != VMS_OK) { print_error(sys, status, NULL); return; }
     }
 
     // Print the current system date
-    printf("%02d-%02d-%d\n", sys->date.dd, sys->date.mm, sys->date.yy);
+    in_date = vms_get_date(sys);
+    printf("%02d-%02d-%d\n", in_date.dd, in_date.mm, in_date.yy);
+}
+
+
+/** 
+ * @brief Exports the batches and the inoculations to `<path>-batches` and 
+ * `<path>-inocs`, as CSV or, with 'b', in the columnar format (export.h), 
+ * and shows the number of batches and inoculations exported.
+ *
+ * @param sys	system data
+ * @param in	input line with the path and the optional format
+ */
+static void command_e(Sys *sys, char *in) {
+    char path[BUFMAX], kind[BUFMAX], *p;
+    int status;
+    long ninocs;
+
+    *path = *kind = '\0';
+    lex_word(&in, NULL);
+    p = in;
+    if (lex_quoted(&p, path) != 2) {
+        p = in;
+        lex_word(&p, path);
+    }
+    lex_word(&p, kind);
+
+    status = vms_export(sys, path, !strcmp(kind, "b"), &ninocs);
+    if (status == VMS_OK) printf("%d %ld\n", sys->nb, ninocs);
+    else print_error(sys, status, path);
+}
+
+
+/** 
+ * @brief Shows the batches with doses available that expire first ('b', the
+ * default) or the users with the most inoculations ('u'), up to K of them.
+ *
+ * @param sys	system data
+ * @param in	input line with the optional kind and K
+ */
+static void command_k(Sys *sys, char *in) {
+    int k = TOPDEFAULT, room, n, i, status;
+    char kind = 'b';
+    VmsBatch *batches = NULL;
+    VmsUser *users = NULL;
+
+    lex_word(&in, NULL);
+    in = lex_skip(in);
+    if (*in == 'b' || *in == 'u') kind = *in++;
+    if (*lex_skip(in) && !lex_int(&in, &k)) k = 0;
+
+    // There are never more entries than batches or users
+    room = kind == 'b' ? sys->nb : sys->usernames.n;
+    if (room > k) room = k;
+    if (room < 1) room = 1;
+
+    if (kind == 'b') {
+        if (!(batches = (VmsBatch *) malloc(room * sizeof(VmsBatch))))
+            no_mem(sys);
+        status = vms_top_stock(sys, k, batches, &n);
+        for (i = 0; status == VMS_OK && i < n; i++)
+            printf(LVACFMT, batches[i].name, batches[i].batch, 
+                    batches[i].expdate.dd, batches[i].expdate.mm, 
+                    batches[i].expdate.yy, batches[i].avdoses, 
+                    batches[i].apdoses);
+    }
+    else {
+        if (!(users = (VmsUser *) malloc(room * sizeof(VmsUser))))
+            no_mem(sys);
+        status = vms_top_users(sys, k, users, &n);
+        for (i = 0; status == VMS_OK && i < n; i++)
+            printf("%s %d\n", users[i].user, users[i].ninocs);
+    }
+
+    free(batches);
+    free(users);
+    print_error(sys, status, NULL);
+}
+
+
+/** 
+ * @brief Lists the users with inoculations on file and how many, in 
+ * alphabetical order, optionally only those whose name starts with a 
+ * prefix.
+ *
+ * @param sys	system data
+ * @param in	input line with the optional prefix
+ */
+static void command_n(Sys *sys, char *in) {
+    char prefix[BUFMAX], *p;
+    VmsUser page[LISTPAGE];
+    long cursor = 0;
+    int n, i;
+
+    *prefix = '\0';
+    lex_word(&in, NULL);
+    p = in;
+    if (!lex_quoted(&p, prefix)) {
+        p = in;
+        lex_word(&p, prefix);
+    }
+
+    while (cursor != -1) {
+        if (vms_list_users(sys, prefix, &cursor, page, LISTPAGE, &n))
+            no_mem(sys);
+        for (i = 0; i < n; i++) printf("%s %d\n", page[i].user, 
+                                        page[i].ninocs);
+    }
+}
+
+
+/** 
+ * @brief Lists the inoculations of a batch, for a recall, in order of 
+ * application, as 'u' shows them.
+ *
+ * @param sys	system data
+ * @param in	input line with the batch ID
+ */
+static void command_w(Sys *sys, char *in) {
+    char batch[BUFMAX];
+    VmsInoc page[LISTPAGE];
+    long cursor = 0;
+    int n, i, status = VMS_OK;
+
+    *batch = '\0';
+    lex_word(&in, NULL);
+    lex_word(&in, batch);
+
+    while (cursor != -1 && status == VMS_OK) {
+        status = vms_recall(sys, batch, &cursor, page, LISTPAGE, &n);
+        for (i = 0; i < n; i++)
+            printf(LINOCFMT, page[i].user, page[i].batch, page[i].date.dd,
+                    page[i].date.mm, page[i].date.yy);
+    }
+    print_error(sys, status, batch);
+}
+
+
+/** 
+ * @brief Reads a cursor: a non-negative decimal number.
+ * 
+ * @param in	read position, advanced past the cursor
+ * @param cursor	where to store the cursor
+ * 
+ * @return      1 if a cursor was read, 0 otherwise
+ */
+static int read_cursor(char **in, long *cursor) {
+    char *p = lex_skip(*in);
+
+    if (*p < '0' || *p > '9') return 0;
+    for (*cursor = 0; '0' <= *p && *p <= '9' && *cursor <= LONG_MAX / 10; )
+        *cursor = *cursor * 10 + (*p++ - '0');
+    *in = p;
+    return *p == '\0' || *p == ' ' || *p == '\t' || *p == '\n';
+}
+
+
+/** 
+ * @brief Shows a page of inoculations, as 'u' shows them ('u', the 
+ * default), or of batches, as 'l' shows them ('l'), then the cursor of the 
+ * next page ("next <cursor>", or "next -" after the last page).
+ * 
+ * A page starts at cursor 0, or at the cursor shown after the previous 
+ * one; cursors keep their place when records or batches change, so a long 
+ * listing can be read in slices between other commands.
+ *
+ * @param sys	system data
+ * @param in	input line with the optional kind, the number of rows, the
+ *              optional cursor and the optional username (for 'u') or 
+ *              vaccine name or pattern (for 'l')
+ */
+static void command_p(Sys *sys, char *in) {
+    char filter[BUFMAX], kind = 'u', *p;
+    VmsBatch *batches = NULL;
+    VmsInoc *inocs = NULL;
+    int max, n, i, status, quoted;
+    long cursor = 0, room;
+
+    lex_word(&in, NULL);
+    in = lex_skip(in);
+    if ((*in == 'u' || *in == 'l') && (in[1] == ' ' || in[1] == '\t'))
+        kind = *in++;
+    if (!lex_int(&in, &max) || max <= 0) {
+        sys->is_pt ? puts(EINVQUANT_PT): puts(EINVQUANT_EN);
+        return;
+    }
+    if (*lex_skip(in) && !read_cursor(&in, &cursor)) {
+        sys->is_pt ? puts(EINVCURSOR_PT): puts(EINVCURSOR_EN);
+        return;
+    }
+
+    // A page never holds more than every batch or every record
+    room = kind == 'l' ? sys->nb : sys->seq;
+    if (max > room) max = room > 0 ? (int) room : 1;
+
+    // The filter: a username or a vaccine name (maybe quoted) or pattern
+    *filter = '\0';
+    p = in;
+    if (!(quoted = lex_quoted(&p, filter))) {
+        p = in;
+        lex_word(&p, filter);
+    }
+
+    if (kind == 'l') {
+        if (!(batches = (VmsBatch *) malloc(max * sizeof(VmsBatch))))
+            no_mem(sys);
+        status = vms_list_batches(sys, *filter ? filter : NULL, quoted,
+                                &cursor, batches, max, &n);
+        for (i = 0; status == VMS_OK && i < n; i++)
+            printf(LVACFMT, batches[i].name, batches[i].batch, 
+                    batches[i].expdate.dd, batches[i].expdate.mm, 
+                    batches[i].expdate.yy, batches[i].avdoses, 
+                    batches[i].apdoses);
+    }
+    else {
+        if (!(inocs = (VmsInoc *) malloc(max * sizeof(VmsInoc))))
+            no_mem(sys);
+        status = vms_list_inocs(sys, *filter ? filter : NULL, &cursor, 
+                                inocs, max, &n);
+        for (i = 0; status == VMS_OK && i < n; i++)
+            printf(LINOCFMT, inocs[i].user, inocs[i].batch, 
+                    inocs[i].date.dd, inocs[i].date.mm, inocs[i].date.yy);
+    }
+    free(batches);
+    free(inocs);
+
+    if (status != VMS_OK) print_error(sys, status, filter);
+    else if (cursor == -1) puts("next -");
+    else printf("next %ld\n", cursor);
+}
+
+
+/**
+ * @brief Shows a row rejected by the import, after its file and line
+ * (`VmsRejectFn`).
+ */
+static void reject_row(void *ctx, const char *file, long line, int status,
+                        const char *name) {
+
+    printf("%s:%ld: ", file, line);
+    print_error((Sys *) ctx, status, name);
+}
+
+
+/** 
+ * @brief Imports batches and inoculations from `<path>-batches.csv` and 
+ * `<path>-inocs.csv`, showing the rows rejected and then the number of 
+ * batches and inoculations imported.
+ *
+ * @param sys	system data
+ * @param in	input line with the path
+ */
+static void command_m(Sys *sys, char *in) {
+    char path[BUFMAX], *p;
+    int status, nbatches;
+    long ninocs;
+
+    *path = '\0';
+    lex_word(&in, NULL);
+    p = in;
+    if (lex_quoted(&p, path) != 2) {
+        p = in;
+        lex_word(&p, path);
+    }
+
+    status = vms_import(sys, path, reject_row, sys, &nbatches, &ninocs);
+    if (status == VMS_OK) printf("%d %ld\n", nbatches, ninocs);
+    else print_error(sys, status, path);
+}
+
+
+/** 
+ * @brief Executes one input command.
+ * 
+ * @param ctx	system data
+ * @param buf	input line with the command
+ * 
+ * @return      0 if the command was 'q' (quit), 1 otherwise
+ */
+static int command(void *ctx, char *buf) {
+    Sys *sys = (Sys *) ctx;
+
+    // Deletions left to the shard workers are accounted for before any
+    // command that may read what they change
+    if (buf[0] != 'a' && buf[0] != 'd' && buf[0] != 'u' && vms_settle(sys))
+        no_mem(sys);
+
+    switch (buf[0]) {
+        case 'q': return 0;                         // Stop reading commands
+        case 'c': command_c(sys, buf); break;       // Add a new batch
+        case 'l': command_l(sys, buf); break;       // List batches
+        case 'a': command_a(sys, buf); break;       // Apply a vaccine
+        case 'b': command_b(sys, buf); break;       // Apply to many users
+        case 'r': command_r(sys, buf); break;       // Disable a batch
+        case 'd': command_d(sys, buf); break;       // Delete inoculations
+        case 'u': command_u(sys, buf); break;       // List inoculations
+        case 'i': command_i(sys, buf); break;       // Inoculations by date
+        case 's': command_s(sys, buf); break;       // Dose counters
+        case 't': command_t(sys, buf); break;       // Set or display date
+        case 'e': command_e(sys, buf); break;       // Export to files
+        case 'm': command_m(sys, buf); break;       // Import from files
+        case 'k': command_k(sys, buf); break;       // Top-K queries
+        case 'n': command_n(sys, buf); break;       // Users in order
+        case 'w': command_w(sys, buf); break;       // Recall a batch
+        case 'p': command_p(sys, buf); break;       // Listings by pages
+    }
+    return 1;
 }
 
 
@@ -317,7 +853,9 @@ static void command_t(Sys *sys, char *in) {
  * @brief Main entry point of the program.
  * 
  * The function initializes the system, processes input commands and calls 
- * corresponding functions.
+ * corresponding functions. Scripted runs (input from a file or a pipe) are 
+ * processed by a reader/executor/writer pipeline; interactive runs read one 
+ * line at a time. With "-b" the input is in the binary protocol instead.
  * 
  * @param argc	number of command-line arguments
  * @param argv	array of command-line arguments
@@ -327,17 +865,22 @@ static void command_t(Sys *sys, char *in) {
 int main(int argc, char *argv[]) {
     char buf[BUFMAX+1];
     Sys sys = sys_ini(argc, argv); // Initialize system
+
+    // Binary clients get the same commands through the library interface
+    if (sys.is_wire) {
+        wire_run(STDIN_FILENO, STDOUT_FILENO, &sys);
+        free_mem(&sys);
+        return 0;
+    }
     
-    // Loop to process input commands
-    while (fgets(buf, BUFMAX+1, stdin))
-		switch (buf[0]) {
-			case 'q': free_mem(&sys); return 0;         // Free memory and exit
-			case 'c': command_c(&sys, buf); break;      // Add a new batch
-			case 'l': command_l(&sys, buf); break;      // List batches
-			case 'a': command_a(&sys, buf); break;      // Apply a vaccine
-			case 'r': command_r(&sys, buf); break;      // Disable a batch
-			case 'd': command_d(&sys, buf); break;      // Delete inoculations
-			case 'u': command_u(&sys, buf); break;      // List inoculations
-			case 't': command_t(&sys, buf); break;      // Set or display date
-		}
-}
\ No newline at end of file
+    // Overlap reading, execution and output when input is not a terminal
+    if (isatty(STDIN_FILENO) || pipeline_run(STDIN_FILENO, STDOUT_FILENO, 
+        BUFMAX, command, &sys) == -1) {
+
+        // Loop to process input commands
+        while (fgets(buf, BUFMAX+1, stdin) && command(&sys, buf));
+    }
+
+    free_mem(&sys);         // Free memory and exit
+    return 0;
+}
@@ -0,0 +1,155 @@
+/**
+ * @file names.c
+ * @brief Usernames in alphabetical order, for prefix searches.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "names.h"
+#include "par.h"
+
+
+/**
+ * @brief Sort order of the names.
+ */
+static int compare_names(const void *a, const void *b) {
+
+    return strcmp((const char *) a, (const char *) b);
+}
+
+
+/**
+ * @brief First position in `list[lo, hi)` whose name's first `len` bytes
+ * compare `>= after` to the prefix (0 for the start of the range, 1 for its
+ * end).
+ */
+static int find_prefix(char **list, int lo, int hi, const char *prefix,
+                        size_t len, int after) {
+    int mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strncmp(list[mid], prefix, len) < after) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+NameIndex names_ini(void) {
+    NameIndex idx;
+
+    idx.sorted = idx.delta = NULL;
+    idx.n = idx.nd = idx.known = 0;
+    return idx;
+}
+
+
+void names_free(NameIndex *idx) {
+
+    free(idx->sorted);
+    free(idx->delta);
+    *idx = names_ini();
+}
+
+
+/**
+ * @brief Sorts the delta and the new names together and merges them into
+ * the array.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int names_merge(NameIndex *idx, Intern *tab) {
+    int nnew = idx->nd + tab->n - idx->known, i = 0, j = 0, k = 0, uid;
+    char **fresh = (char **) malloc(nnew * sizeof(char *));
+    char **merged = (char **) malloc((idx->n + nnew) * sizeof(char *));
+
+    if (!fresh || !merged) {
+        free(fresh);
+        free(merged);
+        return -1;
+    }
+
+    if (idx->nd) memcpy(fresh, idx->delta, idx->nd * sizeof(char *));
+    for (uid = idx->known, k = idx->nd; uid < tab->n; uid++)
+        fresh[k++] = tab->str[uid];
+    if (par_sort((void **) fresh, nnew, compare_names)) {
+        free(fresh);
+        free(merged);
+        return -1;
+    }
+
+    for (k = 0; i < idx->n || j < nnew; k++)
+        merged[k] = j == nnew || (i < idx->n &&
+                    strcmp(idx->sorted[i], fresh[j]) < 0) ?
+                    idx->sorted[i++] : fresh[j++];
+
+    free(idx->sorted);
+    free(fresh);
+    idx->sorted = merged;
+    idx->n += nnew;
+    idx->nd = 0;
+    idx->known = tab->n;
+    return 0;
+}
+
+
+int names_sync(NameIndex *idx, Intern *tab) {
+    int at;
+
+    if (idx->known == tab->n) return 0;
+    if (idx->nd + tab->n - idx->known > NAMEDELTA)
+        return names_merge(idx, tab);
+
+    if (!idx->delta &&
+        !(idx->delta = (char **) malloc(NAMEDELTA * sizeof(char *))))
+        return -1;
+
+    // A few new names: each one is inserted into the delta
+    for (; idx->known < tab->n; idx->known++) {
+        at = find_prefix(idx->delta, 0, idx->nd, tab->str[idx->known],
+                        strlen(tab->str[idx->known]) + 1, 0);
+        memmove(idx->delta + at + 1, idx->delta + at,
+                (idx->nd - at) * sizeof(char *));
+        idx->delta[at] = tab->str[idx->known];
+        idx->nd++;
+    }
+    return 0;
+}
+
+
+void names_find(NameIndex *idx, const char *prefix, size_t len,
+                NameIter *it) {
+
+    it->sorted = idx->sorted;
+    it->delta = idx->delta;
+    it->i = find_prefix(idx->sorted, 0, idx->n, prefix, len, 0);
+    it->ni = find_prefix(idx->sorted, it->i, idx->n, prefix, len, 1);
+    it->j = find_prefix(idx->delta, 0, idx->nd, prefix, len, 0);
+    it->nj = find_prefix(idx->delta, it->j, idx->nd, prefix, len, 1);
+}
+
+
+const char *names_next(NameIter *it) {
+
+    if (it->i == it->ni && it->j == it->nj) return NULL;
+
+    // The two ranges are read merged
+    if (it->j == it->nj || (it->i < it->ni &&
+        strcmp(it->sorted[it->i], it->delta[it->j]) < 0))
+        return it->sorted[it->i++];
+    return it->delta[it->j++];
+}
+
+
+void names_seek(NameIter *it, const char *after) {
+    size_t len = strlen(after) + 1;
+
+    // Comparing the terminator too finds the first name past `after`
+    it->i = find_prefix(it->sorted, it->i, it->ni, after, len, 1);
+    it->j = find_prefix(it->delta, it->j, it->nj, after, len, 1);
+}
@@ -0,0 +1,112 @@
+/**
+ * @file names.h
+ * @brief Usernames in alphabetical order, for prefix searches.
+ *
+ * The interned usernames (intern.h) are kept in a sorted array plus a small
+ * sorted delta of the newest ones. The index is brought up to date when it
+ * is read: a few new names are inserted into the delta, and when it would
+ * grow past NAMEDELTA it is sorted together with the new names and merged
+ * into the array in one pass. The names starting with a prefix are two
+ * ranges, one in each array, found by binary search in O(log n) and read
+ * merged.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _NAMES_H_
+#define _NAMES_H_
+
+#include <stddef.h>
+
+#include "intern.h"
+
+#define NAMEDELTA       4096        /**< max. num. of names in the delta */
+
+
+/**
+ * @struct NameIndex
+ * @brief Ordered index of the interned usernames.
+ */
+typedef struct {
+    char **sorted;      /**< Usernames, in order    */
+    int n;      /**< Number of names in `sorted`    */
+    char **delta;       /**< Newest usernames, in order (NAMEDELTA slots) */
+    int nd;     /**< Number of names in `delta` */
+    int known;      /**< User IDs below this one are in the index */
+} NameIndex;
+
+
+/**
+ * @struct NameIter
+ * @brief Reads the names in a range of the index, in order.
+ *
+ * `i` and `j` are positions in the array and in the delta. They move when
+ * the index changes, so reading is resumed later with `names_seek` from the
+ * last name read instead.
+ */
+typedef struct {
+    char **sorted, **delta;     /**< Arrays of the index    */
+    int i, ni;      /**< Next and end position in `sorted`  */
+    int j, nj;      /**< Next and end position in `delta`   */
+} NameIter;
+
+
+/**
+ * @brief Initializes an empty index.
+ *
+ * @return Initialized NameIndex structure.
+ */
+NameIndex names_ini(void);
+
+
+/**
+ * @brief Frees the index (not the names, which belong to the intern table).
+ *
+ * @param idx   Pointer to the index.
+ */
+void names_free(NameIndex *idx);
+
+
+/**
+ * @brief Adds the names interned since the last call.
+ *
+ * @param idx   Pointer to the index.
+ * @param tab   The usernames' intern table.
+ *
+ * @return 0 on success, -1 if out of memory (then the index is unchanged).
+ */
+int names_sync(NameIndex *idx, Intern *tab);
+
+
+/**
+ * @brief Starts reading the names that start with a prefix.
+ *
+ * @param idx       Pointer to the index (up to date).
+ * @param prefix    The prefix.
+ * @param len       Length of the prefix (0 for every name).
+ * @param it        Where to store the iterator.
+ */
+void names_find(NameIndex *idx, const char *prefix, size_t len,
+                NameIter *it);
+
+
+/**
+ * @brief Gets the next name.
+ *
+ * @param it    Pointer to the iterator.
+ *
+ * @return The name, or NULL after the last one.
+ */
+const char *names_next(NameIter *it);
+
+
+/**
+ * @brief Skips the names up to and including a given one, in O(log n).
+ *
+ * @param it    Pointer to the iterator.
+ * @param after The name (need not be in the index).
+ */
+void names_seek(NameIter *it, const char *after);
+
+#endif
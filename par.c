@@ -0,0 +1,250 @@
+/**
+ * @file par.c
+ * @brief Parallel merge sort and parallel listing formatter.
+ *
+ * Work is split into one contiguous slice per thread. The calling thread
+ * always takes the first slice, so small inputs never create threads.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "par.h"
+
+#define INSERTMAX       16      /**< Runs up to this size use insertion */
+
+
+/**
+ * @struct SortJob
+ * @brief Slice of a parallel sort, or a merge of two adjacent slices.
+ */
+typedef struct {
+    void **a, **tmp;        /**< Array and scratch space    */
+    long lo, mid, hi;       /**< Slice bounds (mid only for merges) */
+    CmpFn cmp;      /**< Comparison function    */
+} SortJob;
+
+
+/**
+ * @struct Text
+ * @brief Growable text buffer used by one formatting thread.
+ */
+typedef struct {
+    char *buf;      /**< Formatted text */
+    size_t len, cap;        /**< Bytes used and allocated   */
+    long lo, hi;        /**< Items to format    */
+    FormatFn fmt;       /**< Formatting function    */
+    void *ctx;      /**< Formatting context */
+    int err;        /**< 1 if out of memory */
+} Text;
+
+
+int par_threads(void) {
+    static int nthr = 0;
+    long ncpu;
+
+    if (!nthr) {
+        ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthr = ncpu < 1 ? 1 : ncpu > PARMAXTHR ? PARMAXTHR : (int) ncpu;
+    }
+    return nthr;
+}
+
+
+void par_run(void *(*fn)(void *), void *jobs, size_t size, int n) {
+    pthread_t tid[PARMAXTHR];
+    int started[PARMAXTHR], i;
+
+    for (i = 1; i < n; i++)
+        started[i] = !pthread_create(&tid[i], NULL, fn,
+                                    (char *) jobs + i * size);
+
+    fn(jobs);
+    for (i = 1; i < n; i++) {
+        if (started[i]) pthread_join(tid[i], NULL);
+        else fn((char *) jobs + i * size);
+    }
+}
+
+
+/**
+ * @brief Merges the sorted runs a[lo..mid) and a[mid..hi) using `tmp`.
+ */
+static void merge(void **a, void **tmp, long lo, long mid, long hi,
+                    CmpFn cmp) {
+    long i = lo, j = mid, k = lo;
+
+    // Nothing to do if the runs are already in order
+    if (lo == mid || mid == hi || cmp(a[mid - 1], a[mid]) <= 0) return;
+
+    while (i < mid && j < hi)
+        tmp[k++] = cmp(a[j], a[i]) < 0 ? a[j++] : a[i++];
+    while (i < mid) tmp[k++] = a[i++];
+
+    // Elements left in the right run are already in place
+    memcpy(a + lo, tmp + lo, (k - lo) * sizeof(void *));
+}
+
+
+/**
+ * @brief Sequential top-down merge sort of a[lo..hi).
+ */
+static void msort(void **a, void **tmp, long lo, long hi, CmpFn cmp) {
+    long i, j, mid;
+    void *x;
+
+    if (hi - lo <= INSERTMAX) {
+        for (i = lo + 1; i < hi; i++) {
+            x = a[i];
+            for (j = i; j > lo && cmp(x, a[j - 1]) < 0; j--) a[j] = a[j - 1];
+            a[j] = x;
+        }
+        return;
+    }
+
+    mid = lo + (hi - lo) / 2;
+    msort(a, tmp, lo, mid, cmp);
+    msort(a, tmp, mid, hi, cmp);
+    merge(a, tmp, lo, mid, hi, cmp);
+}
+
+
+/**
+ * @brief Thread entry: sorts one slice.
+ */
+static void *sort_job(void *arg) {
+    SortJob *job = (SortJob *) arg;
+
+    msort(job->a, job->tmp, job->lo, job->hi, job->cmp);
+    return NULL;
+}
+
+
+/**
+ * @brief Thread entry: merges two adjacent sorted slices.
+ */
+static void *merge_job(void *arg) {
+    SortJob *job = (SortJob *) arg;
+
+    merge(job->a, job->tmp, job->lo, job->mid, job->hi, job->cmp);
+    return NULL;
+}
+
+
+int par_sort(void **base, long n, CmpFn cmp) {
+    SortJob job[PARMAXTHR];
+    long bound[PARMAXTHR + 1];
+    void **tmp;
+    int nthr = par_threads(), nrun, i, step;
+
+    if (n < 2) return 0;
+    if (!(tmp = (void **) malloc(n * sizeof(void *)))) return -1;
+
+    if (n < PARSORTMIN || nthr == 1) {
+        msort(base, tmp, 0, n, cmp);
+        free(tmp);
+        return 0;
+    }
+
+    // Sort one slice per thread
+    for (i = 0; i <= nthr; i++) bound[i] = n * i / nthr;
+    for (i = 0; i < nthr; i++) {
+        job[i].a = base;
+        job[i].tmp = tmp;
+        job[i].lo = bound[i];
+        job[i].hi = bound[i + 1];
+        job[i].cmp = cmp;
+    }
+    par_run(sort_job, job, sizeof(SortJob), nthr);
+
+    // Merge neighbouring runs pairwise, halving the number of runs each time
+    for (step = 1; step < nthr; step *= 2) {
+        for (i = 0, nrun = 0; i + step < nthr; i += 2 * step, nrun++) {
+            job[nrun].a = base;
+            job[nrun].tmp = tmp;
+            job[nrun].lo = bound[i];
+            job[nrun].mid = bound[i + step];
+            job[nrun].hi = bound[i + 2 * step < nthr ? i + 2 * step : nthr];
+            job[nrun].cmp = cmp;
+        }
+        par_run(merge_job, job, sizeof(SortJob), nrun);
+    }
+
+    free(tmp);
+    return 0;
+}
+
+
+/**
+ * @brief Thread entry: formats items [lo, hi) into the thread's buffer.
+ */
+static void *format_job(void *arg) {
+    Text *t = (Text *) arg;
+    size_t room, cap;
+    char *buf;
+    long i;
+    int n;
+
+    t->len = 0;
+    for (i = t->lo; i < t->hi && !t->err; ) {
+        room = t->cap - t->len;
+        n = t->fmt(t->buf + t->len, room, t->ctx, i);
+
+        if (n < 0) { t->err = 1; break; }
+        if ((size_t) n < room) { t->len += n; i++; continue; }
+
+        // Not enough room: grow the buffer and format the item again
+        cap = 2 * t->cap > t->len + n + 1 ? 2 * t->cap : t->len + n + 1;
+        if (!(buf = (char *) realloc(t->buf, cap))) { t->err = 1; break; }
+        t->buf = buf;
+        t->cap = cap;
+    }
+    return NULL;
+}
+
+
+int par_print(long n, FormatFn fmt, void *ctx) {
+
+    return par_fprint(stdout, n, fmt, ctx);
+}
+
+
+int par_fprint(FILE *out, long n, FormatFn fmt, void *ctx) {
+    Text text[PARMAXTHR];
+    long done, per;
+    int nthr = n < PARPRINTMIN ? 1 : par_threads(), i, err = 0;
+
+    for (i = 0; i < nthr; i++) {
+        text[i].cap = PARBUFMEM;
+        text[i].buf = (char *) malloc(PARBUFMEM);
+        text[i].fmt = fmt;
+        text[i].ctx = ctx;
+        text[i].err = !text[i].buf;
+    }
+
+    // Each round formats up to PARSTEP items per thread, then writes them
+    for (done = 0; done < n && !err; done += per * nthr) {
+        per = (n - done + nthr - 1) / nthr;
+        if (per > PARSTEP) per = PARSTEP;
+
+        for (i = 0; i < nthr; i++) {
+            text[i].lo = done + per * i < n ? done + per * i : n;
+            text[i].hi = done + per * (i + 1) < n ? done + per * (i + 1) : n;
+        }
+        par_run(format_job, text, sizeof(Text), nthr);
+
+        for (i = 0; i < nthr && !err; i++) {
+            err = text[i].err;
+            if (!err) fwrite(text[i].buf, 1, text[i].len, out);
+        }
+    }
+
+    for (i = 0; i < nthr; i++) free(text[i].buf);
+    return err ? -1 : 0;
+}
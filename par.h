@@ -0,0 +1,113 @@
+/**
+ * @file par.h
+ * @brief Parallel helpers for sorting, for formatting long listings and
+ *          for running jobs on every core.
+ *
+ * Both helpers split their work over the available cores once the input is
+ * large enough, and produce exactly the same result as the sequential
+ * version.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _PAR_H_
+#define _PAR_H_
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define PARMAXTHR       64          /**< max. num. of worker threads    */
+#define PARSORTMIN      4096        /**< min. elements for a parallel sort  */
+#define PARPRINTMIN     32768       /**< min. items for parallel formatting */
+#define PARSTEP         8192        /**< Items per thread per output round  */
+#define PARBUFMEM       (1 << 16)   /**< Initial formatting buffer, in bytes */
+
+
+/**
+ * @brief Compares two elements of a pointer array.
+ *
+ * @return Negative, zero or positive, like `strcmp`.
+ */
+typedef int (*CmpFn)(const void *a, const void *b);
+
+
+/**
+ * @brief Formats one item of a listing.
+ *
+ * @param dst   Where to write the text.
+ * @param room  Bytes available in `dst`.
+ * @param ctx   Listing context (usually the array being listed).
+ * @param i     Index of the item to format.
+ *
+ * @return The length of the full text, like `snprintf` (the text was
+ *          truncated if it is not smaller than `room`).
+ */
+typedef int (*FormatFn)(char *dst, size_t room, void *ctx, long i);
+
+
+/**
+ * @brief Gets the number of threads used by the parallel helpers.
+ *
+ * @return Number of online cores, between 1 and PARMAXTHR.
+ */
+int par_threads(void);
+
+
+/**
+ * @brief Runs `fn` over `n` jobs, one per thread; job 0 runs on the caller.
+ *
+ * Jobs whose thread cannot be created also run on the caller.
+ *
+ * @param fn    Job function.
+ * @param jobs  Array of jobs.
+ * @param size  Size of each job.
+ * @param n     Number of jobs (at most PARMAXTHR).
+ */
+void par_run(void *(*fn)(void *), void *jobs, size_t size, int n);
+
+
+/**
+ * @brief Sorts an array of pointers with a stable merge sort.
+ *
+ * Already ordered runs are detected, so sorting an almost sorted array is
+ * close to linear. Arrays with at least PARSORTMIN elements are split into
+ * one run per thread; the runs are sorted and then merged in parallel.
+ *
+ * @param base  Array to sort.
+ * @param n     Number of elements.
+ * @param cmp   Comparison function, called with the stored pointers.
+ *
+ * @return 0 on success, -1 if out of memory (the array is unchanged).
+ */
+int par_sort(void **base, long n, CmpFn cmp);
+
+
+/**
+ * @brief Writes a listing of `n` items to `stdout`.
+ *
+ * Items are formatted into per-thread buffers that are written in order,
+ * so the output is byte-identical to printing them one after the other.
+ *
+ * @param n     Number of items.
+ * @param fmt   Function that formats one item.
+ * @param ctx   Context passed to `fmt`.
+ *
+ * @return 0 on success, -1 if out of memory (nothing more is written).
+ */
+int par_print(long n, FormatFn fmt, void *ctx);
+
+
+/**
+ * @brief Writes a listing of `n` items to a file, like `par_print`.
+ *
+ * @param out   The file.
+ * @param n     Number of items.
+ * @param fmt   Function that formats one item.
+ * @param ctx   Context passed to `fmt`.
+ *
+ * @return 0 on success, -1 if out of memory (nothing more is written).
+ */
+int par_fprint(FILE *out, long n, FormatFn fmt, void *ctx);
+
+#endif
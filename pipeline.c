@@ -0,0 +1,833 @@
+/**
+ * @file pipeline.c
+ * @brief Reader/executor/writer pipeline for scripted runs.
+ *
+ * The reader thread reads large blocks of input and cuts them into lines,
+ * the calling thread executes them, and the writer thread writes the output
+ * produced through `stdout`. Blocks and output chunks travel through
+ * lock-free single-producer/single-consumer rings and are recycled through
+ * return rings, so the steady state does no allocation.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "pipeline.h"
+#include "uring.h"
+
+#define SPINS       256         /**< Busy-wait rounds before yielding   */
+#define NAPNSEC     50000       /**< First sleep between polls (ns) */
+#define NAPMAX      1000000     /**< Longest sleep between polls (ns)   */
+#define NREADS      4           /**< Input blocks read ahead (io_uring) */
+#define NWRITES     8           /**< Output writes in flight (io_uring) */
+
+
+/**
+ * @struct InBlock
+ * @brief Block of input lines, each stored NUL-terminated.
+ */
+typedef struct {
+    int n, cap;         /**< Number of lines and capacity of `off`  */
+    size_t len;         /**< Bytes used in `text`   */
+    size_t *off;        /**< Offset of each line in `text`  */
+    char *text;         /**< Line contents  */
+} InBlock;
+
+
+/**
+ * @struct OutChunk
+ * @brief Chunk of output bytes waiting to be written.
+ */
+typedef struct {
+    size_t len;         /**< Bytes used in `data`   */
+    OutDefer *defer;        /**< Deferred text to write instead, or NULL */
+    char data[OUTCHUNK];        /**< Output bytes   */
+} OutChunk;
+
+
+/**
+ * @struct Pipeline
+ * @brief State shared by the three stages.
+ */
+typedef struct {
+    int fd_in, fd_out, maxline;     /**< Descriptors and line limit */
+    Ring in, in_free;       /**< Filled and recycled input blocks   */
+    Ring out, out_free;     /**< Filled and recycled output chunks  */
+    pthread_t reader, writer;       /**< Stage threads  */
+    FILE *saved;        /**< `stdout` before the pipeline started   */
+    int running;        /**< 1 while the pipeline owns `stdout` */
+} Pipeline;
+
+static Pipeline pl;     /**< The (single) running pipeline  */
+
+
+void ring_wait(int *spins) {
+    struct timespec nap = {0, NAPNSEC};
+    int naps;
+
+    if (++*spins < SPINS) return;
+
+    if (*spins < 2 * SPINS) { sched_yield(); return; }
+
+    // Double the nap every round, up to NAPMAX
+    for (naps = *spins - 2 * SPINS; naps > 0 && nap.tv_nsec < NAPMAX; naps--)
+        nap.tv_nsec *= 2;
+    if (nap.tv_nsec > NAPMAX) nap.tv_nsec = NAPMAX;
+    nanosleep(&nap, NULL);
+}
+
+
+void ring_ini(Ring *ring) {
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+}
+
+
+/**
+ * @brief Adds a pointer to the ring without waiting.
+ *
+ * @param ring  Ring to write to (single producer).
+ * @param ptr   Pointer to store.
+ *
+ * @return 1 if the pointer was stored, 0 if the ring was full.
+ */
+static int ring_try_push(Ring *ring, void *ptr) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    if (tail - atomic_load_explicit(&ring->head, memory_order_acquire)
+        == RINGSLOTS) return 0;
+
+    ring->slot[tail & (RINGSLOTS - 1)] = ptr;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+
+void ring_push(Ring *ring, void *ptr) {
+    int spins = 0;
+
+    while (!ring_try_push(ring, ptr)) ring_wait(&spins);
+}
+
+
+int ring_try_pop(Ring *ring, void **ptr) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    if (head == atomic_load_explicit(&ring->tail, memory_order_acquire))
+        return 0;
+
+    *ptr = ring->slot[head & (RINGSLOTS - 1)];
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+
+void *ring_pop(Ring *ring) {
+    void *ptr;
+    int spins = 0;
+
+    while (!ring_try_pop(ring, &ptr)) ring_wait(&spins);
+    return ptr;
+}
+
+
+/**
+ * @brief Frees an input block.
+ *
+ * @param blk   Block to free (may be NULL).
+ */
+static void block_free(InBlock *blk) {
+
+    if (!blk) return;
+    free(blk->off);
+    free(blk->text);
+    free(blk);
+}
+
+
+/**
+ * @brief Gets an empty input block, recycling one if available.
+ *
+ * @param p     Pipeline state.
+ *
+ * @return The block, or NULL if out of memory.
+ */
+static InBlock *block_get(Pipeline *p) {
+    InBlock *blk;
+
+    if (ring_try_pop(&p->in_free, (void **) &blk)) {
+        blk->n = 0;
+        blk->len = 0;
+        return blk;
+    }
+
+    blk = (InBlock *) calloc(1, sizeof(InBlock));
+    if (!blk) return NULL;
+
+    // Room for a full block plus one maximum-length line and its terminator
+    blk->text = (char *) malloc(INBLOCK + p->maxline + 1);
+    blk->cap = INBLOCK / 16;
+    blk->off = (size_t *) malloc(blk->cap * sizeof(size_t));
+
+    if (!blk->text || !blk->off) { block_free(blk); return NULL; }
+    return blk;
+}
+
+
+/**
+ * @brief Appends one line to an input block.
+ *
+ * @param blk   Block to append to.
+ * @param line  Line contents (not NUL-terminated).
+ * @param len   Line length.
+ *
+ * @return 1 on success, 0 if out of memory.
+ */
+static int block_add(InBlock *blk, const char *line, size_t len) {
+    size_t *new_off;
+
+    if (blk->n == blk->cap) {
+        new_off = (size_t *) realloc(blk->off, 2 * blk->cap * sizeof(size_t));
+        if (!new_off) return 0;
+
+        blk->off = new_off;
+        blk->cap *= 2;
+    }
+
+    blk->off[blk->n++] = blk->len;
+    memcpy(blk->text + blk->len, line, len);
+    blk->len += len;
+    blk->text[blk->len++] = '\0';
+    return 1;
+}
+
+
+/**
+ * @brief Cuts every complete line out of the raw input into blocks, the way
+ * `fgets` does, and keeps the incomplete line at the start of `raw`.
+ *
+ * Each line ends after a newline or after `maxline` characters, whichever
+ * comes first. Full blocks go to the executor.
+ *
+ * @param p     Pipeline state.
+ * @param raw   Raw input.
+ * @param have  Bytes in `raw`; set to the bytes kept.
+ * @param blk   Block being filled; set to NULL if out of memory.
+ */
+static void reader_cut(Pipeline *p, char *raw, size_t *have, InBlock **blk) {
+    size_t pos, len;
+    char *nl;
+
+    for (pos = 0; pos < *have; pos += len) {
+        len = *have - pos < (size_t) p->maxline ?
+                *have - pos : (size_t) p->maxline;
+        nl = (char *) memchr(raw + pos, '\n', len);
+
+        if (nl) len = nl - (raw + pos) + 1;
+        else if (len < (size_t) p->maxline) break;     // Incomplete line
+
+        if ((*blk)->len + len >= INBLOCK) {
+            ring_push(&p->in, *blk);
+            if (!(*blk = block_get(p))) break;
+        }
+        if (!block_add(*blk, raw + pos, len)) {
+            block_free(*blk);
+            *blk = NULL;
+            break;
+        }
+    }
+
+    memmove(raw, raw + pos, *have - pos);
+    *have -= pos;
+}
+
+
+/**
+ * @struct ReadAhead
+ * @brief Reads of a file in flight through io_uring.
+ */
+typedef struct {
+    Uring ring;     /**< The queue  */
+    char *buf;      /**< `NREADS` registered buffers of `INBLOCK` bytes */
+    int len[NREADS];        /**< Bytes read into each buffer, -1 if pending */
+    int inflight;       /**< Reads submitted and not yet reaped */
+    off_t start;        /**< Offset of the first block in the file  */
+} ReadAhead;
+
+
+/**
+ * @brief Waits for the reads in flight and frees the read-ahead (also run
+ * if the reader is cancelled).
+ */
+static void read_ahead_free(void *arg) {
+    ReadAhead *ra = (ReadAhead *) arg;
+    uint64_t tag;
+    int res;
+
+    // The buffers are the kernel's until their reads complete
+    while (ra->inflight && uring_reap(&ra->ring, 1, &tag, &res) == 1)
+        ra->inflight--;
+    uring_free(&ra->ring);
+    free(ra->buf);
+}
+
+
+/**
+ * @brief Queues the read of block `k` of the file into buffer
+ * `k % NREADS`, or reads it right away if the submission ring is full.
+ */
+static void read_block(Pipeline *p, ReadAhead *ra, uint64_t k) {
+    int b = k % NREADS;
+    char *buf = ra->buf + (size_t) b * INBLOCK;
+    off_t off = ra->start + k * INBLOCK;
+    ssize_t got;
+
+    ra->len[b] = -1;
+    if (!uring_read(&ra->ring, p->fd_in, buf, INBLOCK, off, b, k)) {
+        ra->inflight++;
+        return;
+    }
+
+    // A failed read ends the read-ahead, like a failed completion
+    do got = pread(p->fd_in, buf, INBLOCK, off);
+    while (got < 0 && errno == EINTR);
+    ra->len[b] = got < 0 ? 0 : got;
+}
+
+
+/**
+ * @brief Cuts the blocks read ahead in order of the file, reading each
+ * buffer again as soon as its lines are cut.
+ *
+ * @return Offset in the file after the last byte cut.
+ */
+static off_t read_blocks(Pipeline *p, ReadAhead *ra, char *raw, size_t *have,
+                        InBlock **blk) {
+    off_t done = ra->start;
+    uint64_t next, tag;
+    int b, res;
+
+    for (next = 0; next < NREADS; next++) read_block(p, ra, next);
+
+    for (next = 0; *blk; next++) {
+        b = next % NREADS;
+
+        // Completions come in any order: wait for the next block's
+        while (ra->len[b] < 0) {
+            pthread_testcancel();
+            if (uring_reap(&ra->ring, 1, &tag, &res) != 1) return done;
+
+            ra->inflight--;
+            if (res == -EINTR || res == -EAGAIN) read_block(p, ra, tag);
+            else ra->len[tag % NREADS] = res < 0 ? 0 : res;
+        }
+
+        memcpy(raw + *have, ra->buf + (size_t) b * INBLOCK, ra->len[b]);
+        *have += ra->len[b];
+        done += ra->len[b];
+        reader_cut(p, raw, have, blk);
+
+        // A short read (the end of the file) ends the read-ahead
+        if (ra->len[b] < INBLOCK) break;
+        read_block(p, ra, next + NREADS);
+    }
+    return done;
+}
+
+
+/**
+ * @brief Reads a regular file with io_uring, `NREADS` blocks ahead of the
+ * line cutter, into buffers registered with the kernel.
+ *
+ * Stops at the end of the file or at the first failure, and leaves the
+ * file offset after the bytes cut, so the plain `read` loop carries on
+ * from there (and also finds data appended meanwhile). Returns at once,
+ * having read nothing, if io_uring is not available or the input is not a
+ * regular file.
+ *
+ * @param p     Pipeline state.
+ * @param raw   Raw input buffer.
+ * @param have  Bytes in `raw`.
+ * @param blk   Block being filled; set to NULL if out of memory.
+ */
+static void read_ahead(Pipeline *p, char *raw, size_t *have, InBlock **blk) {
+    struct iovec iov[NREADS];
+    struct stat st;
+    ReadAhead ra;
+    int b;
+
+    memset(&ra, 0, sizeof(ReadAhead));
+    if (fstat(p->fd_in, &st) || !S_ISREG(st.st_mode) ||
+        (ra.start = lseek(p->fd_in, 0, SEEK_CUR)) < 0 ||
+        uring_ini(&ra.ring, NREADS)) return;
+
+    ra.buf = (char *) malloc((size_t) NREADS * INBLOCK);
+    for (b = 0; ra.buf && b < NREADS; b++) {
+        iov[b].iov_base = ra.buf + (size_t) b * INBLOCK;
+        iov[b].iov_len = INBLOCK;
+    }
+    if (!ra.buf || uring_buffers(&ra.ring, iov, NREADS)) {
+        read_ahead_free(&ra);
+        return;
+    }
+
+    pthread_cleanup_push(read_ahead_free, &ra);
+    lseek(p->fd_in, read_blocks(p, &ra, raw, have, blk), SEEK_SET);
+    pthread_cleanup_pop(1);
+}
+
+
+/**
+ * @brief Reader stage: cuts the input into lines the way `fgets` does.
+ *
+ * A regular file is read ahead with io_uring where available; the rest (or
+ * all of it) is read with plain `read`. A trailing line without newline is
+ * kept. A NULL block marks the end of the input.
+ *
+ * @param arg   Pipeline state.
+ *
+ * @return NULL.
+ */
+static void *reader_main(void *arg) {
+    Pipeline *p = (Pipeline *) arg;
+    size_t size = INBLOCK + p->maxline, have = 0;
+    char *raw = (char *) malloc(size);
+    InBlock *blk = block_get(p);
+    ssize_t got;
+
+    if (raw && blk) read_ahead(p, raw, &have, &blk);
+
+    while (raw && blk) {
+        got = read(p->fd_in, raw + have, size - have);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        have += got;
+        reader_cut(p, raw, &have, &blk);
+    }
+
+    // The last line may have no newline
+    if (raw && blk && have) block_add(blk, raw, have);
+
+    if (blk && blk->n) ring_push(&p->in, blk);
+    else block_free(blk);
+
+    ring_push(&p->in, NULL);
+    free(raw);
+    return NULL;
+}
+
+
+/**
+ * @brief Writes a buffer to a descriptor, retrying short writes.
+ */
+static void write_all(int fd, const char *buf, size_t len) {
+    size_t done;
+    ssize_t n;
+
+    for (done = 0; done < len; done += n) {
+        n = write(fd, buf + done, len - done);
+        if (n < 0 && errno == EINTR) n = 0;
+        else if (n < 0) break;      // Output closed: drop the rest
+    }
+}
+
+
+/**
+ * @brief Returns a written chunk (and its deferred text) for reuse.
+ */
+static void chunk_done(Pipeline *p, OutChunk *chunk) {
+
+    if (chunk->defer) {
+        free(chunk->defer->text);
+        free(chunk->defer);
+    }
+    if (!ring_try_push(&p->out_free, chunk)) free(chunk);
+}
+
+
+/**
+ * @brief Bytes a chunk stands for, waiting for deferred text to complete.
+ */
+static const char *chunk_bytes(OutChunk *chunk, size_t *len) {
+    OutDefer *out = chunk->defer;
+    int spins = 0;
+
+    if (!out) {
+        *len = chunk->len;
+        return chunk->data;
+    }
+    while (!atomic_load_explicit(&out->done, memory_order_acquire))
+        ring_wait(&spins);
+    *len = out->len;
+    return out->text;
+}
+
+
+/**
+ * @struct WriteSlot
+ * @brief A write in flight through io_uring.
+ */
+typedef struct {
+    OutChunk *chunk;        /**< Chunk being written, NULL if free  */
+    const char *buf;        /**< Bytes not yet written  */
+    size_t len;         /**< Number of bytes not yet written    */
+    uint64_t off;       /**< Offset of `buf` in the file    */
+} WriteSlot;
+
+
+/**
+ * @brief Queues the rest of a slot's write, or frees the slot once done.
+ *
+ * @return 1 if a write was queued, 0 if the slot was freed.
+ */
+static int write_slot(Pipeline *p, Uring *ring, WriteSlot *slot, int tag) {
+
+    if (slot->len) {
+        uring_write(ring, p->fd_out, slot->buf, slot->len < UINT32_MAX ?
+                    slot->len : UINT32_MAX, slot->off, tag);
+        return 1;
+    }
+    chunk_done(p, slot->chunk);
+    slot->chunk = NULL;
+    return 0;
+}
+
+
+/**
+ * @brief Handles one completed write: moves past the bytes written and
+ * queues the rest, retrying interrupted writes; a failed write drops the
+ * rest of its chunk, as `write_all` does.
+ *
+ * @return 1 if a write was queued again, 0 if the slot was freed.
+ */
+static int write_reaped(Pipeline *p, Uring *ring, WriteSlot *slot, int tag,
+                        int res) {
+
+    if (res > 0) {
+        slot->buf += res;
+        slot->len -= res;
+        slot->off += res;
+    }
+    else if (res != -EINTR && res != -EAGAIN) slot->len = 0;
+    return write_slot(p, ring, slot, tag);
+}
+
+
+/**
+ * @brief Writes the output to a regular file with io_uring, keeping up to
+ * `NWRITES` chunks in flight, each at its own offset from the current one.
+ *
+ * The chunks are written from where they are; they are allocated on demand
+ * by the executor, so they are not registered buffers. A chunk is recycled
+ * once its write completes. At the end the file offset is left after the
+ * output, as the plain writes would leave it.
+ *
+ * @param p     Pipeline state.
+ *
+ * @return 0 once the NULL chunk was written, -1 if io_uring is not
+ *          available or the output is not a regular file (nothing was
+ *          written).
+ */
+static int write_behind(Pipeline *p) {
+    WriteSlot slot[NWRITES];
+    int inflight = 0, res, k;
+    OutChunk *chunk;
+    struct stat st;
+    const char *buf;
+    uint64_t tag;
+    size_t len;
+    Uring ring;
+    off_t off;
+
+    // Writes at explicit offsets would defeat O_APPEND
+    if (fstat(p->fd_out, &st) || !S_ISREG(st.st_mode) ||
+        fcntl(p->fd_out, F_GETFL) & O_APPEND ||
+        (off = lseek(p->fd_out, 0, SEEK_CUR)) < 0 ||
+        uring_ini(&ring, NWRITES)) return -1;
+
+    for (k = 0; k < NWRITES; k++) slot[k].chunk = NULL;
+
+    while ((chunk = (OutChunk *) ring_pop(&p->out))) {
+
+        // Reap the writes done, waiting for one if every slot is busy
+        while (uring_reap(&ring, inflight == NWRITES, &tag, &res) == 1)
+            inflight -= !write_reaped(p, &ring, &slot[tag], tag, res);
+
+        if (inflight == NWRITES) {      // The queue failed: write here
+            buf = chunk_bytes(chunk, &len);
+            lseek(p->fd_out, off, SEEK_SET);
+            write_all(p->fd_out, buf, len);
+            off += len;
+            chunk_done(p, chunk);
+            continue;
+        }
+        for (k = 0; slot[k].chunk; k++);
+
+        slot[k].chunk = chunk;
+        slot[k].buf = chunk_bytes(chunk, &slot[k].len);
+        slot[k].off = off;
+        off += slot[k].len;
+        inflight += write_slot(p, &ring, &slot[k], k);
+        uring_submit(&ring);
+    }
+
+    while (inflight && uring_reap(&ring, 1, &tag, &res) == 1)
+        inflight -= !write_reaped(p, &ring, &slot[tag], tag, res);
+
+    lseek(p->fd_out, off, SEEK_SET);
+    uring_free(&ring);
+    return 0;
+}
+
+
+/**
+ * @brief Writer stage: writes output chunks in order until a NULL chunk.
+ *
+ * A chunk standing for deferred text waits until the text is complete.
+ * Regular files are written with io_uring where available, anything else
+ * with plain `write`.
+ *
+ * @param arg   Pipeline state.
+ *
+ * @return NULL.
+ */
+static void *writer_main(void *arg) {
+    Pipeline *p = (Pipeline *) arg;
+    OutChunk *chunk;
+    const char *buf;
+    size_t len;
+
+    if (!write_behind(p)) return NULL;
+
+    while ((chunk = (OutChunk *) ring_pop(&p->out))) {
+        buf = chunk_bytes(chunk, &len);
+        write_all(p->fd_out, buf, len);
+        chunk_done(p, chunk);
+    }
+    return NULL;
+}
+
+
+/**
+ * @brief Gets an empty output chunk, recycling one if available.
+ *
+ * @param p     Pipeline state.
+ *
+ * @return The chunk, or NULL if out of memory.
+ */
+static OutChunk *chunk_get(Pipeline *p) {
+    OutChunk *chunk;
+
+    if (!ring_try_pop(&p->out_free, (void **) &chunk)) {
+        chunk = (OutChunk *) malloc(sizeof(OutChunk));
+        if (!chunk) return NULL;
+    }
+    chunk->len = 0;
+    chunk->defer = NULL;
+    return chunk;
+}
+
+
+/**
+ * @brief `stdout` write hook: hands the bytes to the writer stage.
+ *
+ * @param cookie    Pipeline state.
+ * @param buf       Bytes written by stdio.
+ * @param size      Number of bytes.
+ *
+ * @return Number of bytes taken, or -1 if out of memory.
+ */
+static ssize_t out_write(void *cookie, const char *buf, size_t size) {
+    Pipeline *p = (Pipeline *) cookie;
+    OutChunk *chunk;
+    size_t done, n;
+
+    for (done = 0; done < size; done += n) {
+        if (!(chunk = chunk_get(p))) return -1;
+
+        n = size - done < OUTCHUNK ? size - done : OUTCHUNK;
+        memcpy(chunk->data, buf + done, n);
+        chunk->len = n;
+        ring_push(&p->out, chunk);
+    }
+    return size;
+}
+
+
+OutDefer *pipeline_defer(void) {
+    Pipeline *p = &pl;
+    OutChunk *chunk;
+    OutDefer *out;
+
+    if (!p->running) return NULL;
+
+    out = (OutDefer *) calloc(1, sizeof(OutDefer));
+    if (!out || !(chunk = chunk_get(p))) {
+        free(out);
+        return NULL;
+    }
+    atomic_init(&out->done, 0);
+
+    // What was printed before goes out first
+    fflush(stdout);
+    chunk->defer = out;
+    ring_push(&p->out, chunk);
+    return out;
+}
+
+
+/**
+ * @brief Makes room for `len` more bytes in a deferred output.
+ */
+static int defer_grow(OutDefer *out, size_t len) {
+    size_t cap = out->cap ? out->cap : OUTCHUNK / 16;
+    char *text;
+
+    while (cap - out->len <= len) cap *= 2;
+    if (cap == out->cap) return 0;
+
+    if (!(text = (char *) realloc(out->text, cap))) return -1;
+    out->text = text;
+    out->cap = cap;
+    return 0;
+}
+
+
+int defer_add(OutDefer *out, const char *text, size_t len) {
+
+    if (defer_grow(out, len)) return -1;
+    memcpy(out->text + out->len, text, len);
+    out->len += len;
+    return 0;
+}
+
+
+int defer_format(OutDefer *out, FormatFn fmt, void *ctx, long i) {
+    size_t room = out->cap - out->len;
+    int n;
+
+    if (out->cap) {
+        n = fmt(out->text + out->len, room, ctx, i);
+        if (n < 0) return -1;
+        if ((size_t) n < room) {
+            out->len += n;
+            return 0;
+        }
+    }
+    else n = fmt(NULL, 0, ctx, i);
+
+    // Too long for the room left: grow and format again
+    if (n < 0 || defer_grow(out, n)) return -1;
+    fmt(out->text + out->len, out->cap - out->len, ctx, i);
+    out->len += n;
+    return 0;
+}
+
+
+void defer_done(OutDefer *out) {
+
+    atomic_store_explicit(&out->done, 1, memory_order_release);
+}
+
+
+/**
+ * @brief Stops the pipeline: drains the output and restores `stdout`.
+ *
+ * Also registered with `atexit`, so output is not lost when a command
+ * exits the program (e.g. when memory runs out).
+ */
+static void pipeline_stop(void) {
+    Pipeline *p = &pl;
+    void *ptr;
+
+    if (!p->running) return;
+    p->running = 0;
+
+    // Flush what stdio holds and let the writer finish
+    fclose(stdout);
+    stdout = p->saved;
+    ring_push(&p->out, NULL);
+    pthread_join(p->writer, NULL);
+
+    // The reader may still be waiting on input that is no longer needed
+    pthread_cancel(p->reader);
+    pthread_join(p->reader, NULL);
+
+    while (ring_try_pop(&p->in, &ptr)) block_free((InBlock *) ptr);
+    while (ring_try_pop(&p->in_free, &ptr)) block_free((InBlock *) ptr);
+    while (ring_try_pop(&p->out_free, &ptr)) free(ptr);
+}
+
+
+int pipeline_run(int fd_in, int fd_out, int maxline, LineFn exec, void *ctx) {
+    static int registered = 0;
+    cookie_io_functions_t io = {NULL, out_write, NULL, NULL};
+    Pipeline *p = &pl;
+    InBlock *blk;
+    FILE *out;
+    int i, go = 1;
+
+    p->fd_in = fd_in;
+    p->fd_out = fd_out;
+    p->maxline = maxline;
+    ring_ini(&p->in);
+    ring_ini(&p->in_free);
+    ring_ini(&p->out);
+    ring_ini(&p->out_free);
+
+    // Redirect stdout to the writer stage; only this thread uses it
+    fflush(stdout);
+    if (!(out = fopencookie(p, "w", io))) return -1;
+    setvbuf(out, NULL, _IOFBF, OUTCHUNK);
+    __fsetlocking(out, FSETLOCKING_BYCALLER);
+
+    if (pthread_create(&p->writer, NULL, writer_main, p)) {
+        fclose(out);
+        return -1;
+    }
+    if (pthread_create(&p->reader, NULL, reader_main, p)) {
+        ring_push(&p->out, NULL);
+        pthread_join(p->writer, NULL);
+        fclose(out);
+        return -1;
+    }
+
+    p->saved = stdout;
+    stdout = out;
+    p->running = 1;
+    if (!registered) registered = !atexit(pipeline_stop);
+
+    // Executor stage: run the lines in order
+    while (go) {
+
+        // Publish pending output before waiting for more input
+        if (!ring_try_pop(&p->in, (void **) &blk)) {
+            fflush(stdout);
+            blk = (InBlock *) ring_pop(&p->in);
+        }
+        if (!blk) break;
+
+        for (i = 0; i < blk->n && go; i++)
+            go = exec(ctx, blk->text + blk->off[i]);
+
+        if (!ring_try_push(&p->in_free, blk)) block_free(blk);
+    }
+
+    pipeline_stop();
+    return 0;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file pipeline.h
+ * @brief Three-stage pipelined command loop for scripted runs.
+ *
+ * When the input is a file or a pipe, reading, executing and writing are
+ * split over three threads connected by single-producer/single-consumer
+ * ring buffers:
+ * - the reader tokenizes input blocks into command lines;
+ * - the executor (the calling thread) runs each line in order;
+ * - the writer sends the produced output to the output descriptor.
+ *
+ * Lines are cut exactly as `fgets` would cut them, and the executor's
+ * output is captured through `stdout`, so commands and output ordering
+ * are the same as in the plain `fgets` loop.
+ *
+ * Regular files are read and written through io_uring (see uring.h): the
+ * reader keeps a few blocks read ahead into registered buffers, and the
+ * writer keeps a few chunks being written at their offsets, so neither
+ * waits on the disk between blocks. Pipes, terminals, files opened for
+ * appending, and kernels without io_uring use plain `read` and `write`.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "par.h"
+
+#define RINGSLOTS       64          /**< Slots per ring (power of two)  */
+#define INBLOCK         (1 << 18)   /**< Bytes of input read per block  */
+#define OUTCHUNK        (1 << 16)   /**< Bytes of output per chunk  */
+#define CACHELINE       64          /**< Cache line size, in bytes  */
+
+
+/**
+ * @struct Ring
+ * @brief Lock-free single-producer/single-consumer ring of pointers.
+ *
+ * The producer only writes `tail` and the consumer only writes `head`;
+ * both live on their own cache line to avoid false sharing.
+ */
+typedef struct {
+    _Alignas(CACHELINE) atomic_size_t head;     /**< Next slot to read  */
+    _Alignas(CACHELINE) atomic_size_t tail;     /**< Next slot to write */
+    _Alignas(CACHELINE) void *slot[RINGSLOTS];  /**< Stored pointers    */
+} Ring;
+
+
+/**
+ * @struct OutDefer
+ * @brief Output that holds a place in the stream and is produced by another
+ *          thread.
+ *
+ * Only the producing thread touches the text until it sets `done`; the 
+ * writer then sends it out in place.
+ */
+typedef struct {
+    char *text;         /**< Text produced so far   */
+    size_t len, cap;        /**< Bytes used and allocated   */
+    atomic_int done;        /**< 1 once the text is complete    */
+} OutDefer;
+
+
+/**
+ * @brief Executes one command line.
+ *
+ * @param ctx   Opaque context given to `pipeline_run`.
+ * @param line  NUL-terminated command line, as returned by `fgets`.
+ *
+ * @return 0 to stop processing input, 1 to continue.
+ */
+typedef int (*LineFn)(void *ctx, char *line);
+
+
+/**
+ * @brief Initializes an empty ring.
+ *
+ * @param ring  Ring to initialize.
+ */
+void ring_ini(Ring *ring);
+
+
+/**
+ * @brief Adds a pointer to the ring, waiting while it is full.
+ *
+ * @param ring  Ring to write to (single producer).
+ * @param ptr   Pointer to store.
+ */
+void ring_push(Ring *ring, void *ptr);
+
+
+/**
+ * @brief Removes a pointer from the ring without waiting.
+ *
+ * @param ring  Ring to read from (single consumer).
+ * @param ptr   Where to store the removed pointer.
+ *
+ * @return 1 if a pointer was removed, 0 if the ring was empty.
+ */
+int ring_try_pop(Ring *ring, void **ptr);
+
+
+/**
+ * @brief Removes a pointer from the ring, waiting while it is empty.
+ *
+ * @param ring  Ring to read from (single consumer).
+ *
+ * @return The removed pointer.
+ */
+void *ring_pop(Ring *ring);
+
+
+/**
+ * @brief Backs off while waiting for another thread: spin, then yield, then
+ *          sleep for increasingly longer naps.
+ *
+ * @param spins Number of rounds waited so far (start at 0); updated.
+ */
+void ring_wait(int *spins);
+
+
+/**
+ * @brief Reserves the current place in the output for deferred text.
+ *
+ * Everything printed so far is written before the deferred text, and 
+ * everything printed afterwards is written after it, even if the text is 
+ * completed later. Called from the executor.
+ *
+ * @return The deferred output, or NULL if no pipeline is running or out of
+ *          memory (the caller should then print in place).
+ */
+OutDefer *pipeline_defer(void);
+
+
+/**
+ * @brief Appends bytes to a deferred output.
+ *
+ * @param out   Deferred output (owned by the calling thread).
+ * @param text  Bytes to append.
+ * @param len   Number of bytes.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int defer_add(OutDefer *out, const char *text, size_t len);
+
+
+/**
+ * @brief Appends one formatted item to a deferred output.
+ *
+ * @param out   Deferred output (owned by the calling thread).
+ * @param fmt   Function that formats the item.
+ * @param ctx   Context passed to `fmt`.
+ * @param i     Index of the item.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int defer_format(OutDefer *out, FormatFn fmt, void *ctx, long i);
+
+
+/**
+ * @brief Marks a deferred output as complete and hands it to the writer.
+ *
+ * @param out   Deferred output; the caller must not use it afterwards.
+ */
+void defer_done(OutDefer *out);
+
+
+/**
+ * @brief Runs the command loop as a reader/executor/writer pipeline.
+ *
+ * The calling thread becomes the executor and `stdout` is redirected to the
+ * writer for the duration of the call.
+ *
+ * @param fd_in     Input file descriptor.
+ * @param fd_out    Output file descriptor.
+ * @param maxline   Maximum characters per line (the `fgets` limit minus one).
+ * @param exec      Function that executes one line.
+ * @param ctx       Context passed to `exec`.
+ *
+ * @return 0 when the input was processed, -1 if the pipeline could not be
+ *          started (nothing was read and the caller may fall back).
+ */
+int pipeline_run(int fd_in, int fd_out, int maxline, LineFn exec, void *ctx);
+
+#endif
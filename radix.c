@@ -0,0 +1,102 @@
+/**
+ * @file radix.c
+ * @brief LSD radix sort implementation.
+ *
+ * The keys are copied next to their pointers first, so the passes stream
+ * through two flat arrays instead of following a pointer for every digit.
+ * One read of the input counts the digits of every pass at once.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+
+#include "radix.h"
+
+#define RADIXBUCKETS    (1 << RADIXBITS)        /**< Values of a digit  */
+
+/** Key field of an item */
+#define KEY(item, off)      (*(RadixKey *) ((char *) (item) + (off)))
+
+
+/**
+ * @struct RadixItem
+ * @brief A key and the item it belongs to.
+ */
+typedef struct {
+    RadixKey key;       /**< Copy of the item's key */
+    void *item;     /**< The item   */
+} RadixItem;
+
+
+/**
+ * @brief Extracts digit `d` (0 is the least significant) of a key.
+ */
+static unsigned digit(RadixKey key, int d) {
+    int bit = d * RADIXBITS;
+    uint64_t v;
+
+    if (bit >= 64) v = key.hi >> (bit - 64);
+    else {
+        v = key.lo >> bit;
+        if (bit + RADIXBITS > 64) v |= key.hi << (64 - bit);
+    }
+    return (unsigned) v & (RADIXBUCKETS - 1);
+}
+
+
+int radix_cmp(RadixKey a, RadixKey b) {
+
+    if (a.hi != b.hi) return a.hi < b.hi ? -1 : 1;
+    if (a.lo != b.lo) return a.lo < b.lo ? -1 : 1;
+    return 0;
+}
+
+
+int radix_sort(void **base, long n, size_t keyoff) {
+    RadixItem *a, *b, *t;
+    long (*cnt)[RADIXBUCKETS], i, sum, c;
+    int d;
+
+    if (n < 2) return 0;
+
+    a = (RadixItem *) malloc(2 * n * sizeof(RadixItem));
+    cnt = (long (*)[RADIXBUCKETS]) calloc(RADIXPASSES, sizeof(*cnt));
+    if (!a || !cnt) {
+        free(a);
+        free(cnt);
+        return -1;
+    }
+    b = a + n;
+
+    // Copy the keys and count the digits of every pass
+    for (i = 0; i < n; i++) {
+        a[i].key = KEY(base[i], keyoff);
+        a[i].item = base[i];
+        for (d = 0; d < RADIXPASSES; d++) cnt[d][digit(a[i].key, d)]++;
+    }
+
+    for (d = 0; d < RADIXPASSES; d++) {
+
+        // Nothing moves if every key has the same digit
+        if (cnt[d][digit(a[0].key, d)] == n) continue;
+
+        for (i = 0, sum = 0; i < RADIXBUCKETS; i++) {
+            c = cnt[d][i];
+            cnt[d][i] = sum;
+            sum += c;
+        }
+        for (i = 0; i < n; i++) b[cnt[d][digit(a[i].key, d)]++] = a[i];
+
+        t = a;
+        a = b;
+        b = t;
+    }
+
+    for (i = 0; i < n; i++) base[i] = a[i].item;
+
+    free(a < b ? a : b);
+    free(cnt);
+    return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file radix.h
+ * @brief LSD radix sort of pointers by a 128-bit key stored in each item.
+ *
+ * The sort runs in a fixed number of linear passes, whatever the order of
+ * the input, and skips the passes whose digit is the same in every key.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _RADIX_H_
+#define _RADIX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define RADIXBITS       11      /**< Bits per digit */
+#define RADIXPASSES     12      /**< Digits in a key (12 * 11 >= 128)  */
+#define RADIXMIN        64      /**< min. elements for a radix sort */
+
+
+/**
+ * @struct RadixKey
+ * @brief Unsigned 128-bit key, compared as (`hi`, `lo`).
+ */
+typedef struct {
+    uint64_t hi;        /**< Most significant half  */
+    uint64_t lo;        /**< Least significant half */
+} RadixKey;
+
+
+/**
+ * @brief Compares two keys.
+ *
+ * @return -1, 0 or 1 as `a` is smaller than, equal to or greater than `b`.
+ */
+int radix_cmp(RadixKey a, RadixKey b);
+
+
+/**
+ * @brief Sorts an array of pointers by the key found in each item.
+ *
+ * The sort is stable.
+ *
+ * @param base      Array to sort.
+ * @param n         Number of elements.
+ * @param keyoff    Offset (`offsetof`) of the RadixKey in each item.
+ *
+ * @return 0 on success, -1 if out of memory (the array is unchanged).
+ */
+int radix_sort(void **base, long n, size_t keyoff);
+
+#endif
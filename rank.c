@@ -0,0 +1,114 @@
+/**
+ * @file rank.c
+ * @brief Users ranked by their number of inoculation records.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "rank.h"
+
+
+/**
+ * @brief Heap order: more records first, then by username.
+ */
+static int compare_ranks(const void *a, const void *b) {
+    const UserRank *x = (const UserRank *) a, *y = (const UserRank *) b;
+
+    if (x->count != y->count) return x->count > y->count ? -1 : 1;
+    return strcmp(x->name, y->name);
+}
+
+
+/**
+ * @brief Counter of a user ID.
+ */
+static UserRank *rank_of(Rank *rank, int uid) {
+
+    return &rank->block[uid / RANKBLOCK][uid % RANKBLOCK];
+}
+
+
+Rank rank_ini(void) {
+    Rank rank;
+
+    rank.nblock = 0;
+    rank.block = NULL;
+    rank.top = heap_ini(compare_ranks, offsetof(UserRank, pos));
+    return rank;
+}
+
+
+void rank_free(Rank *rank) {
+    int b;
+
+    for (b = 0; b < rank->nblock; b++) free(rank->block[b]);
+    free(rank->block);
+    heap_free(&rank->top);
+}
+
+
+int rank_reserve(Rank *rank, int n) {
+    int nblock = (n + RANKBLOCK - 1) / RANKBLOCK, i;
+    UserRank **block;
+
+    if (nblock > rank->nblock) {
+        block = (UserRank **) realloc(rank->block,
+                                    nblock * sizeof(UserRank *));
+        if (!block) return -1;
+        rank->block = block;
+
+        for (; rank->nblock < nblock; rank->nblock++) {
+            block[rank->nblock] = (UserRank *) malloc(RANKBLOCK *
+                                                    sizeof(UserRank));
+            if (!block[rank->nblock]) return -1;
+            for (i = 0; i < RANKBLOCK; i++) {
+                block[rank->nblock][i].count = 0;
+                block[rank->nblock][i].pos = -1;
+            }
+        }
+    }
+    return heap_reserve(&rank->top, n);
+}
+
+
+void rank_add(Rank *rank, int uid, const char *name, int n) {
+    UserRank *user = rank_of(rank, uid);
+
+    if (n <= 0) return;
+    user->count += n;
+    user->name = name;
+
+    // The first record puts the user in the heap; there is room for it
+    if (user->pos == -1) heap_push(&rank->top, user);
+    else heap_update(&rank->top, user);
+}
+
+
+void rank_remove(Rank *rank, int uid, int n) {
+    UserRank *user;
+
+    if (n <= 0 || uid < 0 || uid >= rank->nblock * RANKBLOCK) return;
+    user = rank_of(rank, uid);
+    user->count -= n;
+
+    if (user->count <= 0) heap_remove(&rank->top, user);
+    else heap_update(&rank->top, user);
+}
+
+
+int rank_count(Rank *rank, int uid) {
+
+    if (uid < 0 || uid >= rank->nblock * RANKBLOCK) return 0;
+    return rank_of(rank, uid)->count;
+}
+
+
+int rank_top(Rank *rank, int k, UserRank **out) {
+
+    return heap_smallest(&rank->top, k, (void **) out);
+}
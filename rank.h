@@ -0,0 +1,118 @@
+/**
+ * @file rank.h
+ * @brief Users ranked by their number of inoculation records.
+ *
+ * Each user's count follows the records: it changes when a record is added
+ * (`a`) or deleted (`d`), and the user moves in an indexed heap (heap.h) in
+ * O(log n). The users with the most records are read from the heap in
+ * O(k log k), without scanning the users or the records.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _RANK_H_
+#define _RANK_H_
+
+#include "heap.h"
+
+#define RANKBLOCK       1024        /**< Counters per block */
+
+
+/**
+ * @struct UserRank
+ * @brief Records on file for one user.
+ */
+typedef struct {
+    const char *name;       /**< Username (interned)    */
+    int count;      /**< Records on file    */
+    int pos;        /**< Position in the heap, -1 if not in it  */
+} UserRank;
+
+
+/**
+ * @struct Rank
+ * @brief Record counters per user ID, and the users that have records.
+ *
+ * Counters are allocated in blocks, so they never move while the heap
+ * points at them.
+ */
+typedef struct {
+    int nblock;     /**< Blocks allocated   */
+    UserRank **block;       /**< Counters, RANKBLOCK per block, by user ID */
+    Heap top;       /**< Users with records, most records first */
+} Rank;
+
+
+/**
+ * @brief Initializes empty counters.
+ *
+ * @return Initialized Rank structure.
+ */
+Rank rank_ini(void);
+
+
+/**
+ * @brief Frees the counters.
+ *
+ * @param rank  Pointer to the counters.
+ */
+void rank_free(Rank *rank);
+
+
+/**
+ * @brief Makes room for the users with IDs below `n`, so that counting
+ * their records never runs out of memory.
+ *
+ * @param rank  Pointer to the counters.
+ * @param n     Number of user IDs.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int rank_reserve(Rank *rank, int n);
+
+
+/**
+ * @brief Counts new records of a user (room must have been reserved).
+ *
+ * @param rank  Pointer to the counters.
+ * @param uid   User ID.
+ * @param name  Username.
+ * @param n     Number of records added.
+ */
+void rank_add(Rank *rank, int uid, const char *name, int n);
+
+
+/**
+ * @brief Uncounts records of a user that were deleted.
+ *
+ * @param rank  Pointer to the counters.
+ * @param uid   User ID.
+ * @param n     Number of records deleted.
+ */
+void rank_remove(Rank *rank, int uid, int n);
+
+
+/**
+ * @brief Gets the number of records of a user.
+ *
+ * @param rank  Pointer to the counters.
+ * @param uid   User ID.
+ *
+ * @return Records on file.
+ */
+int rank_count(Rank *rank, int uid);
+
+
+/**
+ * @brief Gets the users with the most records, in order (ties by username).
+ *
+ * @param rank  Pointer to the counters.
+ * @param k     Number of users wanted.
+ * @param out   Where to store the users (room for `k`).
+ *
+ * @return Number of users stored, or -1 if out of memory.
+ */
+int rank_top(Rank *rank, int k, UserRank **out);
+
+#endif
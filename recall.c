@@ -0,0 +1,184 @@
+/**
+ * @file recall.c
+ * @brief Inoculation records of each batch, for recalls.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "recall.h"
+
+
+Recall recall_ini(void) {
+    Recall rc;
+
+    rc.nb = 0;
+    rc.list = NULL;
+    return rc;
+}
+
+
+void recall_free(Recall *rc) {
+    int b;
+
+    for (b = 0; b < rc->nb; b++) free(rc->list[b].entry);
+    free(rc->list);
+    *rc = recall_ini();
+}
+
+
+/**
+ * @brief Makes room for the lists of the batch IDs up to `bid`.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int recall_grow(Recall *rc, int bid) {
+    int nb = rc->nb ? rc->nb : RECALLMEM;
+    Posting *list;
+
+    while (nb <= bid) nb *= 2;
+    if (nb == rc->nb) return 0;
+
+    list = (Posting *) realloc(rc->list, nb * sizeof(Posting));
+    if (!list) return -1;
+    memset(list + rc->nb, 0, (nb - rc->nb) * sizeof(Posting));
+    for (; rc->nb < nb; rc->nb++) list[rc->nb].sorted = 1;
+    rc->list = list;
+    return 0;
+}
+
+
+int recall_add(Recall *rc, int bid, int uid, Date date, long seq) {
+    int key = date_key(date), cap;
+    RecallEntry *entry;
+    Posting *list;
+
+    if (bid >= rc->nb && recall_grow(rc, bid)) return -1;
+    list = &rc->list[bid];
+
+    if (list->n == list->cap) {
+        cap = list->cap ? 2 * list->cap : RECALLMEM;
+        entry = (RecallEntry *) realloc(list->entry,
+                                        cap * sizeof(RecallEntry));
+        if (!entry) return -1;
+        list->entry = entry;
+        list->cap = cap;
+    }
+
+    if (list->n && list->entry[list->n - 1].date > key) list->sorted = 0;
+    list->entry[list->n].uid = uid;
+    list->entry[list->n].seq = seq;
+    list->entry[list->n++].date = key;
+    return 0;
+}
+
+
+/**
+ * @brief Drops the entries of deleted records, keeping the order.
+ */
+static void recall_compact(Posting *list) {
+    int i, w;
+
+    for (i = w = 0; i < list->n; i++)
+        if (list->entry[i].uid != -1) list->entry[w++] = list->entry[i];
+    list->n = w;
+    list->ndead = 0;
+}
+
+
+void recall_remove(Recall *rc, int bid, int uid, Date date) {
+    int key = date_key(date), lo = 0, hi, mid;
+    Posting *list;
+
+    if (bid < 0 || bid >= rc->nb) return;
+    list = &rc->list[bid];
+
+    // The list is in order of date: find the first record of the date
+    for (hi = list->n; lo < hi; ) {
+        mid = lo + (hi - lo) / 2;
+        if (list->entry[mid].date < key) lo = mid + 1;
+        else hi = mid;
+    }
+    for (; lo < list->n && list->entry[lo].date == key; lo++) {
+        if (list->entry[lo].uid != uid) continue;
+        list->entry[lo].uid = -1;
+        if (2 * ++list->ndead > list->n) recall_compact(list);
+        return;
+    }
+}
+
+
+/**
+ * @brief Sorts entries by date, keeping the order of equal dates (merge
+ * sort, through `tmp`).
+ */
+static void sort_entries(RecallEntry *entry, RecallEntry *tmp, int n) {
+    int half = n / 2, i = 0, j = half, k = 0;
+
+    if (n < 2) return;
+    sort_entries(entry, tmp, half);
+    sort_entries(entry + half, tmp, n - half);
+
+    while (i < half && j < n)
+        tmp[k++] = entry[j].date < entry[i].date ? entry[j++] : entry[i++];
+    while (i < half) tmp[k++] = entry[i++];
+    memcpy(entry, tmp, k * sizeof(RecallEntry));
+}
+
+
+int recall_sort(Recall *rc) {
+    RecallEntry *tmp;
+    Posting *list;
+    int b;
+
+    for (b = 0; b < rc->nb; b++) {
+        list = &rc->list[b];
+        if (list->sorted) continue;
+
+        recall_compact(list);
+        if (!(tmp = (RecallEntry *) malloc(list->n * sizeof(RecallEntry))))
+            return -1;
+        sort_entries(list->entry, tmp, list->n);
+        free(tmp);
+        list->sorted = 1;
+    }
+    return 0;
+}
+
+
+long recall_seek(Recall *rc, int bid, int date, long seq) {
+    long lo = 0, hi, mid;
+    RecallEntry *entry;
+
+    if (bid < 0 || bid >= rc->nb) return 0;
+    entry = rc->list[bid].entry;
+
+    for (hi = rc->list[bid].n; lo < hi; ) {
+        mid = lo + (hi - lo) / 2;
+        if (entry[mid].date < date || (entry[mid].date == date &&
+            entry[mid].seq < seq)) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+int recall_next(Recall *rc, int bid, long *at, int *uid, Date *date,
+                long *seq) {
+    Posting *list;
+
+    if (bid < 0 || bid >= rc->nb) return 0;
+    list = &rc->list[bid];
+
+    // Skip the deleted records
+    while (*at < list->n && list->entry[*at].uid == -1) (*at)++;
+    if (*at >= list->n) return 0;
+
+    *uid = list->entry[*at].uid;
+    *seq = list->entry[*at].seq;
+    *date = date_unkey(list->entry[(*at)++].date);
+    return 1;
+}
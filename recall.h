@@ -0,0 +1,143 @@
+/**
+ * @file recall.h
+ * @brief Inoculation records of each batch, for recalls.
+ *
+ * Each batch has a posting list with the user, date and sequence number of
+ * its records, in order of application (date, then sequence number), kept
+ * up to date by 'a' and 'd'. A recall reads the list of its batch in O(k),
+ * without looking at the records of the other batches, and resumes from a
+ * place in that order found by binary search.
+ *
+ * A deleted record is only marked in its list, found by binary search on
+ * its date; the list is compacted once half of it is marked.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _RECALL_H_
+#define _RECALL_H_
+
+#include "date.h"
+
+#define RECALLMEM       16      /**< Initial entries per list   */
+
+
+/**
+ * @struct RecallEntry
+ * @brief A record in a batch's list.
+ */
+typedef struct {
+    int uid;        /**< ID of the user, -1 once the record is deleted */
+    int date;       /**< Application date, as `date_key`    */
+    long seq;       /**< Sequence number of the record  */
+} RecallEntry;
+
+
+/**
+ * @struct Posting
+ * @brief The records of one batch.
+ */
+typedef struct {
+    RecallEntry *entry;     /**< Records, in order of application   */
+    int n, cap;     /**< Entries used and allocated */
+    int ndead;      /**< Entries of deleted records */
+    int sorted;     /**< 0 if entries were added out of order   */
+} Posting;
+
+
+/**
+ * @struct Recall
+ * @brief Posting lists by batch ID.
+ */
+typedef struct {
+    int nb;     /**< Number of lists    */
+    Posting *list;      /**< List of each batch ID  */
+} Recall;
+
+
+/**
+ * @brief Initializes empty lists.
+ *
+ * @return Initialized Recall structure.
+ */
+Recall recall_ini(void);
+
+
+/**
+ * @brief Frees the lists.
+ *
+ * @param rc    Pointer to the lists.
+ */
+void recall_free(Recall *rc);
+
+
+/**
+ * @brief Adds a record at the end of its batch's list. A record dated
+ * before the last one leaves the list out of order until `recall_sort`.
+ *
+ * @param rc    Pointer to the lists.
+ * @param bid   ID of the batch.
+ * @param uid   ID of the user.
+ * @param date  Application date.
+ * @param seq   Sequence number, above those of the records added before.
+ *
+ * @return 0 on success, -1 if out of memory (nothing is added).
+ */
+int recall_add(Recall *rc, int bid, int uid, Date date, long seq);
+
+
+/**
+ * @brief Marks a deleted record in its batch's list.
+ *
+ * @param rc    Pointer to the lists.
+ * @param bid   ID of the batch.
+ * @param uid   ID of the user.
+ * @param date  Application date.
+ */
+void recall_remove(Recall *rc, int bid, int uid, Date date);
+
+
+/**
+ * @brief Puts the lists with records added out of order back in order of
+ * date; records of the same date keep the order they were added in.
+ *
+ * @param rc    Pointer to the lists.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int recall_sort(Recall *rc);
+
+
+/**
+ * @brief Finds a place in a batch's list, in O(log n). Positions move when
+ * the list is compacted or sorted, so a place kept between reads is a date
+ * and a sequence number instead.
+ *
+ * @param rc    Pointer to the lists (in order).
+ * @param bid   ID of the batch.
+ * @param date  Date of the place, as `date_key`.
+ * @param seq   Sequence number of the place.
+ *
+ * @return Position of the first record at or after the place.
+ */
+long recall_seek(Recall *rc, int bid, int date, long seq);
+
+
+/**
+ * @brief Reads the next record of a batch.
+ *
+ * @param rc    Pointer to the lists.
+ * @param bid   ID of the batch.
+ * @param at    Position in the list (from `recall_seek`); moved past the
+ *              record read.
+ * @param uid   Where to store the ID of the user.
+ * @param date  Where to store the application date.
+ * @param seq   Where to store the sequence number.
+ *
+ * @return 1 if a record was read, 0 after the last one.
+ */
+int recall_next(Recall *rc, int bid, long *at, int *uid, Date *date,
+                long *seq);
+
+#endif
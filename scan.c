@@ -0,0 +1,181 @@
+/**
+ * @file scan.c
+ * @brief AVX2/SSE2/scalar equality scans with run-time dispatch.
+ *
+ * Each scan goes through a function pointer that starts at a resolver: the
+ * first call checks the CPU, stores the best implementation in the pointer
+ * and forwards the call. The pointers are atomic, since worker threads may
+ * make their first scans at the same time.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdatomic.h>
+
+#include "scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SCANX86     1
+#include <immintrin.h>
+#endif
+
+
+/** Signature of the single-column scans */
+typedef int (*ScanEq)(const int *, int, int, int);
+
+/** Signature of the two-column scans */
+typedef int (*ScanEq2)(const int *, int, const int *, int, int, int);
+
+
+static int scan_eq_scalar(const int *col, int from, int to, int val) {
+
+    while (from < to && col[from] != val) from++;
+    return from;
+}
+
+
+static int scan_eq2_scalar(const int *col_a, int val_a, const int *col_b,
+                            int val_b, int from, int to) {
+
+    while (from < to && (col_a[from] != val_a || col_b[from] != val_b))
+        from++;
+    return from;
+}
+
+
+#ifdef SCANX86
+
+__attribute__((target("sse2")))
+static int scan_eq_sse2(const int *col, int from, int to, int val) {
+    __m128i key = _mm_set1_epi32(val), v;
+    int mask;
+
+    for (; from + 4 <= to; from += 4) {
+        v = _mm_loadu_si128((const __m128i *) (col + from));
+        mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, key)));
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return scan_eq_scalar(col, from, to, val);
+}
+
+
+__attribute__((target("sse2")))
+static int scan_eq2_sse2(const int *col_a, int val_a, const int *col_b,
+                        int val_b, int from, int to) {
+    __m128i key_a = _mm_set1_epi32(val_a), key_b = _mm_set1_epi32(val_b);
+    __m128i eq;
+    int mask;
+
+    for (; from + 4 <= to; from += 4) {
+        eq = _mm_and_si128(
+            _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (col_a + from)),
+                            key_a),
+            _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (col_b + from)),
+                            key_b));
+        mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return scan_eq2_scalar(col_a, val_a, col_b, val_b, from, to);
+}
+
+
+__attribute__((target("avx2")))
+static int scan_eq_avx2(const int *col, int from, int to, int val) {
+    __m256i key = _mm256_set1_epi32(val), v;
+    int mask;
+
+    for (; from + 8 <= to; from += 8) {
+        v = _mm256_loadu_si256((const __m256i *) (col + from));
+        mask = _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, key)));
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return scan_eq_scalar(col, from, to, val);
+}
+
+
+__attribute__((target("avx2")))
+static int scan_eq2_avx2(const int *col_a, int val_a, const int *col_b,
+                        int val_b, int from, int to) {
+    __m256i key_a = _mm256_set1_epi32(val_a), key_b = _mm256_set1_epi32(val_b);
+    __m256i eq;
+    int mask;
+
+    for (; from + 8 <= to; from += 8) {
+        eq = _mm256_and_si256(
+            _mm256_cmpeq_epi32(
+                _mm256_loadu_si256((const __m256i *) (col_a + from)), key_a),
+            _mm256_cmpeq_epi32(
+                _mm256_loadu_si256((const __m256i *) (col_b + from)), key_b));
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+        if (mask) return from + __builtin_ctz(mask);
+    }
+    return scan_eq2_scalar(col_a, val_a, col_b, val_b, from, to);
+}
+
+#endif
+
+
+static int scan_eq_pick(const int *col, int from, int to, int val);
+static int scan_eq2_pick(const int *col_a, int val_a, const int *col_b,
+                        int val_b, int from, int to);
+
+/** Selected single-column scan */
+static _Atomic(ScanEq) eq_fn = scan_eq_pick;
+/** Selected two-column scan */
+static _Atomic(ScanEq2) eq2_fn = scan_eq2_pick;
+
+
+/**
+ * @brief Selects the scans for this CPU.
+ */
+static void scan_pick(void) {
+    ScanEq eq = scan_eq_scalar;
+    ScanEq2 eq2 = scan_eq2_scalar;
+
+#ifdef SCANX86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        eq = scan_eq_avx2;
+        eq2 = scan_eq2_avx2;
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+        eq = scan_eq_sse2;
+        eq2 = scan_eq2_sse2;
+    }
+#endif
+
+    atomic_store_explicit(&eq_fn, eq, memory_order_relaxed);
+    atomic_store_explicit(&eq2_fn, eq2, memory_order_relaxed);
+}
+
+
+static int scan_eq_pick(const int *col, int from, int to, int val) {
+
+    scan_pick();
+    return scan_eq(col, from, to, val);
+}
+
+
+static int scan_eq2_pick(const int *col_a, int val_a, const int *col_b,
+                        int val_b, int from, int to) {
+
+    scan_pick();
+    return scan_eq2(col_a, val_a, col_b, val_b, from, to);
+}
+
+
+int scan_eq(const int *col, int from, int to, int val) {
+
+    return atomic_load_explicit(&eq_fn, memory_order_relaxed)(col, from, to,
+                                                            val);
+}
+
+
+int scan_eq2(const int *col_a, int val_a, const int *col_b, int val_b,
+            int from, int to) {
+
+    return atomic_load_explicit(&eq2_fn, memory_order_relaxed)(col_a, val_a,
+                                                    col_b, val_b, from, to);
+}
@@ -0,0 +1,46 @@
+/**
+ * @file scan.h
+ * @brief Vectorized equality scans over `int` columns.
+ *
+ * The scans compare 8 (AVX2) or 4 (SSE2) values per instruction. The
+ * instruction set is picked at run time from what the CPU supports, with a
+ * scalar fallback for other machines.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _SCAN_H_
+#define _SCAN_H_
+
+
+/**
+ * @brief Finds the next position where a column holds a value.
+ *
+ * @param col   The column.
+ * @param from  First position to check.
+ * @param to    End of the range (exclusive).
+ * @param val   Value to look for.
+ *
+ * @return First i in [from, to) with col[i] == val, or `to` if none.
+ */
+int scan_eq(const int *col, int from, int to, int val);
+
+
+/**
+ * @brief Finds the next position where two columns hold two values.
+ *
+ * @param col_a First column.
+ * @param val_a Value to look for in the first column.
+ * @param col_b Second column.
+ * @param val_b Value to look for in the second column.
+ * @param from  First position to check.
+ * @param to    End of the range (exclusive).
+ *
+ * @return First i in [from, to) with col_a[i] == val_a and
+ *          col_b[i] == val_b, or `to` if none.
+ */
+int scan_eq2(const int *col_a, int val_a, const int *col_b, int val_b,
+            int from, int to);
+
+#endif
@@ -0,0 +1,767 @@
+/**
+ * @file seg.c
+ * @brief Frozen, compressed segments of inoculation records.
+ *
+ * Each record of a user's run is encoded as three varints: the index of
+ * its batch in the batch dictionary, and the differences of its day and
+ * sequence number from those of the previous record of the run (0 and the
+ * segment's lowest sequence number before the first). A varint holds 7
+ * bits per byte, low bits first, with the top bit set on every byte but
+ * the last. Imported records get higher sequence numbers than older ones of
+ * later dates, so the difference of sequence numbers may be negative: it is
+ * zigzag encoded (0, -1, 1, -2... as 0, 1, 2, 3...).
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "seg.h"
+
+#define SEGRECMAX       25      /**< Max. bytes of an encoded record   */
+
+
+/**
+ * @struct SegUser
+ * @brief A record being frozen, by user.
+ */
+typedef struct {
+    int uid;        /**< User ID    */
+    int i;      /**< Position of the record */
+} SegUser;
+
+
+static int compare_users(const void *a, const void *b) {
+    const SegUser *x = (const SegUser *) a, *y = (const SegUser *) b;
+
+    if (x->uid != y->uid) return (x->uid > y->uid) - (x->uid < y->uid);
+    return (x->i > y->i) - (x->i < y->i);
+}
+
+
+/**
+ * @brief Writes a varint.
+ *
+ * @return Number of bytes written.
+ */
+static int put_varint(unsigned char *p, unsigned long v) {
+    int n = 0;
+
+    while (v >= 0x80) {
+        p[n++] = (unsigned char) (v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char) v;
+    return n;
+}
+
+
+/**
+ * @brief Zigzag encodes a difference, so small negative ones stay short.
+ */
+static unsigned long zigzag(long v) {
+
+    return ((unsigned long) v << 1) ^ (unsigned long) (v >> 63);
+}
+
+
+static long unzigzag(unsigned long v) {
+
+    return (long) (v >> 1) ^ -(long) (v & 1);
+}
+
+
+static unsigned long get_varint(const unsigned char **p) {
+    unsigned long v = 0;
+    int shift = 0;
+
+    while (**p & 0x80) {
+        v |= (unsigned long) (*(*p)++ & 0x7F) << shift;
+        shift += 7;
+    }
+    return v | (unsigned long) *(*p)++ << shift;
+}
+
+
+/**
+ * @brief Finds a user in a segment's dictionary.
+ *
+ * @return Index of the user, or -1 if not there.
+ */
+static int seg_user(const Seg *seg, int uid) {
+    int low = 0, high = seg->nuser, mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (seg->uids[mid] < uid) low = mid + 1;
+        else high = mid;
+    }
+    return low < seg->nuser && seg->uids[low] == uid ? low : -1;
+}
+
+
+/**
+ * @brief Finds a batch in a segment's dictionary, adding it if it is not
+ *          there. Batches are few: the last one added is looked at first.
+ *
+ * @return Index of the batch, or -1 if out of memory.
+ */
+static int seg_vac(Seg *seg, Vaccine *vac, int *cap) {
+    Vaccine **vacs;
+    int v;
+
+    for (v = seg->nvac - 1; v >= 0 && seg->vacs[v] != vac; v--);
+    if (v != -1) return v;
+
+    if (seg->nvac == *cap) {
+        vacs = (Vaccine **) realloc(seg->vacs, 2 * *cap * sizeof(Vaccine *));
+        if (!vacs) return -1;
+        seg->vacs = vacs;
+        *cap *= 2;
+    }
+    seg->vacs[seg->nvac] = vac;
+    return seg->nvac++;
+}
+
+
+/**
+ * @brief Appends a record to a segment being built; while the segment has
+ *          no `data`, only counts the bytes the record needs.
+ *
+ * @param seg   The segment.
+ * @param v     Index of the record's batch.
+ * @param dd    Day of the record.
+ * @param seq   Sequence number of the record.
+ * @param prev  Day and sequence number of the previous record of the run
+ *              (updated).
+ */
+static void seg_put(Seg *seg, int v, int dd, long seq, long prev[2]) {
+    unsigned char room[SEGRECMAX], *start, *data;
+
+    start = data = seg->data ? seg->data + seg->len : room;
+    data += put_varint(data, v);
+    data += put_varint(data, dd - prev[0]);
+    data += put_varint(data, zigzag(seq - prev[1]));
+    seg->len += data - start;
+
+    prev[0] = dd;
+    prev[1] = seq;
+}
+
+
+/**
+ * @brief Creates an empty segment of a month.
+ *
+ * @return The segment, or NULL if out of memory.
+ */
+static Seg *seg_new(int month) {
+    Seg *seg = (Seg *) calloc(1, sizeof(Seg));
+
+    if (!seg) return NULL;
+    atomic_init(&seg->refs, 1);
+    seg->month = month;
+    return seg;
+}
+
+
+/**
+ * @brief Allocates the user dictionary of a segment.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int seg_dict(Seg *seg, int nuser) {
+    int room = nuser ? nuser : 1;
+
+    seg->uids = (int *) malloc(room * sizeof(int));
+    seg->users = (char **) malloc(room * sizeof(char *));
+    seg->runs = (unsigned *) malloc(room * sizeof(unsigned));
+    seg->first = (int *) malloc(room * sizeof(int));
+    return seg->uids && seg->users && seg->runs && seg->first ? 0 : -1;
+}
+
+
+/**
+ * @brief Starts reading the run of the user at index `u`.
+ */
+static void run_iter(SegIter *it, const Seg *seg, int u) {
+
+    it->seg = seg;
+    it->u = u;
+    it->p = seg->data + seg->runs[u];
+    it->end = seg->data + (u + 1 < seg->nuser ? seg->runs[u + 1] : seg->len);
+    it->dd = 0;
+    it->seq = seg->seq0;
+}
+
+
+/**
+ * @brief Decodes the next record of a run, leaving its batch as an index
+ *          into the dictionary.
+ *
+ * @return 1 if a record was decoded, 0 past the last one.
+ */
+static int run_next(SegIter *it, int *v) {
+
+    if (it->p == it->end) return 0;
+
+    *v = (int) get_varint(&it->p);
+    it->dd += (int) get_varint(&it->p);
+    it->seq += unzigzag(get_varint(&it->p));
+    return 1;
+}
+
+
+/**
+ * @brief Finds the first record of each run and marks the decoding state
+ *          before every SEGSTEP-th record, once the runs are written.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int seg_marks(Seg *seg) {
+    int u, r = 0, v;
+    SegMark *mark;
+    SegIter it;
+
+    seg->marks = (SegMark *) malloc((seg->n / SEGSTEP + 1) *
+                                    sizeof(SegMark));
+    if (!seg->marks) return -1;
+
+    for (u = 0; u < seg->nuser; u++) {
+        seg->first[u] = r;
+        for (run_iter(&it, seg, u); it.p != it.end; r++) {
+            if (r % SEGSTEP == 0) {
+                mark = &seg->marks[r / SEGSTEP];
+                mark->at = it.p - seg->data;
+                mark->dd = it.dd;
+                mark->seq = it.seq;
+            }
+            run_next(&it, &v);
+        }
+    }
+    return 0;
+}
+
+
+Seg *seg_freeze(const Inoc *inocs, const InocCols *cols, int n) {
+    Seg *seg = seg_new(inocs[0].apdate.yy * 100 + inocs[0].apdate.mm);
+    SegUser *all = (SegUser *) malloc(n * sizeof(SegUser));
+    int i, j, u, v = 0, pass, cap = 4;
+    long prev[2];
+
+    if (seg) seg->vacs = (Vaccine **) malloc(cap * sizeof(Vaccine *));
+    if (!seg || !all || !seg->vacs) goto fail;
+
+    seg->n = n;
+    seg->seq0 = seg->seq1 = inocs[0].seq;
+
+    // Group the records by user, keeping their order within each user
+    for (i = 0; i < n; i++) {
+        all[i].uid = cols->user[i];
+        all[i].i = i;
+        if (inocs[i].seq < seg->seq0) seg->seq0 = inocs[i].seq;
+        if (inocs[i].seq > seg->seq1) seg->seq1 = inocs[i].seq;
+    }
+    qsort(all, n, sizeof(SegUser), compare_users);
+    for (j = 0; j < n; j++) seg->nuser += !j || all[j].uid != all[j-1].uid;
+    if (seg_dict(seg, seg->nuser)) goto fail;
+
+    // Count the bytes, then write them
+    for (pass = 0; pass < 2; pass++) {
+        if (pass && !(seg->data = (unsigned char *) malloc(seg->len)))
+            goto fail;
+        seg->len = 0;
+
+        for (j = 0, u = -1; j < n; j++) {
+            i = all[j].i;
+            if (!j || all[j].uid != all[j - 1].uid) {
+                seg->uids[++u] = all[j].uid;
+                seg->users[u] = inocs[i].user;
+                seg->runs[u] = seg->len;
+                prev[0] = 0;
+                prev[1] = seg->seq0;
+            }
+
+            if ((v = seg_vac(seg, inocs[i].vaccine, &cap)) == -1) goto fail;
+            seg_put(seg, v, inocs[i].apdate.dd, inocs[i].seq, prev);
+        }
+    }
+
+    // The records were given in order of application
+    if (!(seg->order = (int *) malloc(n * sizeof(int))) || seg_marks(seg))
+        goto fail;
+    for (j = 0; j < n; j++) seg->order[all[j].i] = j;
+
+    free(all);
+    return seg;
+
+fail:
+    free(all);
+    if (seg) seg_drop(seg);
+    return NULL;
+}
+
+
+int seg_map(Seg *seg) {
+    FILE *file = tmpfile();
+    void *data;
+
+    if (!file) return -1;
+    if (fwrite(seg->data, 1, seg->len, file) != seg->len || fflush(file)) {
+        fclose(file);
+        return -1;
+    }
+
+    // The mapping keeps the file alive after it is closed
+    data = mmap(NULL, seg->len, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    fclose(file);
+    if (data == MAP_FAILED) return -1;
+
+    free(seg->data);
+    seg->data = (unsigned char *) data;
+    seg->mapped = 1;
+    return 0;
+}
+
+
+Seg *seg_pin(Seg *seg) {
+
+    atomic_fetch_add_explicit(&seg->refs, 1, memory_order_relaxed);
+    return seg;
+}
+
+
+void seg_drop(Seg *seg) {
+
+    if (atomic_fetch_sub_explicit(&seg->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    if (seg->mapped) munmap(seg->data, seg->len);
+    else free(seg->data);
+    free(seg->uids);
+    free(seg->users);
+    free(seg->runs);
+    free(seg->first);
+    free(seg->vacs);
+    free(seg->order);
+    free(seg->marks);
+    free(seg);
+}
+
+
+int seg_has_user(const Seg *seg, int uid) {
+
+    return seg_user(seg, uid) != -1;
+}
+
+
+/**
+ * @brief Fills in a record decoded from a run.
+ */
+static void run_inoc(const SegIter *it, int v, Inoc *inoc) {
+    const Seg *seg = it->seg;
+
+    inoc->user = seg->users[it->u];
+    inoc->vaccine = seg->vacs[v];
+    inoc->apdate.dd = it->dd;
+    inoc->apdate.mm = seg->month % 100;
+    inoc->apdate.yy = seg->month / 100;
+    inoc->seq = it->seq;
+}
+
+
+void seg_iter(SegIter *it, const Seg *seg, int uid) {
+    int u = seg_user(seg, uid);
+
+    it->seg = seg;
+    if (u != -1) run_iter(it, seg, u);
+    else it->p = it->end = NULL;
+}
+
+
+int seg_next(SegIter *it, Inoc *inoc) {
+    int v;
+
+    if (!run_next(it, &v)) return 0;
+    run_inoc(it, v, inoc);
+    return 1;
+}
+
+
+void seg_decode(const Seg *seg, Inoc *inocs) {
+    SegIter it;
+    int u, k = 0;
+
+    for (u = 0; u < seg->nuser; u++)
+        for (run_iter(&it, seg, u); seg_next(&it, &inocs[k]); k++);
+}
+
+
+/**
+ * @brief Finds the user whose run holds a record.
+ *
+ * @return Index of the user.
+ */
+static int record_user(const Seg *seg, int r) {
+    int low = 0, high = seg->nuser - 1, mid;
+
+    while (low < high) {
+        mid = low + (high - low + 1) / 2;
+        if (seg->first[mid] <= r) low = mid;
+        else high = mid - 1;
+    }
+    return low;
+}
+
+
+void seg_record(const Seg *seg, int r, Inoc *inoc) {
+    int u = record_user(seg, r), from = r - r % SEGSTEP, v = 0;
+    const SegMark *mark = &seg->marks[r / SEGSTEP];
+    SegIter it;
+
+    // From the mark before the record, unless its run starts after it
+    run_iter(&it, seg, u);
+    if (from > seg->first[u]) {
+        it.p = seg->data + mark->at;
+        it.dd = mark->dd;
+        it.seq = mark->seq;
+    }
+    else from = seg->first[u];
+
+    for (; from <= r; from++) run_next(&it, &v);
+    run_inoc(&it, v, inoc);
+}
+
+
+int seg_seek(const Seg *seg, int key, long seq) {
+    int low = 0, high = seg->n, mid, at;
+    Inoc inoc;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        seg_record(seg, seg->order[mid], &inoc);
+        at = date_key(inoc.apdate);
+        if (at < key || (at == key && inoc.seq < seq)) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+
+/**
+ * @struct SegRec
+ * @brief A record being thawed, with its user ID.
+ */
+typedef struct {
+    Inoc inoc;      /**< The record */
+    int uid;        /**< User ID    */
+} SegRec;
+
+
+int seg_thaw(const Seg *seg, Inoc *inocs, InocCols *cols) {
+    SegRec *all = (SegRec *) malloc(seg->n * sizeof(SegRec)), *rec;
+    SegIter it;
+    int u, k = 0, i;
+
+    if (!all) return -1;
+    for (u = 0; u < seg->nuser; u++)
+        for (run_iter(&it, seg, u); seg_next(&it, &all[k].inoc); k++)
+            all[k].uid = seg->uids[u];
+
+    for (i = 0; i < k; i++) {
+        rec = &all[seg->order[i]];
+        inoc_set(inocs, cols, i, rec->inoc.user, rec->uid,
+                rec->inoc.vaccine, rec->inoc.apdate, rec->inoc.seq);
+    }
+    free(all);
+    return 0;
+}
+
+
+/**
+ * @brief Checks if a record of the user is one to remove.
+ */
+static int seg_match(const Seg *seg, int v, int dd, int read_date,
+                    int read_batch, Date date, int bid) {
+
+    return !read_date || (dd == date.dd &&
+            seg->month == date.yy * 100 + date.mm &&
+            (!read_batch || seg->vacs[v]->bid == bid));
+}
+
+
+int seg_remove(const Seg *seg, int uid, int read_date, int read_batch,
+                Date date, int bid, Inoc *gone, Seg **out) {
+    int ui = seg_user(seg, uid), v, m = 0, left = 0, pass, i, j, lo, hi, r;
+    int *kept;
+    size_t from, to;
+    long prev[2];
+    SegIter it;
+    Seg *fresh;
+
+    *out = NULL;
+    if (ui == -1) return 0;
+    lo = seg->first[ui];
+    hi = ui + 1 < seg->nuser ? seg->first[ui + 1] : seg->n;
+    if (!(kept = (int *) malloc((hi - lo) * sizeof(int)))) return -1;
+
+    // Only the user's run is decoded; the records left are numbered again
+    for (run_iter(&it, seg, ui); run_next(&it, &v); )
+        if (seg_match(seg, v, it.dd, read_date, read_batch, date, bid)) {
+            kept[m + left] = -1;
+            run_inoc(&it, v, &gone[m++]);
+        }
+        else {
+            kept[m + left] = left;
+            left++;
+        }
+    if (!m || m == seg->n) {
+        free(kept);
+        return m;
+    }
+
+    fresh = seg_new(seg->month);
+    if (fresh) fresh->vacs = (Vaccine **) malloc(seg->nvac *
+                                                sizeof(Vaccine *));
+    if (fresh) fresh->order = (int *) malloc((seg->n - m) * sizeof(int));
+    if (!fresh || !fresh->vacs || !fresh->order ||
+        seg_dict(fresh, seg->nuser - !left)) {
+        if (fresh) seg_drop(fresh);
+        free(kept);
+        return -1;
+    }
+
+    // The bounds stay, so the other runs' deltas still hold
+    fresh->n = seg->n - m;
+    fresh->seq0 = seg->seq0;
+    fresh->seq1 = seg->seq1;
+    fresh->nvac = seg->nvac;
+    memcpy(fresh->vacs, seg->vacs, seg->nvac * sizeof(Vaccine *));
+
+    // Count the bytes of the user's new run, then write it between the
+    // other runs, copied as they are
+    from = seg->runs[ui];
+    to = it.end - seg->data;
+    for (pass = 0; pass < 2; pass++) {
+        if (pass) {
+            fresh->data = (unsigned char *) malloc(seg->len - (to - from) +
+                                                    fresh->len);
+            if (!fresh->data) {
+                seg_drop(fresh);
+                free(kept);
+                return -1;
+            }
+            memcpy(fresh->data, seg->data, from);
+        }
+        fresh->len = pass ? from : 0;
+        prev[0] = 0;
+        prev[1] = seg->seq0;
+
+        for (run_iter(&it, seg, ui); run_next(&it, &v); )
+            if (!seg_match(seg, v, it.dd, read_date, read_batch, date, bid))
+                seg_put(fresh, v, it.dd, it.seq, prev);
+    }
+    memcpy(fresh->data + fresh->len, seg->data + to, seg->len - to);
+
+    // Later runs move by the change in the size of the user's run
+    for (i = 0, j = 0; i < seg->nuser; i++) {
+        if (i == ui && !left) continue;
+        fresh->uids[j] = seg->uids[i];
+        fresh->users[j] = seg->users[i];
+        fresh->runs[j++] = i > ui ? seg->runs[i] - to + fresh->len
+                                    : seg->runs[i];
+    }
+    fresh->nuser = j;
+    fresh->len += seg->len - to;
+
+    // In the order of application, the user's records left close up and
+    // the later runs' move back
+    for (i = 0, j = 0; i < seg->n; i++) {
+        r = seg->order[i];
+        if (r >= lo && r < hi && kept[r - lo] == -1) continue;
+        fresh->order[j++] = r >= hi ? r - m : r >= lo ? lo + kept[r - lo] : r;
+    }
+    free(kept);
+    if (seg_marks(fresh)) {
+        seg_drop(fresh);
+        return -1;
+    }
+
+    *out = fresh;
+    return m;
+}
+
+
+SegList *segs_new(int n) {
+    SegList *list = (SegList *) malloc(sizeof(SegList));
+
+    if (!list) return NULL;
+    list->seg = (Seg **) malloc((n ? n : 1) * sizeof(Seg *));
+    if (!list->seg) {
+        free(list);
+        return NULL;
+    }
+
+    atomic_init(&list->refs, 1);
+    list->n = n;
+    return list;
+}
+
+
+SegList *segs_pin(SegList *list) {
+
+    if (list) atomic_fetch_add_explicit(&list->refs, 1, memory_order_relaxed);
+    return list;
+}
+
+
+void segs_drop(SegList *list) {
+    int s;
+
+    if (!list ||
+        atomic_fetch_sub_explicit(&list->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    for (s = 0; s < list->n; s++) seg_drop(list->seg[s]);
+    free(list->seg);
+    free(list);
+}
+
+
+/**
+ * @brief Checks if a segment may hold records that pass the filters.
+ */
+static int iter_wants(const InocIter *it, const Seg *seg) {
+
+    return seg->month >= it->first / 100 && seg->month <= it->last / 100 &&
+            (it->uid == -1 || seg_has_user(seg, it->uid));
+}
+
+
+/**
+ * @brief Checks if a frozen record passes the filters.
+ */
+static int iter_passes(const InocIter *it, const Inoc *inoc) {
+    int key = date_key(inoc->apdate);
+
+    return key >= it->first && key <= it->last &&
+            (key > it->first || inoc->seq >= it->seq);
+}
+
+
+/**
+ * @brief Moves to the next record of the segment being read that passes
+ *          the filters.
+ *
+ * @return 1 if there is one, 0 past the segment's last.
+ */
+static int iter_cold(InocIter *it) {
+    const Seg *seg;
+    int r;
+
+    if (it->uid != -1) {
+        while (seg_next(&it->in, &it->cur))
+            if (iter_passes(it, &it->cur)) {
+                it->at = &it->cur;
+                return 1;
+            }
+        return 0;
+    }
+
+    // Records are read in order of application, so once one is past the
+    // last date the rest of the segment is too
+    seg = it->cold->seg[it->seg];
+    while (it->k < seg->n) {
+        r = seg->order[it->k++];
+        if (it->whole) it->at = &it->buf[r];
+        else {
+            seg_record(seg, r, &it->cur);
+            it->at = &it->cur;
+        }
+        if (iter_passes(it, it->at)) return 1;
+        if (date_key(it->at->apdate) > it->last) break;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Finds the place of a segment where reading starts: past the
+ *          records before the first date and sequence number, if the
+ *          segment holds that date.
+ *
+ * @return The place (0 to read the segment whole).
+ */
+static int iter_start(const InocIter *it, const Seg *seg) {
+
+    return seg->month == it->first / 100 ?
+            seg_seek(seg, it->first, it->seq) : 0;
+}
+
+
+int iter_ini(InocIter *it, const SegList *cold, const Inoc *hot,
+            const int *users, int from, int to, int uid, long seq, int first,
+            int last) {
+    int s, max = 0;
+
+    it->cold = cold;
+    it->seg = -1;
+    it->buf = NULL;
+    it->k = it->whole = 0;
+    it->hot = hot;
+    it->users = users;
+    it->pos = from;
+    it->to = to;
+    it->uid = uid;
+    it->seq = seq;
+    it->first = first;
+    it->last = last;
+
+    // All the users: each segment read from its start is decoded whole,
+    // into `buf`; the one the read starts inside is decoded a record at a
+    // time, from the place found
+    for (s = 0; uid == -1 && cold && s < cold->n; s++)
+        if (iter_wants(it, cold->seg[s]) && cold->seg[s]->n > max &&
+            !iter_start(it, cold->seg[s]))
+            max = cold->seg[s]->n;
+    if (max && !(it->buf = (Inoc *) malloc(max * sizeof(Inoc)))) return -1;
+
+    iter_next(it);
+    return 0;
+}
+
+
+void iter_next(InocIter *it) {
+    const SegList *cold = it->cold;
+    const Seg *seg;
+
+    // Frozen records first, from the segments that may pass
+    while (cold && it->seg < cold->n) {
+        if (it->seg >= 0 && iter_cold(it)) return;
+
+        for (it->seg++; it->seg < cold->n &&
+            !iter_wants(it, cold->seg[it->seg]); it->seg++);
+        if (it->seg == cold->n) break;
+
+        seg = cold->seg[it->seg];
+        if (it->uid != -1) seg_iter(&it->in, seg, it->uid);
+        else if (!(it->k = iter_start(it, seg))) {
+            seg_decode(seg, it->buf);
+            it->whole = 1;
+        }
+        else it->whole = 0;
+    }
+
+    // Then the records not frozen
+    if (it->uid != -1) it->pos = scan_eq(it->users, it->pos, it->to, it->uid);
+    it->at = it->pos < it->to ? &it->hot[it->pos++] : NULL;
+}
+
+
+void iter_free(InocIter *it) {
+
+    free(it->buf);
+}
@@ -0,0 +1,344 @@
+/**
+ * @file seg.h
+ * @brief Frozen, compressed segments of inoculation records.
+ *
+ * Records are never changed once applied, and those of past months are
+ * mostly read a user at a time (`u <user>` and `d`), so once a month is
+ * over its records are frozen into a segment, grouped by user: each user
+ * in the segment's dictionary owns a run of records, where the batches are
+ * indexes into the segment's batch dictionary and the days and sequence
+ * numbers are differences from the previous record, all written as
+ * varints. A user's run is decoded a record at a time.
+ *
+ * Each segment also keeps its order of application: the place of each
+ * record among the runs, and the decoding state at every SEGSTEP-th record,
+ * so any record is decoded from at most SEGSTEP others. Reading the whole
+ * segment in order of application decodes every run and follows that
+ * order; a read that starts inside the segment (the page of a cursor)
+ * finds its first record by binary search and decodes only the records it
+ * reads.
+ *
+ * A segment's encoded records may be moved to an unlinked temporary file
+ * and mapped back, so the kernel can page them out.
+ *
+ * Segments never change: deleting records from one builds a new one. Each
+ * segment is reference counted, as is each list of segments, so listings
+ * running in other threads keep the list they started with.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _SEG_H_
+#define _SEG_H_
+
+#include <stdatomic.h>
+
+#include "inoc.h"
+
+#define SEGSTEP         16      /**< Records between decoding marks  */
+
+
+/**
+ * @struct SegMark
+ * @brief Decoding state before a record of a run.
+ */
+typedef struct {
+    unsigned at;        /**< Offset of the record in `data` */
+    int dd;     /**< Day of the previous record of the run (0 if none)  */
+    long seq;       /**< Its sequence number (`seq0` if none)   */
+} SegMark;
+
+
+/**
+ * @struct Seg
+ * @brief The records of one month of a shard, encoded.
+ */
+typedef struct {
+    atomic_int refs;        /**< References to the segment  */
+    int month;      /**< Month of the records (yy * 100 + mm)  */
+    int n;      /**< Number of records  */
+    long seq0, seq1;        /**< Lowest and highest sequence numbers    */
+
+    int nuser;      /**< Number of users in the dictionary  */
+    int *uids;      /**< User IDs, in increasing order  */
+    char **users;       /**< Username of each user  */
+    unsigned *runs;     /**< Offset of each user's run in `data`    */
+    int *first;     /**< Index of each user's first record in the runs  */
+    int nvac;       /**< Number of batches in the dictionary    */
+    Vaccine **vacs;     /**< Batches, in order of first use */
+
+    int *order;     /**< Index in the runs of each record, in order of
+                        application */
+    SegMark *marks;     /**< State before every SEGSTEP-th record of the
+                            runs */
+
+    unsigned char *data;        /**< Encoded records    */
+    size_t len;     /**< Bytes of encoded records   */
+    int mapped;     /**< 1 if `data` is mapped from a file  */
+} Seg;
+
+
+/**
+ * @struct SegList
+ * @brief The frozen segments of a shard, oldest first.
+ */
+typedef struct {
+    atomic_int refs;        /**< References to the list */
+    int n;      /**< Number of segments */
+    Seg **seg;      /**< The segments (one reference each)  */
+} SegList;
+
+
+/**
+ * @struct SegIter
+ * @brief Position in a user's run of records.
+ */
+typedef struct {
+    const Seg *seg;     /**< The segment    */
+    int u;      /**< Index of the user  */
+    const unsigned char *p;     /**< Next record    */
+    const unsigned char *end;       /**< End of the run */
+    int dd;     /**< Day of the last record */
+    long seq;       /**< Sequence number of the last record */
+} SegIter;
+
+
+/**
+ * @struct InocIter
+ * @brief Reads a shard's records in order: the frozen segments, then a
+ *          range of the records not frozen, keeping only those that pass
+ *          the filters.
+ */
+typedef struct {
+    const SegList *cold;        /**< Frozen segments (NULL if none) */
+    int seg;        /**< Segment being read */
+    SegIter in;     /**< Position in the user's run (one user)  */
+    Inoc *buf;      /**< Records of the segment, in the order of the runs,
+                        if it is read whole (every user)    */
+    int k;      /**< Next place in the segment's order (every user) */
+    int whole;      /**< 1 if `buf` holds the segment (every user)  */
+
+    const Inoc *hot;        /**< Records not frozen */
+    const int *users;       /**< User ID column of `hot`    */
+    int pos, to;        /**< Range of `hot` left to read    */
+
+    int uid;        /**< Only this user's records (-1 for all)  */
+    long seq;       /**< Only records of date `first` from this sequence
+                        number (frozen) */
+    int first, last;        /**< Only these dates, as `date_key` (frozen) */
+
+    Inoc cur;       /**< Last record decoded from a run */
+    const Inoc *at;     /**< Current record, or NULL past the end   */
+} InocIter;
+
+
+/**
+ * @brief Freezes records of a single month into a segment.
+ *
+ * @param inocs The records, in order of application.
+ * @param cols  Their columns.
+ * @param n     Number of records (at least 1).
+ *
+ * @return The segment, with one reference, or NULL if out of memory.
+ */
+Seg *seg_freeze(const Inoc *inocs, const InocCols *cols, int n);
+
+
+/**
+ * @brief Moves a segment's encoded records to an unlinked temporary file and
+ *          maps them back.
+ *
+ * @param seg   The segment (not yet shared with other threads).
+ *
+ * @return 0 on success, -1 if the records stayed in memory.
+ */
+int seg_map(Seg *seg);
+
+
+/**
+ * @brief Adds a reference to a segment.
+ *
+ * @param seg   The segment.
+ *
+ * @return The segment.
+ */
+Seg *seg_pin(Seg *seg);
+
+
+/**
+ * @brief Drops a reference to a segment, freeing it with the last one.
+ *
+ * @param seg   The segment.
+ */
+void seg_drop(Seg *seg);
+
+
+/**
+ * @brief Checks if a user has records in a segment.
+ *
+ * @param seg   The segment.
+ * @param uid   User ID.
+ *
+ * @return 1 if so, 0 otherwise.
+ */
+int seg_has_user(const Seg *seg, int uid);
+
+
+/**
+ * @brief Builds a segment without a user's records, optionally only those
+ *          of a date, or of a date and a batch. Only the user's run is
+ *          encoded again; the order of application is carried over and
+ *          the marks found again.
+ *
+ * @param seg           The segment.
+ * @param uid           The user ID.
+ * @param read_date     Flag indicating if date filtering is enabled.
+ * @param read_batch    Flag indicating if batch filtering is enabled.
+ * @param date          The date to filter by.
+ * @param bid           The batch ID to filter by (-1 if unknown).
+ * @param gone          Where to store the records removed (room for
+ *                      `seg->n`).
+ * @param out           Where to store the new segment, with one reference
+ *                      (NULL if no record is left or none was removed).
+ *
+ * @return The number of records removed, or -1 if out of memory.
+ */
+int seg_remove(const Seg *seg, int uid, int read_date, int read_batch,
+                Date date, int bid, Inoc *gone, Seg **out);
+
+
+/**
+ * @brief Starts reading a user's run of records.
+ *
+ * @param it    Iterator to start.
+ * @param seg   The segment.
+ * @param uid   User ID (the run is empty if the user has no records).
+ */
+void seg_iter(SegIter *it, const Seg *seg, int uid);
+
+
+/**
+ * @brief Decodes the next record of a user's run.
+ *
+ * @param it    The iterator.
+ * @param inoc  Where to store the record.
+ *
+ * @return 1 if a record was decoded, 0 past the last one.
+ */
+int seg_next(SegIter *it, Inoc *inoc);
+
+
+/**
+ * @brief Decodes every record of a segment, in the order of the runs
+ *          (`seg->order` gives the order of application).
+ *
+ * @param seg   The segment.
+ * @param inocs Where to store the records (room for `seg->n`).
+ */
+void seg_decode(const Seg *seg, Inoc *inocs);
+
+
+/**
+ * @brief Decodes one record of a segment, from the mark before it.
+ *
+ * @param seg   The segment.
+ * @param r     Index of the record in the runs.
+ * @param inoc  Where to store the record.
+ */
+void seg_record(const Seg *seg, int r, Inoc *inoc);
+
+
+/**
+ * @brief Finds a place in a segment's order of application, in
+ *          O(SEGSTEP log n).
+ *
+ * @param seg   The segment.
+ * @param key   Date of the place, as `date_key`.
+ * @param seq   Sequence number of the place.
+ *
+ * @return Place of the first record at or after it (`seg->n` if none).
+ */
+int seg_seek(const Seg *seg, int key, long seq);
+
+
+/**
+ * @brief Decodes every record of a segment, and its columns, in order of
+ *          application.
+ *
+ * @param seg   The segment.
+ * @param inocs Where to store the records (room for `seg->n`).
+ * @param cols  Where to store their columns (room for `seg->n`).
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int seg_thaw(const Seg *seg, Inoc *inocs, InocCols *cols);
+
+
+/**
+ * @brief Creates a list of `n` segments, to be filled in by the caller.
+ *
+ * @param n     Number of segments.
+ *
+ * @return The list, with one reference, or NULL if out of memory.
+ */
+SegList *segs_new(int n);
+
+
+/**
+ * @brief Adds a reference to a list of segments.
+ *
+ * @param list  The list, or NULL.
+ *
+ * @return The list.
+ */
+SegList *segs_pin(SegList *list);
+
+
+/**
+ * @brief Drops a reference to a list of segments, freeing it (and dropping
+ *          its segments) with the last one.
+ *
+ * @param list  The list, or NULL.
+ */
+void segs_drop(SegList *list);
+
+
+/**
+ * @brief Starts reading a shard's records.
+ *
+ * @param it    Iterator to start; `it->at` is the first record.
+ * @param cold  Frozen segments, or NULL.
+ * @param hot   Records not frozen.
+ * @param users User ID column of `hot`.
+ * @param from  First record of `hot` to read.
+ * @param to    End of the records of `hot` to read.
+ * @param uid   Only read this user's records (-1 for all).
+ * @param seq   Only read frozen records of date `first` from this sequence
+ *              number.
+ * @param first Only read frozen records from this date (`date_key`).
+ * @param last  Only read frozen records up to this date (`date_key`).
+ *
+ * @return 0 on success, -1 if out of memory (then nothing is to be freed).
+ */
+int iter_ini(InocIter *it, const SegList *cold, const Inoc *hot,
+            const int *users, int from, int to, int uid, long seq, int first,
+            int last);
+
+
+/**
+ * @brief Moves to the next record; `it->at` is NULL past the last one.
+ *
+ * @param it    The iterator.
+ */
+void iter_next(InocIter *it);
+
+
+/**
+ * @brief Frees an iterator's memory.
+ *
+ * @param it    The iterator.
+ */
+void iter_free(InocIter *it);
+
+#endif
@@ -0,0 +1,1144 @@
+/**
+ * @file shard.c
+ * @brief Shard storage, snapshots, worker threads and merged listings.
+ *
+ * The executor sends jobs to a worker through the worker's ring and counts
+ * them; the worker counts the jobs it finishes, so when both counts match
+ * the worker is idle. A listing reads snapshots pinned when the job was
+ * sent, or, for a user's listing run by the shard's own worker, when it
+ * runs; it drops them when done. The shard's worker also appends the
+ * records queued by the executor, a job per `SHARDADDS` records, and runs
+ * the deletions handed to it.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "shard.h"
+#include "intern.h"
+#include "errors.h"
+#include "par.h"
+
+#define SHARDADDS       256     /**< Records queued per job  */
+
+
+/**
+ * @struct ShardAdd
+ * @brief A record queued for the shard's worker to append.
+ */
+typedef struct {
+    char *user;     /**< Username (interned)    */
+    int uid;        /**< ID of the user */
+    Vaccine *vac;       /**< Batch applied  */
+    Date date;      /**< Date of application    */
+    long seq;       /**< Sequence number    */
+} ShardAdd;
+
+
+/**
+ * @struct ShardJob
+ * @brief A job run by a worker: a user's records, a merge of ranges of
+ *          every shard, records to append or a deletion.
+ */
+typedef struct ShardJob {
+    Shard *shard;       /**< Shard changed or listed when the job runs */
+    ShardAdd *add;      /**< Records to append, or NULL */
+    int nadd;       /**< Number of records to append    */
+    ShardDel *del;      /**< Deletion to run, or NULL   */
+    Snap snap[MAXSHARDS];       /**< Records to list    */
+    int nsnap;      /**< Number of snapshots    */
+    int uid;        /**< ID of the user, for a user's listing   */
+    char *username;     /**< Copy of the username (NULL for a merge) */
+    char *filter;       /**< Copy of the vaccine or batch to merge, or NULL */
+    int is_prefix;      /**< 1 if `filter` is a prefix of the usernames */
+    int first, last;        /**< Dates to merge, as `date_key`  */
+    int is_pt;      /**< Language flag  */
+    OutDefer *out;      /**< Where the listing goes (NULL for `stdout`) */
+} ShardJob;
+
+
+/**
+ * @brief Drops a reference to a version, freeing it with the last one.
+ */
+static void ver_drop(InocVer *ver) {
+
+    if (atomic_fetch_sub_explicit(&ver->refs, 1, memory_order_acq_rel) != 1)
+        return;
+
+    free(ver->inocs);
+    free(ver->cols.user);
+    free(ver->cols.batch);
+    free(ver->cols.date);
+    free(ver);
+}
+
+
+/**
+ * @brief Creates a version holding only the shard's reference.
+ */
+static InocVer *ver_new(void) {
+    InocVer *ver = (InocVer *) calloc(1, sizeof(InocVer));
+
+    if (ver) atomic_init(&ver->refs, 1);
+    return ver;
+}
+
+
+/**
+ * @brief Pins a range of a shard's current records.
+ */
+static void snap_take(Shard *shard, Snap *snap, int from, int to) {
+
+    atomic_fetch_add_explicit(&shard->ver->refs, 1, memory_order_relaxed);
+    snap->ver = shard->ver;
+    snap->inocs = shard->inocs;
+    snap->cols = shard->cols;
+    snap->from = from;
+    snap->to = to;
+    snap->cold = segs_pin(shard->cold);
+}
+
+
+/**
+ * @brief Frees a job and drops its snapshots.
+ */
+static void job_free(ShardJob *job) {
+    int s;
+
+    for (s = 0; s < job->nsnap; s++) {
+        ver_drop(job->snap[s].ver);
+        segs_drop(job->snap[s].cold);
+    }
+    free(job->add);
+    free(job->username);
+    free(job->filter);
+    free(job);
+}
+
+
+/**
+ * @brief Writes a user's inoculations, or the missing-user error, to a
+ *          deferred output (or to `stdout` when there is none).
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int list_user(Snap *snap, int uid, const char *username, int is_pt,
+                    OutDefer *out) {
+    const char *err = is_pt ? EINVUSER_PT "\n" : EINVUSER_EN "\n";
+    int is_user = 0;
+    InocIter it;
+
+    // Read the user's frozen records, then scan the user column
+    if (iter_ini(&it, snap->cold, snap->inocs, snap->cols.user, snap->from,
+                snap->to, uid, 0, 0, INT_MAX)) return -1;
+    for (; it.at; iter_next(&it)) {
+        is_user = 1;
+        if (!out) print_l_inoc((Inoc *) it.at);
+        else if (defer_format(out, format_l_inoc, (Inoc *) it.at, 0)) {
+            iter_free(&it);
+            return -1;
+        }
+    }
+    iter_free(&it);
+
+    if (is_user) return 0;
+    if (!out) {
+        printf("%s", username);
+        fputs(err, stdout);
+        return 0;
+    }
+    return defer_add(out, username, strlen(username)) ||
+            defer_add(out, err, strlen(err)) ? -1 : 0;
+}
+
+
+/**
+ * @brief Collects copies of the records of a job's snapshots, in global
+ *          order.
+ *
+ * @return Array of the records (to be freed by the caller), or NULL if out
+ *          of memory.
+ */
+static Inoc *collect(ShardJob *job, long *n) {
+    InocIter its[MAXSHARDS];
+    long k, cap = INOCMEM;
+    Inoc *all = (Inoc *) malloc(cap * sizeof(Inoc)), *grown;
+    Snap *snap;
+    int s, min, started;
+
+    for (started = 0; all && started < job->nsnap; started++) {
+        snap = &job->snap[started];
+        if (iter_ini(&its[started], snap->cold, snap->inocs,
+                    snap->cols.user, snap->from, snap->to, -1, 0,
+                    job->first, job->last)) {
+            free(all);
+            all = NULL;
+            break;
+        }
+    }
+
+    // Merge the shards in order of application, taking the first head each
+    // time
+    for (k = 0; all; k++) {
+        for (s = 0, min = -1; s < job->nsnap; s++)
+            if (its[s].at && (min == -1 || inoc_before(its[s].at,
+                                                        its[min].at)))
+                min = s;
+        if (min == -1) break;
+
+        if (k == cap) {
+            grown = (Inoc *) realloc(all, (cap *= 2) * sizeof(Inoc));
+            if (!grown) free(all);
+            all = grown;
+            if (!all) break;
+        }
+        all[k] = *its[min].at;
+        iter_next(&its[min]);
+    }
+
+    for (s = 0; s < started; s++) iter_free(&its[s]);
+    *n = k;
+    return all;
+}
+
+
+/**
+ * @brief Order of a prefix listing: by username, then by application.
+ */
+static int compare_users(const void *a, const void *b) {
+    const Inoc *x = (const Inoc *) a, *y = (const Inoc *) b;
+    int cmp = strcmp(x->user, y->user);
+
+    if (cmp) return cmp;
+    return inoc_before(x, y) ? -1 : inoc_before(y, x);
+}
+
+
+/**
+ * @brief Writes the merged records of a job, keeping only those of the
+ *          job's vaccine or batch, or of the users with its prefix, if it
+ *          has one.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int list_merged(ShardJob *job) {
+    const char *filter = job->filter;
+    int ret = 0;
+    Inoc *all;
+    size_t len = strlen(filter ? filter : "");
+    long k, m, n;
+
+    if (!(all = collect(job, &n))) return -1;
+
+    // A prefix keeps the records of its users, grouped by username
+    if (job->is_prefix) {
+        for (k = m = 0; k < n; k++)
+            if (!strncmp(all[k].user, filter, len)) all[m++] = all[k];
+        qsort(all, n = m, sizeof(Inoc), compare_users);
+        filter = NULL;
+    }
+
+    // Without a deferred output, long listings are formatted in parallel
+    if (!job->out && !filter) ret = par_print(n, format_l_inoc, all);
+
+    for (k = 0; (job->out || filter) && !ret && k < n; k++) {
+        if (filter && strcmp(filter, all[k].vaccine->name) &&
+            strcmp(filter, all[k].vaccine->batch)) continue;
+
+        if (!job->out) print_l_inoc(&all[k]);
+        else ret = defer_format(job->out, format_l_inoc, all, k);
+    }
+
+    free(all);
+    return ret;
+}
+
+
+/**
+ * @brief Appends the records of a job to its shard, which has room for
+ *          them.
+ */
+static void append_rows(ShardJob *job) {
+    Shard *shard = job->shard;
+    ShardAdd *add;
+    int i;
+
+    for (i = 0; i < job->nadd; i++) {
+        add = &job->add[i];
+        inoc_set(shard->inocs, &shard->cols, shard->ni++, add->user,
+                add->uid, add->vac, add->date, add->seq);
+    }
+}
+
+
+/**
+ * @brief Runs a deletion, writes its count or error as `d` prints them and
+ *          hands it back to the executor.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int run_delete(ShardJob *job) {
+    ShardDel *del = job->del;
+    const char *name = "", *err;
+    char count[16];
+    int status = shard_delete(job->shard, del), ret = -1;
+
+    if (status == VMS_OK) {
+        snprintf(count, sizeof(count), "%d\n", del->removed);
+        ret = defer_add(job->out, count, strlen(count));
+    }
+    else if (status != VMS_ENOMEMORY) {
+        if (status == VMS_EINVUSER) {
+            name = del->user;
+            err = del->is_pt ? EINVUSER_PT "\n" : EINVUSER_EN "\n";
+        }
+        else if (status == VMS_ENOBATCH) {
+            name = del->batch;
+            err = del->is_pt ? ENOBATCH_PT "\n" : ENOBATCH_EN "\n";
+        }
+        else err = del->is_pt ? EINVDATE_PT "\n" : EINVDATE_EN "\n";
+
+        ret = defer_add(job->out, name, strlen(name)) ||
+                defer_add(job->out, err, strlen(err)) ? -1 : 0;
+    }
+
+    atomic_store_explicit(&del->done, 1, memory_order_release);
+    return ret;
+}
+
+
+/**
+ * @brief Runs a job, then drops its snapshots and completes its output.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int job_run(ShardJob *job) {
+    int ret = 0;
+
+    // A user's listing run by the shard's worker reads the records as the
+    // worker left them
+    if (job->shard && job->username) {
+        snap_take(job->shard, &job->snap[0], 0, job->shard->ni);
+        job->nsnap = 1;
+    }
+
+    if (job->add) append_rows(job);
+    else if (job->del) ret = run_delete(job);
+    else if (job->username)
+        ret = list_user(&job->snap[0], job->uid, job->username, job->is_pt,
+                        job->out);
+    else ret = list_merged(job);
+
+    if (job->out) defer_done(job->out);
+    job_free(job);
+    return ret;
+}
+
+
+/**
+ * @brief Puts a job in a worker's ring and counts it.
+ */
+static void job_push(Worker *worker, ShardJob *job) {
+
+    worker->sent++;
+    ring_push(&worker->jobs, job);
+}
+
+
+/**
+ * @brief Hands the records queued to the shard's worker.
+ */
+static void shard_flush(Shard *shard) {
+    ShardJob *job = shard->adds;
+
+    if (!job || !job->nadd) return;
+    shard->adds = NULL;
+    job_push(&shard->worker, job);
+}
+
+
+/**
+ * @brief Hands a job to a worker, or runs it in place if the worker has no
+ *          thread or there is no pipeline to defer the output to.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int job_send(Worker *worker, ShardJob *job) {
+
+    if (atomic_load(&worker->err)) {
+        job_free(job);
+        return -1;
+    }
+
+    job->out = pipeline_defer();
+    if (!job->out || (!worker->running && worker_start(worker, -1))) {
+        if (job->shard) shard_sync(job->shard);
+        return job_run(job);
+    }
+
+    // The shard's own jobs come after the records queued for it
+    if (job->shard) shard_flush(job->shard);
+    job_push(worker, job);
+    return 0;
+}
+
+
+/**
+ * @brief Worker thread: runs the jobs in order until a NULL job.
+ *
+ * @param arg   The worker.
+ *
+ * @return NULL.
+ */
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *) arg;
+    ShardJob *job;
+
+    while ((job = (ShardJob *) ring_pop(&worker->jobs))) {
+        if (job_run(job)) atomic_store(&worker->err, 1);
+        atomic_fetch_add_explicit(&worker->done, 1, memory_order_release);
+    }
+    return NULL;
+}
+
+
+void worker_ini(Worker *worker) {
+
+    worker->sent = 0;
+    worker->running = 0;
+    atomic_init(&worker->done, 0);
+    atomic_init(&worker->err, 0);
+    ring_ini(&worker->jobs);
+}
+
+
+int worker_start(Worker *worker, int core) {
+    cpu_set_t cpus;
+    long ncpu;
+
+    if (pthread_create(&worker->thread, NULL, worker_main, worker)) return -1;
+    worker->running = 1;
+
+    // Keep each worker on its own core when there are enough of them
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (core >= 0 && ncpu > 1) {
+        CPU_ZERO(&cpus);
+        CPU_SET(core % ncpu, &cpus);
+        pthread_setaffinity_np(worker->thread, sizeof(cpus), &cpus);
+    }
+    return 0;
+}
+
+
+void worker_stop(Worker *worker) {
+
+    if (!worker->running) return;
+
+    ring_push(&worker->jobs, NULL);
+    pthread_join(worker->thread, NULL);
+    worker->running = 0;
+}
+
+
+int worker_failed(Worker *worker) {
+
+    return atomic_load(&worker->err);
+}
+
+
+int shard_ini(Shard *shard, int id, int threaded) {
+
+    shard->ni = 0;
+    shard->incocCap = INOCMEM;
+    shard->cold = NULL;
+    shard->room = 0;
+    shard->adds = NULL;
+    shard->dels = shard->lastdel = NULL;
+    worker_ini(&shard->worker);
+
+    // Allocate the initial memory for the inoculations array and columns
+    shard->ver = ver_new();
+    shard->inocs = (Inoc *) malloc(INOCMEM * sizeof(Inoc));
+    shard->cols.user = (int *) malloc(INOCMEM * sizeof(int));
+    shard->cols.batch = (int *) malloc(INOCMEM * sizeof(int));
+    shard->cols.date = (int *) malloc(INOCMEM * sizeof(int));
+
+    if (!shard->ver || !shard->inocs || !shard->cols.user ||
+        !shard->cols.batch || !shard->cols.date) return -1;
+
+    // Without a worker, the user listings go to the lister
+    if (threaded) worker_start(&shard->worker, id);
+    return 0;
+}
+
+
+void shard_free(Shard *shard) {
+    ShardDel *del;
+
+    worker_stop(&shard->worker);
+    segs_drop(shard->cold);
+
+    // Records still queued and deletions not reaped go with the shard
+    if (shard->adds) job_free(shard->adds);
+    while ((del = shard->dels)) {
+        shard->dels = del->next;
+        shard_del_free(del);
+    }
+
+    // The arrays go with the shard's version
+    if (shard->ver) {
+        shard->ver->inocs = shard->inocs;
+        shard->ver->cols = shard->cols;
+        ver_drop(shard->ver);
+    }
+    else {
+        free(shard->inocs);
+        free(shard->cols.user);
+        free(shard->cols.batch);
+        free(shard->cols.date);
+    }
+}
+
+
+int shard_of(const char *username, int nshards) {
+
+    return nshards == 1 ? 0 : (int) (intern_hash(username) % nshards);
+}
+
+
+/**
+ * @brief Allocates `n` records and their columns.
+ *
+ * @return 0 on success, -1 if out of memory (nothing is allocated).
+ */
+static int rows_new(int n, Inoc **inocs, InocCols *cols) {
+    int room = n ? n : 1;
+
+    *inocs = (Inoc *) malloc(room * sizeof(Inoc));
+    cols->user = (int *) malloc(room * sizeof(int));
+    cols->batch = (int *) malloc(room * sizeof(int));
+    cols->date = (int *) malloc(room * sizeof(int));
+
+    if (*inocs && cols->user && cols->batch && cols->date) return 0;
+    free(*inocs);
+    free(cols->user);
+    free(cols->batch);
+    free(cols->date);
+    return -1;
+}
+
+
+/**
+ * @brief Frees records allocated by `rows_new`.
+ */
+static void rows_free(Inoc *inocs, InocCols *cols) {
+
+    free(inocs);
+    free(cols->user);
+    free(cols->batch);
+    free(cols->date);
+}
+
+
+/**
+ * @brief Allocates record arrays for `cap` records, and their version.
+ *
+ * @return 0 on success, -1 if out of memory (nothing is allocated).
+ */
+static int arrays_new(int cap, InocVer **ver, Inoc **inocs, InocCols *cols) {
+
+    if (rows_new(cap, inocs, cols)) return -1;
+    if ((*ver = ver_new())) return 0;
+    rows_free(*inocs, cols);
+    return -1;
+}
+
+
+/**
+ * @brief Moves a shard to new arrays holding `n` records. The last snapshot
+ *          of the old version frees its arrays.
+ */
+static void shard_install(Shard *shard, InocVer *ver, Inoc *inocs,
+                        InocCols cols, int cap, int n) {
+
+    shard->ver->inocs = shard->inocs;
+    shard->ver->cols = shard->cols;
+    ver_drop(shard->ver);
+
+    shard->ver = ver;
+    shard->inocs = inocs;
+    shard->cols = cols;
+    shard->incocCap = cap;
+    shard->ni = n;
+}
+
+
+/**
+ * @brief Moves the shard to a copy of its arrays, without the first `skip`
+ *          records and with room for `cap`, and leaves the old version to
+ *          its snapshots.
+ *
+ * @return 0 on success, -1 if out of memory (nothing changes).
+ */
+static int shard_cow(Shard *shard, int cap, int skip) {
+    int n = shard->ni - skip;
+    InocVer *ver;
+    Inoc *inocs;
+    InocCols cols;
+
+    if (arrays_new(cap, &ver, &inocs, &cols)) return -1;
+
+    memcpy(inocs, shard->inocs + skip, n * sizeof(Inoc));
+    memcpy(cols.user, shard->cols.user + skip, n * sizeof(int));
+    memcpy(cols.batch, shard->cols.batch + skip, n * sizeof(int));
+    memcpy(cols.date, shard->cols.date + skip, n * sizeof(int));
+
+    shard_install(shard, ver, inocs, cols, cap, n);
+    return 0;
+}
+
+
+/**
+ * @brief Checks if a snapshot may be reading the shard's arrays. Only the
+ *          executor pins snapshots, so a version it sees unshared stays so.
+ */
+static int shard_shared(Shard *shard) {
+
+    return atomic_load_explicit(&shard->ver->refs, memory_order_acquire) > 1;
+}
+
+
+/**
+ * @brief Makes room for `need` records, copying the arrays if a snapshot
+ *          may be reading them.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int shard_reserve(Shard *shard, int need) {
+    int cap = shard->incocCap;
+    Inoc *inocs;
+
+    if (need <= cap) return 0;
+    if (!shard_shared(shard)) {
+        inocs = inoc_reserve(need, &shard->incocCap, shard->inocs,
+                            &shard->cols);
+        if (!inocs) return -1;
+        shard->inocs = inocs;
+        return 0;
+    }
+
+    while (cap < need) cap *= 2;
+    return shard_cow(shard, cap, 0);
+}
+
+
+int shard_own(Shard *shard) {
+
+    return shard_shared(shard) ? shard_cow(shard, shard->incocCap, 0) : 0;
+}
+
+
+void shard_sync(Shard *shard) {
+    Worker *worker = &shard->worker;
+    int spins = 0;
+
+    shard_flush(shard);
+    while (atomic_load_explicit(&worker->done, memory_order_acquire) !=
+            worker->sent)
+        ring_wait(&spins);
+
+    // The executor may change the records now: the room is counted again
+    shard->room = 0;
+}
+
+
+int shard_room(Shard *shard, int n) {
+    ShardJob *job;
+
+    // Deletions only free room, so the room left after the worker is done
+    // with the records queued is known without waiting for it
+    if (n > shard->room) {
+        shard_sync(shard);
+        if (shard_reserve(shard, shard->ni + n)) return -1;
+        shard->room = shard->incocCap - shard->ni;
+    }
+
+    // A worker's records are queued in a job
+    if (!shard->worker.running || shard->adds) return 0;
+    job = (ShardJob *) calloc(1, sizeof(ShardJob));
+    if (!job || !(job->add = (ShardAdd *) malloc(SHARDADDS *
+                                                sizeof(ShardAdd)))) {
+        free(job);
+        return -1;
+    }
+    job->shard = shard;
+    shard->adds = job;
+    return 0;
+}
+
+
+void shard_append(Shard *shard, char *user, int uid, Vaccine *vac, Date date,
+                long seq) {
+    ShardJob *job = shard->adds;
+    ShardAdd *add;
+
+    shard->room--;
+    if (!shard->worker.running) {
+        inoc_set(shard->inocs, &shard->cols, shard->ni++, user, uid, vac,
+                date, seq);
+        return;
+    }
+
+    add = &job->add[job->nadd++];
+    add->user = user;
+    add->uid = uid;
+    add->vac = vac;
+    add->date = date;
+    add->seq = seq;
+    if (job->nadd == SHARDADDS) shard_flush(shard);
+}
+
+
+/**
+ * @brief Finds the end of the records of the month of record `i`.
+ */
+static int month_end(Shard *shard, int i, int k) {
+    int month = shard->cols.date[i] / 100;
+
+    while (i < k && shard->cols.date[i] / 100 == month) i++;
+    return i;
+}
+
+
+int shard_freeze(Shard *shard, Date date, int map) {
+    Date month = {1, date.mm, date.yy};
+    int k = inoc_lower_bound(shard->ni, shard->cols.date, month);
+    int i, s, nseg, old = shard->cold ? shard->cold->n : 0, cap = INOCMEM;
+    SegList *list;
+    InocCols cols;
+
+    if (!k) return 0;
+    for (i = 0, nseg = 0; i < k; i = month_end(shard, i, k)) nseg++;
+
+    list = segs_new(old + nseg);
+    if (!list) return -1;
+    for (s = 0; s < old; s++) list->seg[s] = seg_pin(shard->cold->seg[s]);
+
+    // A segment per month before the date's
+    for (i = 0; i < k; i = month_end(shard, i, k), s++) {
+        cols.user = shard->cols.user + i;
+        cols.batch = shard->cols.batch + i;
+        cols.date = shard->cols.date + i;
+
+        list->seg[s] = seg_freeze(shard->inocs + i, &cols,
+                                month_end(shard, i, k) - i);
+        if (!list->seg[s]) {
+            list->n = s;
+            segs_drop(list);
+            return -1;
+        }
+        if (map) seg_map(list->seg[s]);
+    }
+
+    // Keep the later records in arrays sized for them
+    while (cap < shard->ni - k) cap *= 2;
+    if (shard_cow(shard, cap, k)) {
+        segs_drop(list);
+        return -1;
+    }
+
+    segs_drop(shard->cold);
+    shard->cold = list;
+    return 0;
+}
+
+
+/**
+ * @brief Checks if record `i` of the arrays goes before a new record.
+ */
+static int goes_before(const Inoc *inocs, const InocCols *cols, int i,
+                        const Inoc *add) {
+    int key = date_key(add->apdate);
+
+    return cols->date[i] < key ||
+            (cols->date[i] == key && inocs[i].seq < add->seq);
+}
+
+
+/**
+ * @brief Merges `n` records with `k` new ones into `out`, in order of
+ *          application.
+ */
+static void merge_rows(const Inoc *inocs, const InocCols *cols, int n,
+                        const Inoc *add, const int *uids, int k, Inoc *out,
+                        InocCols *to) {
+    int i = 0, j = 0, o;
+
+    for (o = 0; i < n || j < k; o++) {
+        if (j == k || (i < n && goes_before(inocs, cols, i, &add[j]))) {
+            out[o] = inocs[i];
+            to->user[o] = cols->user[i];
+            to->batch[o] = cols->batch[i];
+            to->date[o] = cols->date[i++];
+        }
+        else {
+            inoc_set(out, to, o, add[j].user, uids[j], add[j].vaccine,
+                    add[j].apdate, add[j].seq);
+            j++;
+        }
+    }
+}
+
+
+/**
+ * @brief Freezes a month again with new records among its own.
+ *
+ * @param seg   The month's segment, or NULL if there is none yet.
+ * @param add   The new records of the month, in order of application.
+ * @param uids  User ID of each new record.
+ * @param k     Number of new records.
+ *
+ * @return The new segment, with one reference, or NULL if out of memory.
+ */
+static Seg *seg_merge(const Seg *seg, const Inoc *add, const int *uids,
+                    int k) {
+    int n = seg ? seg->n : 0;
+    Inoc *old = NULL, *all;
+    InocCols cols, part;
+    Seg *fresh = NULL;
+
+    if (rows_new(n + k, &all, &cols)) return NULL;
+    if (n && rows_new(n, &old, &part)) {
+        rows_free(all, &cols);
+        return NULL;
+    }
+
+    if (!n || !seg_thaw(seg, old, &part)) {
+        merge_rows(old, &part, n, add, uids, k, all, &cols);
+        fresh = seg_freeze(all, &cols, n + k);
+    }
+
+    if (n) rows_free(old, &part);
+    rows_free(all, &cols);
+    return fresh;
+}
+
+
+/**
+ * @brief Month of a record, as in `Seg`.
+ */
+static int month_of(const Inoc *inoc) {
+
+    return inoc->apdate.yy * 100 + inoc->apdate.mm;
+}
+
+
+/**
+ * @brief Builds the list of segments with the new records of past months
+ *          among them: the months touched are frozen again, or for the
+ *          first time, and the others are shared with the current list.
+ *
+ * @return The list, with one reference, or NULL if out of memory.
+ */
+static SegList *segs_merge(SegList *cold, const Inoc *add, const int *uids,
+                        int n, int map) {
+    int old = cold ? cold->n : 0, s, j, k, nseg, pass, month;
+    SegList *list = NULL;
+    Seg *seg;
+
+    // Count the segments, then fill them in
+    for (pass = 0; pass < 2; pass++) {
+        for (s = 0, j = 0, nseg = 0; s < old || j < n; nseg++) {
+            month = j < n ? month_of(&add[j]) : INT_MAX;
+            seg = s < old && cold->seg[s]->month <= month ?
+                    cold->seg[s++] : NULL;
+
+            // A month without new records is kept as it is
+            if (seg && seg->month < month) {
+                if (pass) list->seg[nseg] = seg_pin(seg);
+                continue;
+            }
+
+            for (k = j; k < n && month_of(&add[k]) == month; k++);
+            if (pass) {
+                if (!(list->seg[nseg] = seg_merge(seg, add + j, uids + j,
+                                                k - j))) {
+                    list->n = nseg;
+                    segs_drop(list);
+                    return NULL;
+                }
+                if (map) seg_map(list->seg[nseg]);
+            }
+            j = k;
+        }
+        if (!pass && !(list = segs_new(nseg))) return NULL;
+    }
+    return list;
+}
+
+
+int shard_merge(Shard *shard, const Inoc *add, const int *uids, int n,
+                int map) {
+    SegList *cold = shard->cold, *list = NULL;
+    int last = cold && cold->n ? cold->seg[cold->n - 1]->month : 0;
+    int split, cap = INOCMEM;
+    InocVer *ver;
+    Inoc *inocs;
+    InocCols cols;
+
+    // Records of the frozen months go to their segments, the later ones
+    // to the arrays
+    for (split = n; split > 0 && month_of(&add[split - 1]) > last; split--);
+
+    if (split && !(list = segs_merge(cold, add, uids, split, map))) return -1;
+
+    if (split < n) {
+        while (cap < shard->ni + n - split) cap *= 2;
+        if (arrays_new(cap, &ver, &inocs, &cols)) {
+            segs_drop(list);
+            return -1;
+        }
+        merge_rows(shard->inocs, &shard->cols, shard->ni, add + split,
+                    uids + split, n - split, inocs, &cols);
+        shard_install(shard, ver, inocs, cols, cap,
+                    shard->ni + n - split);
+    }
+
+    if (list) {
+        segs_drop(cold);
+        shard->cold = list;
+    }
+    return 0;
+}
+
+
+/**
+ * @brief Checks if a segment may hold records to delete.
+ */
+static int seg_hit(const Seg *seg, int uid, int read_date, Date date) {
+
+    return seg_has_user(seg, uid) &&
+            (!read_date || seg->month == date.yy * 100 + date.mm);
+}
+
+
+int shard_delete(Shard *shard, ShardDel *del) {
+    int uid = del->uid, read_date = del->read_date, bid = del->bid;
+    int read_batch = del->read_batch, ni = shard->ni, i, s, r, n = 0;
+    int ngone = 0, nhot = 0, is_hit = 0, is_user = 0, failed;
+    SegList *cold = shard->cold, *list = NULL;
+    Inoc *gone = NULL, *grown;
+    Date date = del->date;
+    Seg *seg, *fresh;
+
+    del->removed = 0;
+    del->gone = NULL;
+    for (s = 0; uid != -1 && cold && s < cold->n; s++) {
+        is_user |= seg_has_user(cold->seg[s], uid);
+        is_hit |= seg_hit(cold->seg[s], uid, read_date, date);
+    }
+
+    // The user's records not frozen: at most these leave the arrays
+    for (i = uid == -1 ? ni : scan_eq(shard->cols.user, 0, ni, uid); i < ni;
+        i = scan_eq(shard->cols.user, i + 1, ni, uid)) nhot++;
+    if (nhot) is_user = 1;
+
+    if (!is_user) return del->status = VMS_EINVUSER;
+    if (!del->val_date) return del->status = VMS_EINVDATE;
+    if (shard_own(shard)) return del->status = VMS_ENOMEMORY;
+
+    // Frozen records: the new segments are built before the first change
+    if (is_hit && !(list = segs_new(cold->n)))
+        return del->status = VMS_ENOMEMORY;
+    for (s = 0; list && s < cold->n; s++) {
+        seg = cold->seg[s];
+        fresh = NULL;
+        r = 0;
+
+        if (seg_hit(seg, uid, read_date, date)) {
+            grown = (Inoc *) realloc(gone, (ngone + seg->n) * sizeof(Inoc));
+            if (grown) gone = grown;
+            r = grown ? seg_remove(seg, uid, read_date, read_batch, date, bid,
+                                    gone + ngone, &fresh) : -1;
+            if (r == -1) break;
+            ngone += r;
+        }
+
+        if (!r) list->seg[n++] = seg_pin(seg);
+        else if (fresh) {
+            if (seg->mapped) seg_map(fresh);
+            list->seg[n++] = fresh;
+        }
+    }
+
+    // And room for the records not frozen, before the first change
+    failed = list && s < cold->n;
+    if (!failed && nhot) {
+        grown = (Inoc *) realloc(gone, (ngone + nhot) * sizeof(Inoc));
+        if (grown) gone = grown;
+        failed = !grown;
+    }
+    if (list) list->n = n;
+    if (failed) {
+        segs_drop(list);
+        free(gone);
+        return del->status = VMS_ENOMEMORY;
+    }
+    if (list) {
+        segs_drop(shard->cold);
+        shard->cold = list;
+    }
+
+    // Then the records not frozen
+    r = inoc_remove(ni, shard->inocs, &shard->cols, uid, read_date,
+                    read_batch, date, bid, gone ? gone + ngone : NULL);
+    if (r > 0) {
+        shard->ni -= r;
+        ngone += r;
+    }
+
+    del->gone = gone;
+    del->removed = ngone;
+    return del->status = read_batch && !ngone ? VMS_ENOBATCH : VMS_OK;
+}
+
+
+int shard_delete_defer(Shard *shard, ShardDel *del) {
+    ShardJob *job;
+
+    if (!shard->worker.running) return 0;
+    if (!(job = (ShardJob *) calloc(1, sizeof(ShardJob)))) return -1;
+    if (!(job->out = pipeline_defer())) {
+        free(job);
+        return 0;
+    }
+
+    job->shard = shard;
+    job->del = del;
+    atomic_init(&del->done, 0);
+    del->next = NULL;
+    if (shard->lastdel) shard->lastdel->next = del;
+    else shard->dels = del;
+    shard->lastdel = del;
+
+    shard_flush(shard);
+    job_push(&shard->worker, job);
+    return 1;
+}
+
+
+ShardDel *shard_reap(Shard *shard, int wait) {
+    ShardDel *del = shard->dels;
+    int spins = 0;
+
+    if (!del) return NULL;
+    while (!atomic_load_explicit(&del->done, memory_order_acquire)) {
+        if (!wait) return NULL;
+        ring_wait(&spins);
+    }
+
+    shard->dels = del->next;
+    if (!shard->dels) shard->lastdel = NULL;
+    return del;
+}
+
+
+void shard_del_free(ShardDel *del) {
+
+    free(del->gone);
+    free(del->user);
+    free(del->batch);
+    free(del);
+}
+
+
+int shard_list_user(Shard *shard, Worker *lister, int uid,
+                    const char *username, int is_pt) {
+    ShardJob *job = (ShardJob *) calloc(1, sizeof(ShardJob));
+
+    if (!job || !(job->username = strdup(username))) {
+        free(job);
+        return -1;
+    }
+
+    job->uid = uid;
+    job->is_pt = is_pt;
+
+    // The shard's own worker pins the records when it runs the listing
+    if (shard->worker.running) {
+        job->shard = shard;
+        return job_send(&shard->worker, job);
+    }
+
+    job->nsnap = 1;
+    snap_take(shard, &job->snap[0], 0, shard->ni);
+    return job_send(lister, job);
+}
+
+
+int shard_list_prefix(Shard *shards, int nshards, Worker *lister,
+                    const char *prefix, size_t len) {
+    ShardJob *job = (ShardJob *) calloc(1, sizeof(ShardJob));
+    int s;
+
+    if (!job || !(job->filter = strndup(prefix, len))) {
+        free(job);
+        return -1;
+    }
+
+    job->is_prefix = 1;
+    job->first = 0;
+    job->last = INT_MAX;
+    for (s = 0; s < nshards; s++) {
+        shard_sync(&shards[s]);
+        snap_take(&shards[s], &job->snap[s], 0, shards[s].ni);
+    }
+    job->nsnap = nshards;
+
+    return job_send(lister, job);
+}
+
+
+int shard_list(Shard *shards, int nshards, Worker *lister, const Date *from,
+                const Date *to, const char *filter) {
+    ShardJob *job = (ShardJob *) calloc(1, sizeof(ShardJob));
+    Date after;
+    int s, first, last;
+
+    if (!job || (filter && !(job->filter = strdup(filter)))) {
+        free(job);
+        return -1;
+    }
+
+    job->first = from ? date_key(*from) : 0;
+    job->last = from ? date_key(*to) : INT_MAX;
+
+    for (s = 0; s < nshards; s++) {
+        shard_sync(&shards[s]);
+        first = 0;
+        last = shards[s].ni;
+
+        // Records are ordered by date: find the range by binary search
+        if (from) {
+            after = *to;
+            after.dd++;
+            first = inoc_lower_bound(shards[s].ni, shards[s].cols.date, *from);
+            last = inoc_lower_bound(shards[s].ni, shards[s].cols.date, after);
+            if (last < first) last = first;
+        }
+        snap_take(&shards[s], &job->snap[s], first, last);
+    }
+    job->nsnap = nshards;
+
+    return job_send(lister, job);
+}
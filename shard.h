@@ -0,0 +1,392 @@
+/**
+ * @file shard.h
+ * @brief Inoculation records split into shards by username, and snapshot
+ *          listings.
+ *
+ * Each user's records live in exactly one shard, picked by a hash of the
+ * username. A shard with a worker thread has its records changed by the
+ * worker: the executor queues the records it applies for the worker to
+ * append, and hands it the deletions of `d` in a pipeline run. Anything
+ * else the executor does to the records waits for the worker to go idle
+ * (`shard_sync`). Listings read a snapshot of them instead, pinned by the
+ * thread that changes the records, so they never wait for changes or make
+ * changes wait:
+ * - new records are appended past the end of every snapshot;
+ * - moving or rewriting records (growing the arrays, deleting) while a
+ *   snapshot is pinned copies the arrays first (copy-on-write), and the old
+ *   version is freed by whoever drops its last reference.
+ *
+ * Once a month is over, its records are frozen into a compressed segment
+ * (seg.h) and only the current month's stay in the arrays. Readers go
+ * through `InocIter`, which decodes the segments first.
+ *
+ * Listing output keeps its place in the stream through deferred output.
+ * Records carry their date and a global sequence number, so listings over
+ * all shards are merged back into the order of a single store.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _SHARD_H_
+#define _SHARD_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "inoc.h"
+#include "seg.h"
+#include "pipeline.h"
+
+#define MAXSHARDS       64      /**< max. num. of shards    */
+
+
+/**
+ * @struct InocVer
+ * @brief A version of a shard's record arrays.
+ *
+ * The shard holds a reference to its current version and each pinned
+ * snapshot holds another. The arrays are stored here once the shard moves
+ * to a new version, and freed with the last reference.
+ */
+typedef struct {
+    atomic_int refs;        /**< References to the version  */
+    Inoc *inocs;        /**< Records, once replaced */
+    InocCols cols;      /**< Columns, once replaced */
+} InocVer;
+
+
+/**
+ * @struct Snap
+ * @brief A pinned, unchanging view of a range of a shard's records.
+ */
+typedef struct {
+    InocVer *ver;       /**< Version pinned */
+    Inoc *inocs;        /**< Records of the version */
+    InocCols cols;      /**< Columns of the version */
+    int from, to;       /**< Range of records visible   */
+    SegList *cold;      /**< Frozen segments pinned (NULL if none)  */
+} Snap;
+
+
+/**
+ * @struct Worker
+ * @brief A thread that runs listing jobs in order.
+ */
+typedef struct {
+    Ring jobs;      /**< Jobs sent to the worker, in order  */
+    long sent;      /**< Jobs sent so far (executor only)   */
+    _Alignas(CACHELINE) atomic_long done;       /**< Jobs finished  */
+    atomic_int err;     /**< 1 if a job ran out of memory   */
+    pthread_t thread;       /**< Worker thread  */
+    int running;        /**< 1 if the worker thread was started */
+} Worker;
+
+
+/**
+ * @struct Shard
+ * @brief The inoculation records of a subset of the users, and the worker
+ *          thread that lists them.
+ */
+typedef struct {
+    int ni, incocCap;       /**< Number of inocs and inoc capacity */
+    Inoc *inocs;        /**< Inoculation records, in order of application */
+    InocCols cols;      /**< Column layout of the inoculation records */
+    InocVer *ver;       /**< Version of the arrays above    */
+    SegList *cold;      /**< Frozen months, before the records above  */
+    Worker worker;      /**< Worker for the shard's users   */
+    int room;       /**< Records that may still be queued (executor only) */
+    struct ShardJob *adds;      /**< Records queued (executor only) */
+    struct ShardDel *dels, *lastdel;    /**< Deletions handed to the worker
+                                            and not reaped (executor only) */
+} Shard;
+
+
+/**
+ * @struct ShardDel
+ * @brief A deletion of a user's records, and what it removed.
+ *
+ * In a pipeline run the deletion is handed to the shard's worker, which
+ * writes the count or the error in place, as `d` prints them; the executor
+ * accounts for the records removed once it reaps the deletion.
+ */
+typedef struct ShardDel {
+    int uid;        /**< The user ID (-1 if never seen)   */
+    int bid;        /**< The batch ID (-1 if never seen)  */
+    int read_date, read_batch;      /**< Filters in use */
+    int val_date;       /**< 1 if the date is valid */
+    Date date;      /**< The date to filter by  */
+    char *user, *batch;     /**< Names for the errors (batch may be NULL) */
+    int is_pt;      /**< Language flag  */
+    int status;     /**< Outcome: VMS_OK or an error    */
+    int removed;        /**< Number of records removed  */
+    Inoc *gone;     /**< Copies of the records removed  */
+    atomic_int done;        /**< 1 once the worker is done with it  */
+    struct ShardDel *next;      /**< Next deletion handed to the worker */
+} ShardDel;
+
+
+/**
+ * @brief Initializes a worker without starting its thread.
+ *
+ * @param worker    Worker to initialize.
+ */
+void worker_ini(Worker *worker);
+
+
+/**
+ * @brief Starts a worker's thread.
+ *
+ * @param worker    Worker to start.
+ * @param core      Core to pin the thread to (modulo the number of cores),
+ *                  or -1 to leave it free.
+ *
+ * @return 0 on success, -1 if the thread could not be started.
+ */
+int worker_start(Worker *worker, int core);
+
+
+/**
+ * @brief Stops a worker's thread once its jobs are done.
+ *
+ * @param worker    Worker to stop.
+ */
+void worker_stop(Worker *worker);
+
+
+/**
+ * @brief Checks if a job of a worker ran out of memory.
+ *
+ * @param worker    The worker.
+ *
+ * @return 1 if a job failed, 0 otherwise.
+ */
+int worker_failed(Worker *worker);
+
+
+/**
+ * @brief Initializes an empty shard.
+ *
+ * @param shard     Shard to initialize.
+ * @param id        Shard number; the worker is pinned to core `id`, modulo
+ *                  the number of cores.
+ * @param threaded  1 to start a worker thread, 0 to list in the lister.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int shard_ini(Shard *shard, int id, int threaded);
+
+
+/**
+ * @brief Stops the shard's worker, once its jobs are done, and frees the
+ *          shard. Snapshots of the shard must have been dropped.
+ *
+ * @param shard Shard to free.
+ */
+void shard_free(Shard *shard);
+
+
+/**
+ * @brief Picks the shard of a user.
+ *
+ * @param username  The username.
+ * @param nshards   Number of shards.
+ *
+ * @return Shard number, in [0, nshards).
+ */
+int shard_of(const char *username, int nshards);
+
+
+/**
+ * @brief Waits until the shard's worker has run every job sent, after
+ *          handing it the records queued, so the executor may use the
+ *          shard's records. Deletions are left to `shard_reap`.
+ *
+ * @param shard The shard.
+ */
+void shard_sync(Shard *shard);
+
+
+/**
+ * @brief Makes room to queue `n` more records with `shard_append`, waiting
+ *          for the worker only when the room reserved runs out.
+ *
+ * @param shard The shard.
+ * @param n     Number of records.
+ *
+ * @return 0 on success, -1 if out of memory (nothing changes).
+ */
+int shard_room(Shard *shard, int n);
+
+
+/**
+ * @brief Appends a record, or queues it for the shard's worker to append.
+ *          Room must have been made with `shard_room`.
+ *
+ * @param shard The shard.
+ * @param user  The username (interned).
+ * @param uid   The user ID.
+ * @param vac   The batch applied.
+ * @param date  The date of application.
+ * @param seq   The sequence number.
+ */
+void shard_append(Shard *shard, char *user, int uid, Vaccine *vac, Date date,
+                long seq);
+
+
+/**
+ * @brief Makes the shard's records safe to move or rewrite, copying the
+ *          arrays if a snapshot may be reading them.
+ *
+ * @param shard The shard.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int shard_own(Shard *shard);
+
+
+/**
+ * @brief Freezes the records of the months before a date into segments,
+ *          keeping only the later ones in the arrays. The shard must be
+ *          idle (`shard_sync`).
+ *
+ * @param shard The shard.
+ * @param date  The current date.
+ * @param map   1 to map the segments from temporary files.
+ *
+ * @return 0 on success, -1 if out of memory (nothing changes).
+ */
+int shard_freeze(Shard *shard, Date date, int map);
+
+
+/**
+ * @brief Deletes a user's inoculations, frozen or not, optionally only
+ *          those of a date, or of a date and a batch. Run by the shard's
+ *          worker, or by the executor once the worker is idle.
+ *
+ * @param shard Shard of the user.
+ * @param del   The deletion; its outcome, count and the records removed
+ *              (to be freed by the caller) are stored in it.
+ *
+ * @return VMS_OK, VMS_EINVUSER if the user has no records, VMS_EINVDATE if
+ *          the date is invalid, VMS_ENOBATCH if no record of the batch
+ *          matched or VMS_ENOMEMORY (nothing changes).
+ */
+int shard_delete(Shard *shard, ShardDel *del);
+
+
+/**
+ * @brief Hands a deletion to the shard's worker, which writes its count or
+ *          error in place in the output. Needs a worker and a pipeline.
+ *
+ * @param shard Shard of the user.
+ * @param del   The deletion, allocated with its names copied; the shard
+ *              keeps it until it is reaped.
+ *
+ * @return 1 if it was handed off, 0 if there is no worker or no pipeline
+ *          (nothing changes), -1 if out of memory.
+ */
+int shard_delete_defer(Shard *shard, ShardDel *del);
+
+
+/**
+ * @brief Takes the oldest deletion handed to the shard's worker, once the
+ *          worker has finished it.
+ *
+ * @param shard The shard.
+ * @param wait  1 to wait for the worker to finish it, 0 to leave it.
+ *
+ * @return The deletion (to be freed with `shard_del_free`), or NULL if
+ *          none is left (or finished, without waiting).
+ */
+ShardDel *shard_reap(Shard *shard, int wait);
+
+
+/**
+ * @brief Frees a deletion, its names and the records it removed.
+ *
+ * @param del   The deletion.
+ */
+void shard_del_free(ShardDel *del);
+
+
+/**
+ * @brief Merges records into a shard, in order of application. Only the
+ *          months of the new records are written again: each frozen month
+ *          touched is thawed, merged and frozen again (or frozen for the
+ *          first time), the later records are merged into the arrays, and
+ *          the other segments are kept as they are. The records keep their
+ *          sequence numbers. The shard must be idle (`shard_sync`).
+ *
+ * @param shard The shard.
+ * @param add   The new records, in order of date and then of sequence
+ *              number, higher than the shard's.
+ * @param uids  User ID of each new record.
+ * @param n     Number of new records.
+ * @param map   1 to map the new segments from temporary files.
+ *
+ * @return 0 on success, -1 if out of memory (nothing changes).
+ */
+int shard_merge(Shard *shard, const Inoc *add, const int *uids, int n,
+                int map);
+
+
+/**
+ * @brief Lists a user's inoculations, as `u <user>` prints them.
+ *
+ * In a pipeline run the listing is handed to a worker (the shard's, or the
+ * lister) and written in place later; otherwise it is printed right away.
+ *
+ * @param shard     Shard of the user.
+ * @param lister    Worker for shards without their own.
+ * @param uid       ID of the user.
+ * @param username  The username, for the error message.
+ * @param is_pt     The language flag.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int shard_list_user(Shard *shard, Worker *lister, int uid,
+                    const char *username, int is_pt);
+
+
+/**
+ * @brief Lists the inoculations of every user whose name starts with a
+ *          prefix, user by user in alphabetical order, as
+ *          `u <user>` prints them.
+ *
+ * Every shard is merged and filtered in one pass, which beats one listing
+ * per user when the prefix matches many users.
+ *
+ * @param shards    The shards.
+ * @param nshards   Number of shards.
+ * @param lister    Worker for the listing.
+ * @param prefix    The prefix.
+ * @param len       Length of the prefix.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int shard_list_prefix(Shard *shards, int nshards, Worker *lister,
+                    const char *prefix, size_t len);
+
+
+/**
+ * @brief Lists the inoculations of every shard, in order of application,
+ *          optionally only those applied between two dates and of a vaccine
+ *          or batch, as `u` and `i` print them.
+ *
+ * In a pipeline run the listing is handed to the lister and written in
+ * place later; otherwise it is printed right away.
+ *
+ * @param shards    The shards.
+ * @param nshards   Number of shards.
+ * @param lister    Worker for the listing.
+ * @param from      First date, or NULL for all the records.
+ * @param to        Last date (used only with `from`).
+ * @param filter    Vaccine name or batch ID to list, or NULL for all.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int shard_list(Shard *shards, int nshards, Worker *lister, const Date *from,
+                const Date *to, const char *filter);
+
+#endif
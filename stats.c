@@ -0,0 +1,126 @@
+/**
+ * @file stats.c
+ * @brief Dose counters per vaccine, per batch and per day.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include "stats.h"
+
+
+Stats stats_ini() {
+    Stats stats;
+
+    stats.nvac = stats.nday = 0;
+    stats.vacCap = stats.dayCap = 0;
+    stats.vac = NULL;
+    stats.day = NULL;
+
+    return stats;
+}
+
+
+void stats_free(Stats *stats) {
+
+    free(stats->vac);
+    free(stats->day);
+}
+
+
+int stats_add(Stats *stats, Vaccine *vac, Date date) {
+    int vid = vac->vid, cap, i;
+    int *new_vac;
+    DayCount *new_day;
+
+    // Make room for the vaccine counter (new IDs start at zero)
+    if (vid >= stats->vacCap) {
+        cap = stats->vacCap ? stats->vacCap : STATSMEM;
+        while (cap <= vid) cap *= 2;
+
+        new_vac = (int *) realloc(stats->vac, cap * sizeof(int));
+        if (!new_vac) return -1;
+
+        stats->vac = new_vac;
+        stats->vacCap = cap;
+    }
+    while (stats->nvac <= vid) stats->vac[stats->nvac++] = 0;
+
+    // Records are mostly dated with the current date, the last day or a new 
+    // one; imported ones may go back, so look for the day from the end
+    for (i = stats->nday; 
+        i > 0 && compare_dates(stats->day[i - 1].date, date) == -1; i--);
+
+    if (!i || compare_dates(stats->day[i - 1].date, date)) {
+
+        if (stats->nday == stats->dayCap) {
+            cap = stats->dayCap ? 2 * stats->dayCap : STATSMEM;
+            new_day = (DayCount *) realloc(stats->day, cap * sizeof(DayCount));
+            if (!new_day) return -1;
+
+            stats->day = new_day;
+            stats->dayCap = cap;
+        }
+        memmove(stats->day + i + 1, stats->day + i, 
+                (stats->nday - i) * sizeof(DayCount));
+        stats->day[i].date = date;
+        stats->day[i].doses = 0;
+        stats->nday++;
+        i++;
+    }
+
+    stats->vac[vid]++;
+    vac->ninocs++;
+    stats->day[i - 1].doses++;
+    return 0;
+}
+
+
+void stats_remove(Stats *stats, Vaccine *vac, Date date) {
+    int low = 0, high = stats->nday - 1, mid, cmp;
+
+    stats->vac[vac->vid]--;
+    vac->ninocs--;
+
+    // Binary search for the record's day
+    while (low <= high) {
+        mid = low + (high - low) / 2;
+        cmp = compare_dates(stats->day[mid].date, date);
+
+        if (!cmp) { stats->day[mid].doses--; return; }
+
+        if (cmp == 1) low = mid + 1;
+        else high = mid - 1;
+    }
+}
+
+
+void stats_print_vac(Stats *stats, Intern *vacnames) {
+    int i;
+
+    for (i = 0; i < vacnames->n; i++)
+        printf("%s %d\n", vacnames->str[i],
+                i < stats->nvac ? stats->vac[i] : 0);
+}
+
+
+void stats_print_batch(Vaccine *batches[], int nb) {
+    int i;
+
+    for (i = 0; i < nb; i++)
+        printf("%s %s %d\n", batches[i]->batch, batches[i]->name,
+                batches[i]->ninocs);
+}
+
+
+void stats_print_day(Stats *stats) {
+    DayCount *day;
+    int i;
+
+    for (i = 0; i < stats->nday; i++) {
+        day = &stats->day[i];
+        if (day->doses)
+            printf("%02d-%02d-%d %d\n", day->date.dd, day->date.mm,
+                    day->date.yy, day->doses);
+    }
+}
@@ -0,0 +1,117 @@
+/**
+ * @file stats.h
+ * @brief Incrementally maintained dose counters for reporting.
+ *
+ * The counters follow the inoculation records: they are updated in O(1)
+ * when a record is added (`a`) or deleted (`d`), so reports never scan the
+ * records. Doses are counted per vaccine, per batch and per day.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vaccine.h"
+#include "intern.h"
+#include "date.h"
+
+#define STATSMEM        64      /**< Initial counters per dimension */
+
+
+/**
+ * @struct DayCount
+ * @brief Doses applied on one day.
+ */
+typedef struct {
+    Date date;      /**< Application date   */
+    int doses;      /**< Doses on file for that date    */
+} DayCount;
+
+
+/**
+ * @struct Stats
+ * @brief Dose counters per vaccine and per day.
+ *
+ * Per-batch counters live in each `Vaccine` (`ninocs`). Days are kept in
+ * date order; records are mostly added with the current date, at the end.
+ */
+typedef struct {
+    int nvac, vacCap;       /**< Vaccine counters used and allocated    */
+    int *vac;       /**< Doses on file per vaccine name ID  */
+
+    int nday, dayCap;       /**< Day counters used and allocated    */
+    DayCount *day;      /**< Doses on file per day, by date */
+} Stats;
+
+
+/**
+ * @brief Initializes empty counters.
+ *
+ * @return Initialized Stats structure.
+ */
+Stats stats_ini();
+
+
+/**
+ * @brief Frees the counters.
+ *
+ * @param stats Pointer to the counters.
+ */
+void stats_free(Stats *stats);
+
+
+/**
+ * @brief Counts a new inoculation record.
+ *
+ * @param stats Pointer to the counters.
+ * @param vac   Batch of the record.
+ * @param date  Application date of the record (usually the current date).
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int stats_add(Stats *stats, Vaccine *vac, Date date);
+
+
+/**
+ * @brief Uncounts an inoculation record that is being deleted.
+ *
+ * @param stats Pointer to the counters.
+ * @param vac   Batch of the record.
+ * @param date  Application date of the record.
+ */
+void stats_remove(Stats *stats, Vaccine *vac, Date date);
+
+
+/**
+ * @brief Prints the doses on file per vaccine: "<name> <doses>".
+ *
+ * @param stats     Pointer to the counters.
+ * @param vacnames  Vaccine names, by ID.
+ */
+void stats_print_vac(Stats *stats, Intern *vacnames);
+
+
+/**
+ * @brief Prints the doses on file per batch: "<batch> <name> <doses>".
+ *
+ * @param batches   The table of vaccine batches, in the order to print.
+ * @param nb        The number of batches.
+ */
+void stats_print_batch(Vaccine *batches[], int nb);
+
+
+/**
+ * @brief Prints the doses on file per day: "<dd-mm-yyyy> <doses>".
+ *
+ * Days whose records were all deleted are skipped.
+ *
+ * @param stats Pointer to the counters.
+ */
+void stats_print_day(Stats *stats);
+
+#endif
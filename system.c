@@ -12,25 +12,79 @@
 #include "system.h"
 
 
-Sys sys_ini(int argc, char *argv[]) {
-    Sys sys;
+int sys_open(Sys *sys, int nshards) {
+    int i;
+
+    if (nshards < 1) nshards = 1;
+    if (nshards > MAXSHARDS) nshards = MAXSHARDS;
 
     // Set inicial values
-    sys.nb = sys.ni = 0;
-    sys.incocCap = INOCMEM;
-    sys.date.dd = INIDD;
-    sys.date.mm = INIMM;
-    sys.date.yy = INIYY;
+    sys->nb = 0;
+    sys->seq = 0;
+    sys->date.dd = INIDD;
+    sys->date.mm = INIMM;
+    sys->date.yy = INIYY;
+    sys->is_pt = 0;
+    sys->is_wire = 0;
+    sys->is_mapped = 0;
+
+    // No batches yet: empty expiry and stock heaps
+    sys->expiry = heap_ini(compare_batches, offsetof(Vaccine, exppos));
+    sys->stock = heap_ini(compare_batches, offsetof(Vaccine, stockpos));
 
-    // Allocate the initial memory for the inoculations array
-    sys.inocs = (Inoc *) malloc(INOCMEM * sizeof(Inoc));
+    // Names and dose counters start empty
+    sys->vacnames = intern_ini();
+    sys->batchnames = intern_ini();
+    sys->usernames = intern_ini();
+    sys->names = names_ini();
+    sys->stats = stats_ini();
+    sys->rank = rank_ini();
+    sys->recall = recall_ini();
+    sys->today = today_ini(sys->date);
+    sys->lcache = lcache_ini();
+    sys->feed = feed_ini();
 
-    // Initialize the hash table for quick lookups
-    sys.hash = hash_ini();
+    // Shards of inoculation records; a single one needs no worker thread
+    sys->nshards = 0;
+    worker_ini(&sys->lister);
+    sys->shards = (Shard *) aligned_alloc(CACHELINE, nshards * sizeof(Shard));
+    if (!sys->shards || !sys->today.slot) return -1;
 
-    // Check if the second command-line argument is "pt" -> Portuguese language
-    sys.is_pt = (argc == 2 && !strcmp(argv[1], "pt")) ? 1 : 0;
+    for (i = 0; i < nshards; i++)
+        if (shard_ini(&sys->shards[sys->nshards++], i, nshards > 1)) 
+            return -1;
 
+    return 0;
+}
+
+
+Sys sys_ini(int argc, char *argv[]) {
+    Sys sys;
+    int i, is_pt = 0, is_wire = 0, is_mapped = 0, nshards = 1;
+    const char *feed = NULL;
+
+    // "pt" -> Portuguese language; "-s<N>" -> N shards; "-b" -> binary;
+    // "-m" -> frozen months mapped from temporary files; "-f<name>" -> 
+    // change feed in the shared memory object <name>
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "pt")) is_pt = 1;
+        else if (!strcmp(argv[i], "-b")) is_wire = 1;
+        else if (!strcmp(argv[i], "-m")) is_mapped = 1;
+        else if (!strncmp(argv[i], "-s", 2)) nshards = atoi(argv[i] + 2);
+        else if (!strncmp(argv[i], "-f", 2) && argv[i][2]) feed = argv[i] + 2;
+    }
+
+    i = sys_open(&sys, nshards);
+    sys.is_pt = is_pt;
+    sys.is_wire = is_wire;
+    sys.is_mapped = is_mapped;
+    if (i) no_mem(&sys);
+
+    // Without its feed the system still runs
+    if (feed && feed_open(&sys.feed, feed)) {
+        printf("%s", feed);
+        is_pt ? puts(EFILE_PT): puts(EFILE_EN);
+    }
     return sys;
 }
 
@@ -38,18 +92,31 @@ Sys sys_ini(int argc, char *argv[]) {
 void free_mem(Sys *sys) {
     int i;
     
+    // Stop the workers first: their jobs read the batches and names
+    worker_stop(&sys->lister);
+    for (i = 0; i < sys->nshards; i++) worker_stop(&sys->shards[i].worker);
+
     // Free batches memory
-    for (i = 0; i < sys->nb; i++) {
-        free(sys->batches[i].name);
-        free(sys->batches[i].batch);
-    }
+    for (i = 0; i < sys->nb; i++) free(sys->batches[i]);
 
-    // Free hash memory
-    hash_free(&sys->hash);
+    // Free heap, names and counters memory
+    heap_free(&sys->expiry);
+    heap_free(&sys->stock);
+    intern_free(&sys->vacnames);
+    intern_free(&sys->batchnames);
+    intern_free(&sys->usernames);
+    names_free(&sys->names);
+    stats_free(&sys->stats);
+    rank_free(&sys->rank);
+    recall_free(&sys->recall);
+    today_free(&sys->today);
+    lcache_free(&sys->lcache);
+    feed_close(&sys->feed);
 
     // Free inoculations memory
-    for (i = 0; i < sys->ni; i++) free(sys->inocs[i].user); 
-    free(sys->inocs);
+    for (i = 0; i < sys->nshards; i++) shard_free(&sys->shards[i]);
+    free(sys->shards);
+    sys->nshards = 0;
 }
 
 
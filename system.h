@@ -5,7 +5,7 @@
  * This file contains the definitions for the main system structure and related
  * functions in the Vaccine Management System. The `Sys` structure represents 
  * the system, including the vaccine batches, inoculation records, and the 
- * current system date. It also manages the system's hash table and memory 
+ * current system date. It also manages the system's name tables and memory 
  * handling.
  * 
  * @author ist1114493 (Tomás Gomes)
@@ -20,6 +20,15 @@
 
 #include "vaccine.h"
 #include "inoc.h"
+#include "shard.h"
+#include "intern.h"
+#include "names.h"
+#include "stats.h"
+#include "rank.h"
+#include "recall.h"
+#include "today.h"
+#include "lcache.h"
+#include "feed.h"
 #include "date.h"
 
 #define MAXBATCHES      1000        /**< max. num. of batches   */
@@ -36,21 +45,57 @@
  */
 typedef struct {
     int nb;     /**< Number of vaccine batches in the system */
-    Vaccine batches[MAXBATCHES];        /**< Array of vaccine batches */
-
-    int ni, incocCap;       /**< Number of inocs and inoc capacity */
-    Inoc *inocs;        /**< Pointer to an array of inoculation records */
-
-    Hash hash;      /**< Hash table for quick lookup of inoculation records */
+    Vaccine *batches[MAXBATCHES];       /**< Table of vaccine batches */
+    Vaccine *byname[MAXBATCHES];        /**< Batches by name, then expiry */
+    Heap expiry;        /**< Unexpired batches, earliest expiration first */
+    Heap stock;     /**< Unexpired batches with doses, earliest first */
+
+    int nshards;        /**< Number of shards of inoculation records */
+    Shard *shards;      /**< Inoculation records, split by username */
+    Worker lister;      /**< Worker for listings over every shard */
+    long seq;       /**< Sequence number of the next inoculation */
+
+    Intern vacnames;        /**< Interned vaccine names */
+    Intern batchnames;      /**< Interned batch IDs */
+    Intern usernames;       /**< Interned usernames */
+    NameIndex names;        /**< Usernames in alphabetical order */
+    Stats stats;        /**< Dose counters per vaccine, batch and day */
+    Rank rank;      /**< Users ranked by their number of records */
+    Recall recall;      /**< Records of each batch, for recalls */
+    Today today;        /**< Users and vaccines applied on the current date */
+    LCache lcache;      /**< Text of the batch listings */
+    Feed feed;      /**< Change feed for other processes (feed.h) */
 
     Date date;      /**< Current system date */
     int is_pt;      /**< Language flag (1 for Portuguese, 0 for English) */
+    int is_wire;        /**< 1 to serve the binary protocol (wire.h) */
+    int is_mapped;      /**< 1 to map frozen months from temporary files */
 } Sys;
 
 
+/**
+ * @brief Initializes the system with default values, in English.
+ * 
+ * If it runs out of memory the system may be partly initialized; it must 
+ * still be freed with `free_mem`.
+ * 
+ * @param sys       Pointer to the system structure.
+ * @param nshards   Number of shards (clamped to [1, MAXSHARDS]); each has a 
+ *                  worker thread when there is more than one.
+ * 
+ * @return      0 on success, -1 if out of memory.
+ */
+int sys_open(Sys *sys, int nshards);
+
+
 /**
  * @brief Initializes the system with default values.
  * 
+ * The arguments may select Portuguese ("pt"), a number of shards 
+ * ("-s<N>", up to MAXSHARDS; 1 by default), each with a worker thread, 
+ * the binary protocol ("-b") and mapping the frozen months of records from 
+ * temporary files ("-m").
+ * 
  * @param argc  Number of command-line arguments.
  * @param argv  Array of command-line arguments.
  * 
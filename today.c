@@ -0,0 +1,141 @@
+/**
+ * @file today.c
+ * @brief Set of the (user, vaccine) pairs vaccinated on the current date.
+ *
+ * Pairs are packed into 64 bits and hashed (Fibonacci hashing) into a
+ * linear-probing table kept at most half full. Deletions shift the
+ * following entries back, so there are no tombstones.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "today.h"
+
+
+/**
+ * @brief Packs a pair into a slot value (never 0).
+ */
+static uint64_t today_key(int uid, int vid) {
+
+    return ((uint64_t) (unsigned) uid << 32 | (unsigned) vid) + 1;
+}
+
+
+/**
+ * @brief Home slot of a key.
+ */
+static int today_home(Today *set, uint64_t key) {
+
+    return (int) ((key * 0x9E3779B97F4A7C15ull) >> 32) & (set->cap - 1);
+}
+
+
+/**
+ * @brief Finds the slot of a key, or the empty slot where it would go.
+ */
+static int today_slot(Today *set, uint64_t key) {
+    int i = today_home(set, key);
+
+    while (set->slot[i] && set->slot[i] != key) i = (i + 1) & (set->cap - 1);
+    return i;
+}
+
+
+/**
+ * @brief Doubles the number of slots and rehashes every pair.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int today_grow(Today *set) {
+    uint64_t *old = set->slot;
+    int i, cap = set->cap;
+
+    set->slot = (uint64_t *) calloc(2 * cap, sizeof(uint64_t));
+    if (!set->slot) {
+        set->slot = old;
+        return -1;
+    }
+
+    set->cap = 2 * cap;
+    for (i = 0; i < cap; i++)
+        if (old[i]) set->slot[today_slot(set, old[i])] = old[i];
+
+    free(old);
+    return 0;
+}
+
+
+Today today_ini(Date date) {
+    Today set;
+
+    set.n = 0;
+    set.cap = TODAYMEM;
+    set.slot = (uint64_t *) calloc(TODAYMEM, sizeof(uint64_t));
+    set.date = date;
+
+    return set;
+}
+
+
+void today_free(Today *set) {
+
+    free(set->slot);
+}
+
+
+void today_reset(Today *set, Date date) {
+
+    if (set->n) memset(set->slot, 0, set->cap * sizeof(uint64_t));
+    set->n = 0;
+    set->date = date;
+}
+
+
+int today_has(Today *set, int uid, int vid) {
+
+    if (uid == -1 || vid == -1 || !set->n) return 0;
+    return set->slot[today_slot(set, today_key(uid, vid))] != 0;
+}
+
+
+int today_add(Today *set, int uid, int vid) {
+    uint64_t key = today_key(uid, vid);
+    int i;
+
+    if (!set->slot) return -1;
+    if (2 * (set->n + 1) > set->cap && today_grow(set)) return -1;
+
+    i = today_slot(set, key);
+    if (!set->slot[i]) {
+        set->slot[i] = key;
+        set->n++;
+    }
+    return 0;
+}
+
+
+void today_del(Today *set, int uid, int vid, Date date) {
+    int i, j, home;
+
+    if (compare_dates(set->date, date) || !set->n) return;
+
+    i = today_slot(set, today_key(uid, vid));
+    if (!set->slot[i]) return;
+
+    // Shift back the entries that probed past the freed slot
+    for (j = (i + 1) & (set->cap - 1); set->slot[j];
+        j = (j + 1) & (set->cap - 1)) {
+        home = today_home(set, set->slot[j]);
+
+        if (((j - home) & (set->cap - 1)) >= ((j - i) & (set->cap - 1))) {
+            set->slot[i] = set->slot[j];
+            i = j;
+        }
+    }
+    set->slot[i] = 0;
+    set->n--;
+}
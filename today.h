@@ -0,0 +1,98 @@
+/**
+ * @file today.h
+ * @brief Set of the (user, vaccine) pairs vaccinated on the current date.
+ *
+ * A user may only get one dose of each vaccine per day, and only the
+ * records of the current date can break that rule, so the pairs of those
+ * records are all the duplicate check needs. The set is emptied when the
+ * date moves forward.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _TODAY_H_
+#define _TODAY_H_
+
+#include <stdint.h>
+
+#include "date.h"
+
+#define TODAYMEM        64      /**< Initial number of hash slots   */
+
+
+/**
+ * @struct Today
+ * @brief Open-addressing hash set of (user ID, vaccine ID) pairs.
+ */
+typedef struct {
+    int n;      /**< Number of pairs    */
+    int cap;        /**< Number of slots (a power of two)   */
+    uint64_t *slot;     /**< Packed pair + 1 in each slot, 0 if empty   */
+    Date date;      /**< Date of the pairs  */
+} Today;
+
+
+/**
+ * @brief Initializes an empty set.
+ *
+ * @param date  The current date.
+ *
+ * @return Initialized Today structure (`slot` is NULL if out of memory).
+ */
+Today today_ini(Date date);
+
+
+/**
+ * @brief Frees the set.
+ *
+ * @param set   Pointer to the set.
+ */
+void today_free(Today *set);
+
+
+/**
+ * @brief Empties the set for a new date.
+ *
+ * @param set   Pointer to the set.
+ * @param date  The new current date.
+ */
+void today_reset(Today *set, Date date);
+
+
+/**
+ * @brief Checks if a user got a vaccine on the current date.
+ *
+ * @param set   Pointer to the set.
+ * @param uid   User ID (-1 if never seen).
+ * @param vid   Vaccine name ID (-1 if never seen).
+ *
+ * @return 1 if the pair is in the set, 0 otherwise.
+ */
+int today_has(Today *set, int uid, int vid);
+
+
+/**
+ * @brief Adds a pair vaccinated on the current date.
+ *
+ * @param set   Pointer to the set.
+ * @param uid   User ID.
+ * @param vid   Vaccine name ID.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+int today_add(Today *set, int uid, int vid);
+
+
+/**
+ * @brief Removes the pair of a deleted record, if it was from the current
+ *          date.
+ *
+ * @param set   Pointer to the set.
+ * @param uid   User ID.
+ * @param vid   Vaccine name ID.
+ * @param date  Application date of the record.
+ */
+void today_del(Today *set, int uid, int vid, Date date);
+
+#endif
@@ -0,0 +1,207 @@
+/**
+ * @file uring.c
+ * @brief Minimal io_uring queue for reading and writing files.
+ *
+ * The rings are shared with the kernel: the queue writes the submission
+ * tail and the completion head, and the kernel the other two, so each is
+ * read with acquire and written with release ordering.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "uring.h"
+
+
+/**
+ * @brief Maps a region of the ring descriptor.
+ *
+ * @return The mapping, or NULL if it failed.
+ */
+static void *uring_map(int fd, size_t len, off_t off) {
+    void *map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, off);
+
+    return map == MAP_FAILED ? NULL : map;
+}
+
+
+int uring_ini(Uring *ring, unsigned depth) {
+    struct io_uring_params p;
+    char *sq, *cq;
+
+    memset(ring, 0, sizeof(Uring));
+    memset(&p, 0, sizeof(p));
+    ring->fd = (int) syscall(__NR_io_uring_setup, depth, &p);
+    if (ring->fd < 0) {
+        ring->fd = -1;
+        return -1;
+    }
+
+    // One mapping holds both rings when the kernel allows it
+    ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_len = p.cq_off.cqes + p.cq_entries *
+                    sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP && ring->cq_len > ring->sq_len)
+        ring->sq_len = ring->cq_len;
+    ring->sqe_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_map = uring_map(ring->fd, ring->sq_len, IORING_OFF_SQ_RING);
+    ring->cq_map = p.features & IORING_FEAT_SINGLE_MMAP ? ring->sq_map :
+                    uring_map(ring->fd, ring->cq_len, IORING_OFF_CQ_RING);
+    ring->sqes = uring_map(ring->fd, ring->sqe_len, IORING_OFF_SQES);
+    if (!ring->sq_map || !ring->cq_map || !ring->sqes) {
+        uring_free(ring);
+        return -1;
+    }
+
+    sq = (char *) ring->sq_map;
+    cq = (char *) ring->cq_map;
+    ring->sq_head = (unsigned *) (sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + p.sq_off.array);
+    ring->cq_head = (unsigned *) (cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring->cqes = cq + p.cq_off.cqes;
+    ring->entries = p.sq_entries;
+    return 0;
+}
+
+
+void uring_free(Uring *ring) {
+
+    if (ring->sqes) munmap(ring->sqes, ring->sqe_len);
+    if (ring->cq_map && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_len);
+    if (ring->sq_map) munmap(ring->sq_map, ring->sq_len);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(Uring));
+    ring->fd = -1;
+}
+
+
+int uring_buffers(Uring *ring, const struct iovec *iov, unsigned n) {
+
+    return syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS,
+                    iov, n) < 0 ? -1 : 0;
+}
+
+
+/**
+ * @brief Takes the next free submission entry, cleared.
+ *
+ * @return The entry, or NULL if the submission ring is full.
+ */
+static struct io_uring_sqe *uring_sqe(Uring *ring) {
+    unsigned tail = *ring->sq_tail, at;
+    struct io_uring_sqe *sqe;
+
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) ==
+        ring->entries) return NULL;
+
+    at = tail & *ring->sq_mask;
+    sqe = (struct io_uring_sqe *) ring->sqes + at;
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[at] = at;
+    return sqe;
+}
+
+
+/**
+ * @brief Publishes the entry taken by `uring_sqe` to the kernel.
+ */
+static void uring_queue(Uring *ring) {
+
+    __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+    ring->pending++;
+}
+
+
+int uring_read(Uring *ring, int fd, void *buf, unsigned len, uint64_t off,
+                int index, uint64_t tag) {
+    struct io_uring_sqe *sqe = uring_sqe(ring);
+
+    if (!sqe) return -1;
+    sqe->opcode = index >= 0 ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->buf_index = index >= 0 ? (uint16_t) index : 0;
+    sqe->user_data = tag;
+    uring_queue(ring);
+    return 0;
+}
+
+
+int uring_write(Uring *ring, int fd, const void *buf, unsigned len,
+                uint64_t off, uint64_t tag) {
+    struct io_uring_sqe *sqe = uring_sqe(ring);
+
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t) (uintptr_t) buf;
+    sqe->len = len;
+    sqe->off = off;
+    sqe->user_data = tag;
+    uring_queue(ring);
+    return 0;
+}
+
+
+/**
+ * @brief Submits the queued requests, optionally waiting for one
+ * completion.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+static int uring_enter(Uring *ring, unsigned wait) {
+    long n;
+
+    do n = syscall(__NR_io_uring_enter, ring->fd, ring->pending, wait,
+                    wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    while (n < 0 && errno == EINTR);
+
+    if (n < 0) return -1;
+    ring->pending -= (unsigned) n;
+    return 0;
+}
+
+
+int uring_submit(Uring *ring) {
+
+    return ring->pending ? uring_enter(ring, 0) : 0;
+}
+
+
+int uring_reap(Uring *ring, int wait, uint64_t *tag, int *res) {
+    unsigned head = *ring->cq_head;
+    struct io_uring_cqe *cqe;
+
+    if (ring->pending && uring_enter(ring, 0)) return -1;
+
+    // The kernel writes the tail after the entries
+    while (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (!wait) return 0;
+        if (uring_enter(ring, 1)) return -1;
+    }
+
+    cqe = (struct io_uring_cqe *) ring->cqes + (head & *ring->cq_mask);
+    *tag = cqe->user_data;
+    *res = cqe->res;
+    __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file uring.h
+ * @brief Minimal io_uring queue for reading and writing files.
+ *
+ * The queue is set up with the raw system calls (no liburing): a
+ * submission ring and a completion ring shared with the kernel. Requests
+ * are queued by writing to memory and sent in batches by one
+ * `io_uring_enter`, which can also wait for completions; each request
+ * carries a tag that comes back with its result. Reads may target buffers
+ * registered once with the kernel (`IORING_OP_READ_FIXED`), so their pages
+ * are not pinned again on every request.
+ *
+ * `uring_ini` fails where io_uring is missing or forbidden (old kernels,
+ * seccomp filters), and the callers then use plain `read` and `write`.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _URING_H_
+#define _URING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+
+/**
+ * @struct Uring
+ * @brief A queue: the mapped rings and the requests not yet submitted.
+ */
+typedef struct {
+    int fd;         /**< Ring descriptor, -1 if none    */
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;   /**< Submissions */
+    unsigned *cq_head, *cq_tail, *cq_mask;      /**< Completions    */
+    unsigned entries;       /**< Size of the submission ring    */
+    void *sqes;     /**< Submission entries (`struct io_uring_sqe`) */
+    void *cqes;     /**< Completion entries (`struct io_uring_cqe`) */
+    void *sq_map, *cq_map;      /**< Mapped rings (may be one mapping)  */
+    size_t sq_len, cq_len, sqe_len;     /**< Bytes mapped   */
+    unsigned pending;       /**< Requests queued but not submitted  */
+} Uring;
+
+
+/**
+ * @brief Sets up a queue.
+ *
+ * @param ring  Pointer to the queue.
+ * @param depth Number of requests that can be in flight.
+ *
+ * @return 0 on success, -1 if io_uring is not available.
+ */
+int uring_ini(Uring *ring, unsigned depth);
+
+
+/**
+ * @brief Tears a queue down; requests still in flight are cancelled.
+ *
+ * @param ring  Pointer to the queue.
+ */
+void uring_free(Uring *ring);
+
+
+/**
+ * @brief Registers buffers for `uring_read`.
+ *
+ * @param ring  Pointer to the queue.
+ * @param iov   The buffers.
+ * @param n     Number of buffers.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int uring_buffers(Uring *ring, const struct iovec *iov, unsigned n);
+
+
+/**
+ * @brief Queues a read at an offset of a file.
+ *
+ * @param ring  Pointer to the queue.
+ * @param fd    The file.
+ * @param buf   Where to read to.
+ * @param len   Bytes to read.
+ * @param off   Offset in the file.
+ * @param index Registered buffer holding `buf`, or -1 for any memory.
+ * @param tag   Tag of the request.
+ *
+ * @return 0 on success, -1 if the submission ring is full.
+ */
+int uring_read(Uring *ring, int fd, void *buf, unsigned len, uint64_t off,
+                int index, uint64_t tag);
+
+
+/**
+ * @brief Queues a write at an offset of a file.
+ *
+ * @param ring  Pointer to the queue.
+ * @param fd    The file.
+ * @param buf   What to write.
+ * @param len   Bytes to write.
+ * @param off   Offset in the file.
+ * @param tag   Tag of the request.
+ *
+ * @return 0 on success, -1 if the submission ring is full.
+ */
+int uring_write(Uring *ring, int fd, const void *buf, unsigned len,
+                uint64_t off, uint64_t tag);
+
+
+/**
+ * @brief Submits the queued requests without waiting.
+ *
+ * @param ring  Pointer to the queue.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int uring_submit(Uring *ring);
+
+
+/**
+ * @brief Gets a completion, submitting the queued requests first.
+ *
+ * @param ring  Pointer to the queue.
+ * @param wait  1 to wait for a completion if there is none yet.
+ * @param tag   Where to store the tag of the request.
+ * @param res   Where to store its result (bytes, or `-errno`).
+ *
+ * @return 1 if a completion was read, 0 if there is none (without
+ *          waiting), -1 on failure.
+ */
+int uring_reap(Uring *ring, int wait, uint64_t *tag, int *res);
+
+#endif
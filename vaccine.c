@@ -12,131 +12,213 @@
 #include "vaccine.h"
 
 
-int is_batch_valid(char batch[]) {
+int is_batch_valid(const char batch[]) {
+    int n = strlen(batch);
+
+    // Validate the characters in the batch name, many at a time
+    return n <= MAXBATCHNAME && lex_is_hex(batch, n);
+}
+
+
+int is_vacname_valid(const char name[]) {
+    int n = strlen(name);
+
+    // Validate the characters in the vaccine name, many at a time
+    return n <= MAXVACNAMEB && !lex_has_blank(name, n);
+}
+
+
+RadixKey batch_key(Date expdate, const char batch[]) {
+    RadixKey key;
+    uint64_t nib, top = 0, low = 0;
     int i;
 
-    if (strlen(batch) > MAXBATCHNAME) return 0;
+    // 80-bit ID: the first 4 digits in `top`, the other 16 in `low`
+    for (i = 0; batch[i] != '\0'; i++) {
+        nib = batch[i] <= '9' ? batch[i] - '0' : batch[i] - 'A' + 10;
+        if (i < 4) top |= nib << (12 - 4 * i);
+        else low |= nib << (60 - 4 * (i - 4));
+    }
+
+    // date << 85 | ID << 5 | length, split into two halves
+    key.hi = (uint64_t) (uint32_t) date_key(expdate) << 21 | top << 5 | 
+            low >> 59;
+    key.lo = low << 5 | i;
 
-    // Validate each character in the batch name
-    for (i = 0; batch[i] != '\0'; i++)      
-        if (!(('A' <= batch[i] && batch[i] <= 'F') || 
-            ('0' <= batch[i] && batch[i] <= '9')))
-            return 0;
-    
-    return 1;
+    return key;
 }
 
 
-int is_vacname_valid(char name[]) {
+/**
+ * @brief Checks if two keys hold the same batch ID, whatever their dates.
+ */
+static int same_batch(RadixKey a, RadixKey b) {
+
+    return a.lo == b.lo && !((a.hi ^ b.hi) & ((1 << 21) - 1));
+}
+
+
+int compare_batches(const void *a, const void *b) {
+
+    // Expiration date first, then batch ID, as packed in the keys
+    return radix_cmp(((const Vaccine *) a)->key, ((const Vaccine *) b)->key);
+}
+
+
+int sort_batches(Vaccine *batches[], int nb) {
     int i;
 
-    if (strlen(name) > MAXVACNAMEB) return 0;
+    // The table is usually still in order since the last sort
+    for (i = 1; i < nb && 
+        radix_cmp(batches[i - 1]->key, batches[i]->key) < 0; i++);
+    if (i >= nb) return 0;
 
-    // Validate each character in the vaccine name
-    for (i = 0; name[i] != '\0'; i++)       
-        if (name[i] == ' ' || name[i] == '\n' || name[i] == '\t') return 0;
+    // Long tables (e.g. after loading many batches) are radix sorted
+    if (nb >= RADIXMIN) 
+        return radix_sort((void **) batches, nb, offsetof(Vaccine, key));
+    return par_sort((void **) batches, nb, compare_batches);
+}
+
+
+/**
+ * @brief Order of the table by name: vaccine name, then the order of `l`.
+ */
+static int compare_by_name(const Vaccine *a, const Vaccine *b) {
+    int c = strcmp(a->name, b->name);
 
-    return 1;
+    return c ? c : radix_cmp(a->key, b->key);
 }
 
 
-int partition_batches(Vaccine batches[], int low, int high) {
-    Vaccine pivot = batches[high], aux;
-    int i = low - 1, j, cmp;
+/**
+ * @brief Finds where a batch is, or would be, in the table by name.
+ */
+static int find_by_name(Vaccine *byname[], int nb, Vaccine *vac) {
+    int lo = 0, hi = nb, mid;
 
-    for (j = low; j < high; j++) {
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (compare_by_name(byname[mid], vac) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
 
-        // Compare expiration dates  / Sort by batch name if dates are equal
-        cmp = compare_dates(batches[j].expdate, pivot.expdate);     
-        if (cmp == 1 || (cmp == 0 && 
-            strcmp(batches[j].batch, pivot.batch) < 0)) {
 
-            i++;
-            aux = batches[i];
-            batches[i] = batches[j];
-            batches[j] = aux;
-        }
+/**
+ * @brief Finds the first batch whose name is after the names that start
+ * with a prefix (`after` 1) or not before them (`after` 0).
+ */
+static int find_prefix(Vaccine *byname[], int lo, int hi, const char *prefix,
+                        int len, int after) {
+    int mid;
+
+    // Names are sorted, so strncmp grows along the table
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (strncmp(byname[mid]->name, prefix, len) < after) lo = mid + 1;
+        else hi = mid;
     }
+    return lo;
+}
 
-    aux = batches[i + 1];
-    batches[i + 1] = batches[high];
-    batches[high] = aux;
-    
-    return i + 1;
+
+void insert_by_name(Vaccine *byname[], int nb, Vaccine *vac) {
+    int i = find_by_name(byname, nb, vac);
+
+    memmove(&byname[i + 1], &byname[i], (nb - i) * sizeof(Vaccine *));
+    byname[i] = vac;
 }
 
 
-void quicksort_batches(Vaccine batches[], int low, int high) {
-    int i;
+void remove_by_name(Vaccine *byname[], int nb, Vaccine *vac) {
+    int i = find_by_name(byname, nb, vac);
+
+    if (i < nb && byname[i] == vac)
+        memmove(&byname[i], &byname[i + 1], (nb - i - 1) * sizeof(Vaccine *));
+}
 
-    if (low >= high) return;
 
-    i = partition_batches(batches, low, high);  // Partition the array
-    quicksort_batches(batches, low, i-1);   // Recursively sort the left part 
-    quicksort_batches(batches, i+1, high);  // Recursively sort the right part
+int match_prefix(Vaccine *byname[], int nb, const char *prefix, int len,
+                Vaccine *out[]) {
+    int lo = find_prefix(byname, 0, nb, prefix, len, 0);
+    int hi = find_prefix(byname, lo, nb, prefix, len, 1);
+
+    memcpy(out, byname + lo, (hi - lo) * sizeof(Vaccine *));
+    return sort_batches(out, hi - lo) ? -1 : hi - lo;
 }
 
 
 void print_l_vac(Vaccine *vac) {
     
-    printf("%s %s %02d-%02d-%d %d %d\n", vac->name, vac->batch, vac->expdate.dd, 
-            vac->expdate.mm, vac->expdate.yy, vac->avdoses, vac->apdoses);
+    printf(LVACFMT, vac->name, vac->batch, vac->expdate.dd, vac->expdate.mm, 
+            vac->expdate.yy, vac->avdoses, vac->apdoses);
 }
 
 
-int verify_new_batch(int nb, char batch[], Vaccine *batches, int is_pt,
-                    char name[], Date current_date, Date date, int doses) {
-    int i;
+int format_l_vac(char *dst, size_t room, void *batches, long i) {
+    Vaccine *vac = ((Vaccine **) batches)[i];
 
-    //find if batch already exists
-    for (i = 0; i < nb; i++)
-        if (!strcmp(batch, batches[i].batch)) {
-            is_pt ? puts(EDUPBATCH_PT): puts(EDUPBATCH_EN);
-            return 0;
-        }
+    return snprintf(dst, room, LVACFMT, vac->name, vac->batch, 
+                    vac->expdate.dd, vac->expdate.mm, vac->expdate.yy, 
+                    vac->avdoses, vac->apdoses);
+}
 
-    // Check other errors
-    if (!is_batch_valid(batch)) {
-        is_pt ? puts(EINVBATCH_PT): puts(EINVBATCH_EN);
-        return 0;
-    }
 
-    if (!is_vacname_valid(name)) {
-        is_pt ? puts(EINVNAME_PT): puts(EINVNAME_EN);
-        return 0;
-    }
+int verify_new_batch(int nb, const char batch[], Vaccine *batches[], 
+                    const char name[], Date current_date, Date date, 
+                    int doses) {
+    int i, valid = is_batch_valid(batch);
+    RadixKey key;
 
-    if (!is_date_valid(current_date, date, 0)) {
-        is_pt ? puts(EINVDATE_PT): puts(EINVDATE_EN);
-        return 0;
+    //find if batch already exists (only valid IDs are ever on file)
+    if (valid) {
+        key = batch_key(date, batch);
+        for (i = 0; i < nb; i++)
+            if (same_batch(key, batches[i]->key)) return VMS_EDUPBATCH;
     }
 
-    if (doses <= 0) {
-        is_pt ? puts(EINVQUANT_PT): puts(EINVQUANT_EN);
-        return 0;
-    }
+    // Check other errors
+    if (!valid) return VMS_EINVBATCH;
+    if (!is_vacname_valid(name)) return VMS_EINVNAME;
+    if (!is_date_valid(current_date, date, 0)) return VMS_EINVDATE;
+    if (doses <= 0) return VMS_EINVQUANT;
 
-    return 1;
+    return VMS_OK;
 }
 
-Vaccine * aplly_bacth(int nb, Vaccine *batches, char vac_name[]) {
-    int i, batch_found;
+int expire_batches(Heap *expiry, Heap *stock, Date date) {
+    Vaccine *vac;
+    int retired = 0;
+
+    // Pop every batch whose expiration date is before the new date
+    while ((vac = (Vaccine *) heap_top(expiry)) && 
+            compare_dates(vac->expdate, date) == 1) {
+        heap_remove(expiry, vac);
+        heap_remove(stock, vac);
+        vac->expired = 1;
+        retired++;
+    }
+    return retired;
+}
 
+Vaccine * aplly_bacth(int nb, Vaccine *batches[], int vid, int *from) {
+    int i;
 
-    for (i = 0, batch_found = 0; i < nb && !batch_found; i++) {
+    for (i = *from; i < nb; i++) {
         
-        // Check if vaccine is available
-        if (!strcmp(batches[i].name, vac_name) && 
-            batches[i].avdoses > 0) {
+        // Check if vaccine is available (expired batches were retired)
+        if (!batches[i]->expired && batches[i]->avdoses > 0 && 
+            batches[i]->vid == vid) {
 
-            batch_found = 1;
-            batches[i].avdoses -= 1;
-            batches[i].apdoses += 1;
-            puts(batches[i].batch);
+            batches[i]->avdoses -= 1;
+            batches[i]->apdoses += 1;
 
-            return &batches[i];
+            *from = i;
+            return batches[i];
         }
     }
 
+    *from = nb;
     return NULL;        // Return NULL if batch is not found or not available
-}
\ No newline at end of file
+}
@@ -16,11 +16,15 @@
 #include <string.h>
 
 #include "errors.h"
-#include "hash.h"
 #include "date.h"
+#include "heap.h"
+#include "par.h"
+#include "lex.h"
+#include "radix.h"
 
 #define MAXVACNAMEB     50      /**< max. bytes of vaccine name */
 #define MAXBATCHNAME    20      /**< max. len. of batch name    */
+#define LVACFMT         "%s %s %02d-%02d-%d %d %d\n"    /**< batch listing */
 
 
 /**
@@ -32,11 +36,18 @@
  * available doses, and applied doses.
  */
 typedef struct {
-    char *name;         /** Vaccine name. Dynamically allocated.    */
-    char *batch;        /** Batch ID of the vaccine. Dynamically allocated. */
+    char *name;         /** Vaccine name. Interned in the system's names.   */
+    int vid;            /** ID of the interned vaccine name.    */
+    char *batch;        /** Batch ID of the vaccine. Interned.  */
+    int bid;            /** ID of the interned batch ID.    */
+    RadixKey key;       /** (expdate, batch) packed for ordering.   */
     Date expdate;       /** Expiration date of the vaccine batch.   */
     int avdoses;        /** The number of available doses in the batch. */
     int apdoses;        /** The number of doses applied from the batch. */
+    int ninocs;         /** Inoculation records on file for this batch. */
+    int expired;        /** 1 once the system date is past `expdate`.   */
+    int exppos;         /** Position in the expiry heap, -1 if not in it.   */
+    int stockpos;       /** Position in the stock heap, -1 if not in it.    */
 } Vaccine;
 
 
@@ -47,7 +58,23 @@ typedef struct {
  * 
  * @return 1 if valid, 0 if invalid.
  */
-int is_batch_valid(char batch[]);
+int is_batch_valid(const char batch[]);
+
+
+/**
+ * @brief Packs an expiration date and a valid batch ID into a key that 
+ * orders like `compare_batches`.
+ * 
+ * The date key fills the top bits. The batch's hex digits follow as 
+ * nibbles, padded with zeros to 20, and its length fills the lowest 5 bits, 
+ * so a prefix comes before the longer IDs that extend it, as with `strcmp`.
+ * 
+ * @param expdate   Expiration date of the batch.
+ * @param batch     Batch ID (must pass `is_batch_valid`).
+ * 
+ * @return The packed key.
+ */
+RadixKey batch_key(Date expdate, const char batch[]);
 
 
 /**
@@ -57,37 +84,78 @@ int is_batch_valid(char batch[]);
  * 
  * @return 1 if valid, 0 if invalid.
  */
-int is_vacname_valid(char name[]);
+int is_vacname_valid(const char name[]);
 
 
 /**
- * @brief Partitions the vaccine batches for quicksort.
+ * @brief Compares two vaccine batches.
  * 
- * This function is used in the quicksort algorithm to divide the batches into 
- * two groups: those with an expiration date earlier than the pivot and those 
- * with a later or equal expiration date. It also handles sorting by batch name 
- * when expiration dates are equal.
+ * Batches are ordered by expiration date and, if the expiration dates are 
+ * the same, by batch name.
  * 
- * @param batches   The array of vaccine batches.
- * @param low       The starting index of the partition.
- * @param high      The ending index of the partition.
+ * @param a     Pointer to the first batch (a `Vaccine *`).
+ * @param b     Pointer to the second batch (a `Vaccine *`).
  * 
- * @return The partition index.
+ * @return Negative if `a` comes first, positive if `b` comes first, 0 if 
+ *          they are the same batch.
  */
-int partition_batches(Vaccine batches[], int low, int high);
+int compare_batches(const void *a, const void *b);
 
 
 /**
- * @brief Sorts the vaccine batches using quicksort.
+ * @brief Sorts the vaccine batches.
  * 
  * This function sorts an array of vaccine batches by expiration date, and 
- * if the expiration dates are the same, by batch name. 
+ * if the expiration dates are the same, by batch name. Large tables are 
+ * sorted in parallel.
  * 
  * @param batches   The array of vaccine batches.
- * @param low       The starting index for the quicksort.
- * @param high      The ending index for the quicksort.
+ * @param nb        The number of batches.
+ * 
+ * @return 0 on success, -1 if out of memory.
+ */
+int sort_batches(Vaccine *batches[], int nb);
+
+
+/**
+ * @brief Adds a batch to the table of batches ordered by vaccine name, then
+ * by expiration date and batch ID.
+ * 
+ * @param byname    The table, with room for one more batch.
+ * @param nb        The number of batches in the table.
+ * @param vac       The batch to add.
+ */
+void insert_by_name(Vaccine *byname[], int nb, Vaccine *vac);
+
+
+/**
+ * @brief Removes a batch from the table of batches ordered by vaccine name.
+ * 
+ * @param byname    The table.
+ * @param nb        The number of batches in the table.
+ * @param vac       The batch to remove.
+ */
+void remove_by_name(Vaccine *byname[], int nb, Vaccine *vac);
+
+
+/**
+ * @brief Finds the batches whose vaccine name starts with a prefix, in 
+ * O(log n * prefix), and stores them in the order of `l` (expiration date,
+ * then batch ID).
+ * 
+ * The matches are next to each other in the table, so the other batches are
+ * never visited.
+ * 
+ * @param byname    The table of batches ordered by vaccine name.
+ * @param nb        The number of batches.
+ * @param prefix    The prefix.
+ * @param len       Length of the prefix.
+ * @param out       Where to store the matches (room for `nb`).
+ * 
+ * @return The number of matches, or -1 if out of memory.
  */
-void quicksort_batches(Vaccine batches[], int low, int high);
+int match_prefix(Vaccine *byname[], int nb, const char *prefix, int len,
+                Vaccine *out[]);
 
 
 /**
@@ -98,36 +166,70 @@ void quicksort_batches(Vaccine batches[], int low, int high);
 void print_l_vac(Vaccine *vac);
 
 
+/**
+ * @brief Formats the details of a vaccine, as printed by `print_l_vac`.
+ * 
+ * @param dst       Where to write the text.
+ * @param room      Bytes available in `dst`.
+ * @param batches   The array of vaccine batches.
+ * @param i         Index of the batch to format.
+ * 
+ * @return The length of the full text, like `snprintf`.
+ */
+int format_l_vac(char *dst, size_t room, void *batches, long i);
+
+
 /**
  * @brief Verifies if a new vaccine batch can be added.
  * 
  * @param nb            The number of existing batches.
  * @param batch         The batch name to check.
  * @param batches       The array of existing vaccine batches.
- * @param is_pt         The language flag (1 for Portuguese, 0 for English).
  * @param name          The vaccine name to check.
  * @param current_date  The current date in the system.
  * @param date          The expiration date of the new batch.
  * @param doses         The number of doses in the batch.
  * 
- * @return 1 if valid, 0 if invalid.
+ * @return VMS_OK if valid, or the status of the first error found.
+ */
+int verify_new_batch(int nb, const char batch[], Vaccine *batches[], 
+                    const char name[], Date current_date, Date date, int doses);
+
+
+/**
+ * @brief Retires the batches that expired when the date moved forward.
+ * 
+ * The expiry heap holds the batches that have not expired yet, earliest 
+ * expiration first, so only the batches that just expired are visited 
+ * (O(log n) each). They are marked as expired and leave both heaps.
+ * 
+ * @param expiry    The expiry heap.
+ * @param stock     The heap of the unexpired batches with doses.
+ * @param date      The new system date.
+ * 
+ * @return The number of batches retired.
  */
-int verify_new_batch(int nb, char batch[], Vaccine *batches, int is_pt,
-                    char name[], Date current_date, Date date, int doses);
+int expire_batches(Heap *expiry, Heap *stock, Date date);
 
 
 /**
  * @brief Applies a vaccine batch to a user.
  * 
  * This function decreases the available doses of a vaccine batch and increases 
- * the applied doses when a batch is successfully applied to a user.
+ * the applied doses when a batch is successfully applied to a user. Expired 
+ * batches are never applied.
+ * 
+ * The search starts at `*from`, which is left at the batch applied. While 
+ * nothing else changes the batches, the batches before it can not be 
+ * applied either, so a run of applications walks the table once.
  * 
  * @param nb        The number of vaccine batches in the system.
  * @param batches   The array of vaccine batches.
- * @param vac_name  The name of the vaccine batch to apply.
+ * @param vid       ID of the interned vaccine name to apply.
+ * @param from      First batch to consider (0 for all); updated.
  * 
  * @return A pointer to the applied vaccine batch, or NULL if not found.
  */
-Vaccine * aplly_bacth(int nb, Vaccine *batches, char vac_name[]);
+Vaccine * aplly_bacth(int nb, Vaccine *batches[], int vid, int *from);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,1138 @@
+/**
+ * @file vms.c
+ * @brief Library interface of the Vaccine Management System.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "vms.h"
+#include "export.h"
+#include "import.h"
+
+#define SEQBITS     36      /**< Bits of the sequence number in a cursor */
+#define IMPCHECKMIN 4096    /**< min. rows checked in parallel  */
+
+
+/**
+ * @brief Gets the shard of a user.
+ *
+ * @return The shard, or NULL if a listing ran out of memory.
+ */
+static Shard *user_shard(Sys *sys, const char *user) {
+    Shard *shard = &sys->shards[shard_of(user, sys->nshards)];
+
+    return worker_failed(&shard->worker) || worker_failed(&sys->lister) ?
+            NULL : shard;
+}
+
+
+/**
+ * @brief Finds the first record of a shard's arrays at or after a place in
+ * the order of application (a date and a sequence number), the order the
+ * records are kept in.
+ */
+static int order_lower_bound(Shard *shard, int key, long seq) {
+    int low = 0, high = shard->ni, mid;
+
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (shard->cols.date[mid] < key || (shard->cols.date[mid] == key &&
+            shard->inocs[mid].seq < seq)) low = mid + 1;
+        else high = mid;
+    }
+    return low;
+}
+
+
+/**
+ * @brief Cursor of a place in the order of application: the date (as
+ * `date_key`) above the sequence number.
+ */
+static long place_cursor(int key, long seq) {
+
+    return (long) key << SEQBITS | seq;
+}
+
+
+/**
+ * @brief Cursor of a record: its place in the order of application.
+ */
+static long inoc_cursor(const Inoc *inoc) {
+
+    return place_cursor(date_key(inoc->apdate), inoc->seq);
+}
+
+
+/**
+ * @brief Copies an inoculation record to a listing entry.
+ */
+static void inoc_out(VmsInoc *out, const Inoc *inoc) {
+
+    out->user = inoc->user;
+    out->batch = inoc->vaccine->batch;
+    out->vaccine = inoc->vaccine->name;
+    out->date = inoc->apdate;
+}
+
+
+/**
+ * @brief Applies a dose to a user from the first usable batch at or after 
+ * `*from` (the batches must be sorted).
+ */
+static int apply(Sys *sys, Shard *shard, const char *user, int vid, int *from,
+                const char **batch) {
+    int uid = intern_find(&sys->usernames, user);
+    Vaccine *vac;
+
+    if (today_has(&sys->today, uid, vid)) return VMS_EDOUBLEVAC;
+
+    // Make room for the record and its count before taking the dose
+    if (shard_room(shard, 1) ||
+        rank_reserve(&sys->rank, sys->usernames.n + 1)) return VMS_ENOMEMORY;
+
+    // Take a dose from the batch that expires first
+    vac = aplly_bacth(sys->nb, sys->batches, vid, from);
+    if (!vac) return VMS_ENOSTOCK;
+
+    // Give the dose back if the record can not be stored
+    if ((uid == -1 && (uid = intern_add(&sys->usernames, user)) == -1) ||
+        today_add(&sys->today, uid, vid)) {
+        vac->avdoses++;
+        vac->apdoses--;
+        return VMS_ENOMEMORY;
+    }
+    if (recall_add(&sys->recall, vac->bid, uid, sys->date, sys->seq) ||
+        stats_add(&sys->stats, vac, sys->date)) {
+        recall_remove(&sys->recall, vac->bid, uid, sys->date);
+        today_del(&sys->today, uid, vid, sys->date);
+        vac->avdoses++;
+        vac->apdoses--;
+        return VMS_ENOMEMORY;
+    }
+
+    shard_append(shard, sys->usernames.str[uid], uid, vac, sys->date,
+                sys->seq++);
+    rank_add(&sys->rank, uid, sys->usernames.str[uid], 1);
+    if (!vac->avdoses) heap_remove(&sys->stock, vac);
+    lcache_touch(&sys->lcache, vid);
+    feed_emit(&sys->feed, FEED_APPLY, sys->date, vac->avdoses, vac->apdoses,
+            3, sys->usernames.str[uid], vac->batch, vac->name);
+
+    if (batch) *batch = vac->batch;
+    return VMS_OK;
+}
+
+
+Sys *vms_open(int nshards) {
+    Sys *sys = (Sys *) aligned_alloc(CACHELINE, sizeof(Sys));
+
+    if (sys && sys_open(sys, nshards)) {
+        vms_close(sys);
+        return NULL;
+    }
+    return sys;
+}
+
+
+void vms_close(Sys *sys) {
+
+    if (!sys) return;
+    free_mem(sys);
+    free(sys);
+}
+
+
+/**
+ * @brief Adds a batch, without telling the feed. With `past`, a batch that
+ * expired before the current date is accepted, marked as expired and kept
+ * out of the heaps.
+ */
+static int add_batch(Sys *sys, const char *batch, Date expdate, int doses,
+                    const char *name, int past) {
+    int status, vid, bid, expired;
+    Vaccine *vac;
+
+    if (sys->nb == MAXBATCHES) return VMS_E2MANYVAC;
+
+    // A past batch is checked against its own date: only the day must exist
+    expired = past && compare_dates(expdate, sys->date) == 1;
+    status = verify_new_batch(sys->nb, batch, sys->batches, name,
+                            expired ? expdate : sys->date, expdate, doses);
+    if (status != VMS_OK) return status;
+
+    // Intern the names first, so that nothing changes if memory runs out
+    bid = intern_add(&sys->batchnames, batch);
+    vid = intern_add(&sys->vacnames, name);
+    if (bid == -1 || vid == -1) return VMS_ENOMEMORY;
+
+    vac = (Vaccine *) malloc(sizeof(Vaccine));
+    if (!vac) return VMS_ENOMEMORY;
+
+    vac->batch = sys->batchnames.str[bid];
+    vac->name = sys->vacnames.str[vid];
+    vac->bid = bid;
+    vac->vid = vid;
+    vac->ninocs = 0;
+    vac->expired = expired;
+    vac->exppos = -1;
+    vac->stockpos = -1;
+    vac->expdate = expdate;
+    vac->key = batch_key(expdate, batch);
+    vac->avdoses = doses;
+    vac->apdoses = 0;
+
+    // Track the batch until it expires or runs out of doses
+    if (!expired &&
+        (heap_push(&sys->expiry, vac) || heap_push(&sys->stock, vac))) {
+        heap_remove(&sys->expiry, vac);
+        free(vac);
+        return VMS_ENOMEMORY;
+    }
+
+    insert_by_name(sys->byname, sys->nb, vac);
+    sys->batches[sys->nb++] = vac;
+    lcache_touch(&sys->lcache, vid);
+    return VMS_OK;
+}
+
+
+int vms_feed(Sys *sys, const char *name) {
+
+    feed_close(&sys->feed);
+    return feed_open(&sys->feed, name) ? VMS_EFILE : VMS_OK;
+}
+
+
+int vms_add_batch(Sys *sys, const char *batch, Date expdate, int doses,
+                const char *name) {
+    int status = add_batch(sys, batch, expdate, doses, name, 0);
+
+    if (status == VMS_OK)
+        feed_emit(&sys->feed, FEED_BATCH, expdate, doses, 0, 2, batch, name);
+    return status;
+}
+
+
+/**
+ * @brief Fills in a deletion of a user's inoculations.
+ */
+static void delete_ini(Sys *sys, ShardDel *del, const char *user,
+                    const Date *date, const char *batch) {
+    Date day = {0, 0, 0};
+
+    if (date) day = *date;
+    del->uid = intern_find(&sys->usernames, user);
+    del->read_date = date != NULL;
+    del->read_batch = date && batch;
+    del->bid = del->read_batch ? intern_find(&sys->batchnames, batch) : -1;
+    del->val_date = !date || is_date_valid(sys->date, day, 1);
+    del->date = day;
+    del->is_pt = sys->is_pt;
+    del->user = del->batch = NULL;
+    del->gone = NULL;
+}
+
+
+/**
+ * @brief Accounts for a deletion: the doses, today's pairs and the batches'
+ * records of the records removed, and the user's count.
+ */
+static void deleted(Sys *sys, ShardDel *del, const char *user,
+                    const char *batch) {
+    Inoc *gone;
+    int i;
+
+    for (i = 0; i < del->removed; i++) {
+        gone = &del->gone[i];
+        stats_remove(&sys->stats, gone->vaccine, gone->apdate);
+        today_del(&sys->today, del->uid, gone->vaccine->vid, gone->apdate);
+        recall_remove(&sys->recall, gone->vaccine->bid, del->uid,
+                    gone->apdate);
+    }
+    rank_remove(&sys->rank, del->uid, del->removed);
+    if (del->status == VMS_OK)
+        feed_emit(&sys->feed, FEED_DELETE, del->date, del->removed, 0,
+                1 + del->read_batch, user, batch);
+}
+
+
+/**
+ * @brief Accounts for the deletions handed to a shard's worker: those it
+ * has finished, or all of them, waiting for the worker, if one is of user
+ * `uid` (-1 for any user).
+ *
+ * @return 0 on success, -1 if one of them ran out of memory.
+ */
+static int settle(Sys *sys, Shard *shard, int uid) {
+    ShardDel *del;
+    int ret = 0, wait = uid == -1;
+
+    // Another user's deletion changes only that user's entries and the
+    // counters, which add up in any order
+    for (del = shard->dels; del && !wait; del = del->next)
+        wait = del->uid == uid;
+
+    while ((del = shard_reap(shard, wait))) {
+        if (del->status == VMS_ENOMEMORY) ret = -1;
+        else deleted(sys, del, del->user, del->batch);
+        shard_del_free(del);
+    }
+    return ret;
+}
+
+
+int vms_settle(Sys *sys) {
+    int s, status = VMS_OK;
+
+    for (s = 0; s < sys->nshards; s++)
+        if (settle(sys, &sys->shards[s], -1)) status = VMS_ENOMEMORY;
+    return status;
+}
+
+
+int vms_apply(Sys *sys, const char *user, const char *vaccine,
+            const char **batch) {
+    Shard *shard = user_shard(sys, user);
+    int uid = intern_find(&sys->usernames, user), from = 0;
+
+    // A user never seen has nothing to wait for
+    if (!shard || (uid != -1 && settle(sys, shard, uid)))
+        return VMS_ENOMEMORY;
+    if (sort_batches(sys->batches, sys->nb)) return VMS_ENOMEMORY;
+
+    return apply(sys, shard, user, intern_find(&sys->vacnames, vaccine), 
+                &from, batch);
+}
+
+
+int vms_apply_bulk(Sys *sys, const char *vaccine, const char **users, int n,
+                const char **batches, int *status) {
+    int need[MAXSHARDS] = {0}, vid = intern_find(&sys->vacnames, vaccine);
+    int k, s, from = 0, ret = VMS_OK;
+    Shard *shard;
+
+    // Batches in expiry order, walked once for all the users
+    if (vms_settle(sys) || sort_batches(sys->batches, sys->nb))
+        ret = VMS_ENOMEMORY;
+
+    // Make room in each shard for all of its users at once
+    for (k = 0; k < n; k++) need[shard_of(users[k], sys->nshards)]++;
+    for (s = 0; ret == VMS_OK && s < sys->nshards; s++) {
+        shard = &sys->shards[s];
+        if (need[s] && (worker_failed(&shard->worker) ||
+            shard_room(shard, need[s]))) ret = VMS_ENOMEMORY;
+    }
+
+    for (k = 0; k < n; k++) {
+        batches[k] = NULL;
+        if (ret == VMS_OK) {
+            shard = &sys->shards[shard_of(users[k], sys->nshards)];
+            ret = status[k] = apply(sys, shard, users[k], vid, &from, 
+                                    &batches[k]);
+
+            // Later users may still be served by another batch
+            if (ret != VMS_ENOMEMORY) ret = VMS_OK;
+        }
+        else status[k] = ret;
+    }
+    return ret;
+}
+
+
+int vms_remove_batch(Sys *sys, const char *batch, int *apdoses) {
+    int i, bid = intern_find(&sys->batchnames, batch);
+    Vaccine *vac;
+
+    // Look for the batch in the system
+    for (i = 0; bid != -1 && i < sys->nb; i++) {
+        vac = sys->batches[i];
+        if (vac->bid != bid) continue;
+
+        *apdoses = vac->apdoses;
+        lcache_touch(&sys->lcache, vac->vid);
+        feed_emit(&sys->feed, FEED_REMOVE, vac->expdate, vac->apdoses,
+                vac->apdoses == 0 && vac->ninocs == 0, 2, vac->batch,
+                vac->name);
+
+        // If the batch has doses applied or records on file (imported
+        // ones may come with no doses applied), disable; otherwise remove
+        heap_remove(&sys->stock, vac);
+        if (vac->apdoses > 0 || vac->ninocs > 0) vac->avdoses = 0;
+        else {
+            heap_remove(&sys->expiry, vac);
+            remove_by_name(sys->byname, sys->nb, vac);
+            free(vac);
+            memmove(&sys->batches[i], &sys->batches[i + 1],
+                    (sys->nb - i - 1) * sizeof(Vaccine *));
+            sys->nb--;
+        }
+        return VMS_OK;
+    }
+
+    return VMS_ENOBATCH;
+}
+
+
+int vms_delete(Sys *sys, const char *user, const Date *date,
+            const char *batch, int *removed) {
+    Shard *shard = user_shard(sys, user);
+    ShardDel del;
+
+    *removed = 0;
+    if (!shard || settle(sys, shard, -1)) return VMS_ENOMEMORY;
+
+    // The executor deletes once the worker is idle
+    delete_ini(sys, &del, user, date, batch);
+    shard_sync(shard);
+    if (shard_delete(shard, &del) != VMS_ENOMEMORY)
+        deleted(sys, &del, user, batch);
+    free(del.gone);
+    *removed = del.removed;
+    return del.status;
+}
+
+
+int vms_delete_defer(Sys *sys, const char *user, const Date *date,
+                    const char *batch) {
+    Shard *shard = user_shard(sys, user);
+    ShardDel *del;
+    int ret;
+
+    // The feed tells the deletions in order, so they are not handed off
+    if (!shard || sys->feed.ring) return 0;
+
+    del = (ShardDel *) malloc(sizeof(ShardDel));
+    if (!del) return -1;
+    delete_ini(sys, del, user, date, batch);
+    del->user = strdup(user);
+    del->batch = del->read_batch ? strdup(batch) : NULL;
+
+    ret = !del->user || (del->read_batch && !del->batch) ? -1 :
+            shard_delete_defer(shard, del);
+    if (ret != 1) shard_del_free(del);
+    return ret;
+}
+
+
+int vms_set_date(Sys *sys, Date date) {
+    int s, expired, moved = compare_dates(sys->date, date);
+
+    if (!is_date_valid(sys->date, date, 0)) return VMS_EINVDATE;
+
+    // Yesterday's doses can not be repeated by mistake any more
+    if (moved) today_reset(&sys->today, date);
+
+    // Months that are over are frozen; if memory is short, they stay as 
+    // they are and are frozen with a later month
+    if (date.mm != sys->date.mm || date.yy != sys->date.yy)
+        for (s = 0; s < sys->nshards; s++) {
+            shard_sync(&sys->shards[s]);
+            shard_freeze(&sys->shards[s], date, sys->is_mapped);
+        }
+
+    sys->date = date;
+    expired = expire_batches(&sys->expiry, &sys->stock, sys->date);
+    if (moved) feed_emit(&sys->feed, FEED_DATE, date, expired, 0, 0);
+    return VMS_OK;
+}
+
+
+Date vms_get_date(Sys *sys) {
+
+    return sys->date;
+}
+
+
+/**
+ * @brief Cursor of a batch: its expiration date and batch ID, which keep
+ * the batch's place in the listing after it is removed.
+ */
+static long batch_cursor(const Vaccine *vac) {
+
+    return (long) date_key(vac->expdate) << 32 | vac->bid;
+}
+
+
+/**
+ * @brief Finds where a cursor resumes in a list of batches sorted by
+ * expiration date and batch ID.
+ *
+ * @return Position of the first batch at or after the cursor, or -1 if the
+ *          cursor is not one.
+ */
+static int batch_resume(Sys *sys, Vaccine **list, int n, long cursor) {
+    int bid = (int) (cursor & 0xFFFFFFFF), lo = 0, hi = n, mid;
+    RadixKey key;
+
+    if (bid < 0 || bid >= sys->batchnames.n) return cursor ? -1 : 0;
+    key = batch_key(date_unkey((int) (cursor >> 32)),
+                    sys->batchnames.str[bid]);
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (radix_cmp(list[mid]->key, key) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+
+int vms_list_batches(Sys *sys, const char *vaccine, int exact, long *cursor,
+                    VmsBatch *out, int max, int *n) {
+    int i, vid = -1, found = !vaccine, nlist = sys->nb;
+    size_t len = vaccine ? strlen(vaccine) : 0;
+    Vaccine *match[MAXBATCHES], **list = sys->batches, *vac;
+
+    *n = 0;
+    if (sort_batches(sys->batches, sys->nb)) return VMS_ENOMEMORY;
+
+    // A pattern lists the batches of every name it matches
+    if (!exact && len && vaccine[len - 1] == '*') {
+        nlist = match_prefix(sys->byname, sys->nb, vaccine, len - 1, match);
+        if (nlist == -1) return VMS_ENOMEMORY;
+        list = match;
+        vaccine = NULL;
+        found = nlist > 0;
+    }
+
+    // A vaccine filter must match at least one batch
+    if (vaccine) vid = intern_find(&sys->vacnames, vaccine);
+    for (i = 0; vid != -1 && i < sys->nb && !found; i++)
+        found = sys->batches[i]->vid == vid;
+    if (!found) return VMS_ENOVACINE;
+
+    i = *cursor < 0 ? nlist : batch_resume(sys, list, nlist, *cursor);
+    if (i == -1) return VMS_EINVCURSOR;
+    for (; i < nlist; i++) {
+        vac = list[i];
+        if (vaccine && vac->vid != vid) continue;
+        if (*n == max) break;
+
+        out[*n].name = vac->name;
+        out[*n].batch = vac->batch;
+        out[*n].expdate = vac->expdate;
+        out[*n].avdoses = vac->avdoses;
+        out[*n].apdoses = vac->apdoses;
+        (*n)++;
+    }
+
+    *cursor = i < nlist ? batch_cursor(list[i]) : -1;
+    return VMS_OK;
+}
+
+
+int vms_list_inocs(Sys *sys, const char *user, long *cursor, VmsInoc *out,
+                int max, int *n) {
+    int s, min, first = 0, last = sys->nshards, uid = -1, key;
+    InocIter its[MAXSHARDS];
+    Shard *shard;
+    long seq;
+
+    *n = 0;
+
+    // One user: only the user's shard is read
+    if (user) {
+        uid = intern_find(&sys->usernames, user);
+        if (uid == -1) return VMS_EINVUSER;
+        if (!(shard = user_shard(sys, user))) return VMS_ENOMEMORY;
+        first = shard - sys->shards;
+        last = first + 1;
+    }
+
+    // The cursor is a place in the order of application, merged across
+    // shards
+    if (*cursor < 0) return VMS_OK;
+    key = (int) (*cursor >> SEQBITS);
+    seq = *cursor & (((long) 1 << SEQBITS) - 1);
+    for (s = first; s < last; s++) {
+        shard = &sys->shards[s];
+        shard_sync(shard);
+        if (iter_ini(&its[s], shard->cold, shard->inocs, shard->cols.user,
+                    order_lower_bound(shard, key, seq), shard->ni, uid, seq,
+                    key, INT_MAX)) {
+            while (s-- > first) iter_free(&its[s]);
+            return VMS_ENOMEMORY;
+        }
+    }
+    if (user && !*cursor && !its[first].at) {
+        iter_free(&its[first]);
+        return VMS_EINVUSER;
+    }
+
+    for (*cursor = -1; ; ) {
+        for (s = first, min = -1; s < last; s++)
+            if (its[s].at && (min == -1 || inoc_before(its[s].at,
+                                                        its[min].at)))
+                min = s;
+
+        if (min == -1) break;
+        if (*n == max) {
+            *cursor = inoc_cursor(its[min].at);
+            break;
+        }
+        inoc_out(&out[(*n)++], its[min].at);
+        iter_next(&its[min]);
+    }
+
+    for (s = first; s < last; s++) iter_free(&its[s]);
+    return VMS_OK;
+}
+
+
+int vms_recall(Sys *sys, const char *batch, long *cursor, VmsInoc *out,
+            int max, int *n) {
+    int i, bid = intern_find(&sys->batchnames, batch), uid;
+    Vaccine *vac = NULL;
+    long at, seq;
+    Date date;
+
+    *n = 0;
+    for (i = 0; bid != -1 && i < sys->nb && !vac; i++)
+        if (sys->batches[i]->bid == bid) vac = sys->batches[i];
+    if (!vac) return VMS_ENOBATCH;
+    if (*cursor < 0) return VMS_OK;
+
+    // The cursor is the place of the next record in the order of
+    // application, which deletions do not move
+    at = recall_seek(&sys->recall, bid, (int) (*cursor >> SEQBITS),
+                    *cursor & (((long) 1 << SEQBITS) - 1));
+    while (*n < max &&
+        recall_next(&sys->recall, bid, &at, &uid, &date, &seq)) {
+        out[*n].user = sys->usernames.str[uid];
+        out[*n].batch = vac->batch;
+        out[*n].vaccine = vac->name;
+        out[(*n)++].date = date;
+    }
+
+    *cursor = recall_next(&sys->recall, bid, &at, &uid, &date, &seq) ?
+                place_cursor(date_key(date), seq) : -1;
+    return VMS_OK;
+}
+
+
+int vms_top_stock(Sys *sys, int k, VmsBatch *out, int *n) {
+    Vaccine **top;
+    int i;
+
+    *n = 0;
+    if (k <= 0) return VMS_EINVQUANT;
+    if (k > sys->stock.n) k = sys->stock.n;
+    if (!(top = (Vaccine **) malloc((k ? k : 1) * sizeof(Vaccine *))) ||
+        (*n = heap_smallest(&sys->stock, k, (void **) top)) < 0) {
+        free(top);
+        *n = 0;
+        return VMS_ENOMEMORY;
+    }
+
+    for (i = 0; i < *n; i++) {
+        out[i].name = top[i]->name;
+        out[i].batch = top[i]->batch;
+        out[i].expdate = top[i]->expdate;
+        out[i].avdoses = top[i]->avdoses;
+        out[i].apdoses = top[i]->apdoses;
+    }
+    free(top);
+    return VMS_OK;
+}
+
+
+int vms_top_users(Sys *sys, int k, VmsUser *out, int *n) {
+    UserRank **top;
+    int i;
+
+    *n = 0;
+    if (k <= 0) return VMS_EINVQUANT;
+    if (k > sys->rank.top.n) k = sys->rank.top.n;
+    if (!(top = (UserRank **) malloc((k ? k : 1) * sizeof(UserRank *))) ||
+        (*n = rank_top(&sys->rank, k, top)) < 0) {
+        free(top);
+        *n = 0;
+        return VMS_ENOMEMORY;
+    }
+
+    for (i = 0; i < *n; i++) {
+        out[i].user = top[i]->name;
+        out[i].ninocs = top[i]->count;
+    }
+    free(top);
+    return VMS_OK;
+}
+
+
+int vms_list_users(Sys *sys, const char *prefix, long *cursor, VmsUser *out,
+                int max, int *n) {
+    const char *name;
+    NameIter it;
+    int count, uid;
+
+    *n = 0;
+    if (*cursor < 0) return VMS_OK;
+    if (*cursor > sys->usernames.n) return VMS_EINVCURSOR;
+    if (names_sync(&sys->names, &sys->usernames)) return VMS_ENOMEMORY;
+    names_find(&sys->names, prefix ? prefix : "", prefix ? strlen(prefix) :
+                0, &it);
+
+    // The cursor is one past the user ID of the last name read, so the
+    // next page starts after that name even if the index was merged
+    if (*cursor) names_seek(&it, sys->usernames.str[*cursor - 1]);
+
+    while (*n < max && (name = names_next(&it))) {
+        uid = intern_find(&sys->usernames, name);
+        *cursor = uid + 1;
+        if (!(count = rank_count(&sys->rank, uid))) continue;
+        out[*n].user = name;
+        out[(*n)++].ninocs = count;
+    }
+
+    if (it.i == it.ni && it.j == it.nj) *cursor = -1;
+    return VMS_OK;
+}
+
+
+/**
+ * @brief Names the file of a table, `<path>-<table>.<ext>`.
+ *
+ * @return The name (to be freed by the caller), or NULL if out of memory.
+ */
+static char *table_file(const char *path, const char *table, int columns) {
+    char *name = (char *) malloc(strlen(path) + strlen(table) + 6);
+
+    if (name) sprintf(name, "%s-%s.%s", path, table, columns ? "col" : "csv");
+    return name;
+}
+
+
+/**
+ * @brief Opens a file to export a table to, with a large write buffer.
+ *
+ * @return The file, or NULL if it could not be opened.
+ */
+static FILE *export_open(const char *path, const char *table, int columns) {
+    char *name = table_file(path, table, columns);
+    FILE *file;
+
+    if (!name) return NULL;
+    file = fopen(name, "wb");
+    free(name);
+    if (file) setvbuf(file, NULL, _IOFBF, EXPBUFMEM);
+    return file;
+}
+
+
+int vms_export(Sys *sys, const char *path, int columns, long *ninocs) {
+    FILE *batches, *inocs;
+    int s, status;
+
+    *ninocs = 0;
+    if (sort_batches(sys->batches, sys->nb)) return VMS_ENOMEMORY;
+    for (s = 0; s < sys->nshards; s++) shard_sync(&sys->shards[s]);
+
+    batches = export_open(path, "batches", columns);
+    inocs = export_open(path, "inocs", columns);
+    if (!batches || !inocs) status = VMS_EFILE;
+    else {
+        status = export_batches(batches, sys->batches, sys->nb, columns);
+        if (!status) status = export_inocs(inocs, sys->shards, sys->nshards,
+                                        columns, ninocs);
+    }
+
+    // Closing writes out the last of the buffers
+    if (batches && fclose(batches) && !status) status = VMS_EFILE;
+    if (inocs && fclose(inocs) && !status) status = VMS_EFILE;
+    return status;
+}
+
+
+/**
+ * @struct ImpRec
+ * @brief An imported inoculation, with its user ID and shard.
+ */
+typedef struct {
+    Inoc inoc;      /**< The record */
+    int uid;        /**< User ID    */
+    int shard;      /**< Shard of the user  */
+} ImpRec;
+
+
+static int compare_imports(const void *a, const void *b) {
+    const ImpRec *x = (const ImpRec *) a, *y = (const ImpRec *) b;
+    int kx = date_key(x->inoc.apdate), ky = date_key(y->inoc.apdate);
+
+    if (x->shard != y->shard)
+        return (x->shard > y->shard) - (x->shard < y->shard);
+    if (kx != ky) return (kx > ky) - (kx < ky);
+    return (x->inoc.seq > y->inoc.seq) - (x->inoc.seq < y->inoc.seq);
+}
+
+
+/**
+ * @brief Adds the batches of an imported file, with the doses it gives
+ * them, reporting the rows rejected.
+ *
+ * @return VMS_OK or VMS_ENOMEMORY.
+ */
+static int import_batches(Sys *sys, ImpTable *table, const char *file,
+                        VmsRejectFn reject, void *ctx, int *n) {
+    Date date, none = {0, 0, 0};
+    int k, av, ap, status;
+    ImpRow *row;
+    Vaccine *vac;
+
+    for (k = 0; k < table->n; k++) {
+        row = &table->rows[k];
+        if (!import_date(row->field[2], &date)) date = none;
+        if (!import_int(row->field[3], &av) ||
+            !import_int(row->field[4], &ap)) av = ap = 0;
+
+        // The batch is checked like by 'c', with all its doses, but it may
+        // have expired already: its records are still imported
+        status = add_batch(sys, row->field[0], date, av + ap,
+                        row->field[1], 1);
+        if (status == VMS_ENOMEMORY) return status;
+        if (status != VMS_OK) {
+            reject(ctx, file, row->line, status, row->field[0]);
+            continue;
+        }
+
+        vac = sys->batches[sys->nb - 1];
+        vac->avdoses = av;
+        vac->apdoses = ap;
+        if (!av) heap_remove(&sys->stock, vac);
+        feed_emit(&sys->feed, FEED_BATCH, date, av, ap, 2, vac->batch, 
+                vac->name);
+        (*n)++;
+    }
+    return VMS_OK;
+}
+
+
+/**
+ * @struct ImpCheck
+ * @brief The checks of an imported inoculation that read nothing the import
+ *          changes, and what they found.
+ */
+typedef struct {
+    Vaccine *vac;       /**< Batch applied (NULL if unknown) */
+    Date date;      /**< Date of application    */
+    int status;     /**< VMS_OK or the first error found */
+} ImpCheck;
+
+
+/**
+ * @struct CheckSlice
+ * @brief The rows of an imported file checked by one thread.
+ */
+typedef struct {
+    Sys *sys;       /**< The system */
+    ImpRow *rows;       /**< Rows of the file   */
+    Vaccine **bybid;        /**< Batches by batch ID    */
+    ImpCheck *chk;      /**< Checks of the rows */
+    long lo, hi;        /**< Rows of the slice  */
+} CheckSlice;
+
+
+/**
+ * @brief Checks an imported inoculation like 'a' would, up to what depends
+ * on the rows before it: the user, batch, vaccine and date.
+ */
+static void check_inoc(Sys *sys, ImpRow *row, Vaccine **bybid,
+                    ImpCheck *chk) {
+    int bid = intern_find(&sys->batchnames, row->field[1]);
+
+    chk->vac = bid == -1 ? NULL : bybid[bid];
+    chk->status = VMS_OK;
+    if (!*row->field[0]) chk->status = VMS_EINVUSER;
+    else if (!chk->vac) chk->status = VMS_ENOBATCH;
+    else if (strcmp(chk->vac->name, row->field[2]))
+        chk->status = VMS_ENOVACINE;
+    else if (!import_date(row->field[3], &chk->date) ||
+            !is_date_valid(sys->date, chk->date, 1))
+        chk->status = VMS_EINVDATE;
+}
+
+
+/**
+ * @brief Thread entry: checks the rows of a slice.
+ */
+static void *check_job(void *arg) {
+    CheckSlice *s = (CheckSlice *) arg;
+    long k;
+
+    for (k = s->lo; k < s->hi; k++)
+        check_inoc(s->sys, &s->rows[k], s->bybid, &s->chk[k]);
+    return NULL;
+}
+
+
+/**
+ * @brief Checks the rows of an imported file, one slice of rows per thread
+ * once there are enough of them.
+ */
+static void check_inocs(Sys *sys, ImpTable *table, Vaccine **bybid,
+                        ImpCheck *chk) {
+    int i, nthr = table->n < IMPCHECKMIN ? 1 : par_threads();
+    CheckSlice slice[PARMAXTHR];
+
+    for (i = 0; i < nthr; i++) {
+        slice[i].sys = sys;
+        slice[i].rows = table->rows;
+        slice[i].bybid = bybid;
+        slice[i].chk = chk;
+        slice[i].lo = table->n * i / nthr;
+        slice[i].hi = table->n * (i + 1) / nthr;
+    }
+    par_run(check_job, slice, sizeof(CheckSlice), nthr);
+}
+
+
+/**
+ * @brief Counts a checked inoculation, as 'a' would, with the sequence
+ * number `seq`.
+ *
+ * @return VMS_OK, VMS_EDOUBLEVAC or VMS_ENOMEMORY.
+ */
+static int import_inoc(Sys *sys, const char *user, ImpCheck *chk, long seq,
+                        ImpRec *rec) {
+    int uid = intern_find(&sys->usernames, user), today;
+    Vaccine *vac = chk->vac;
+
+    // Only one dose of a vaccine per user on the current date; a rejected
+    // row leaves no name behind
+    today = !compare_dates(chk->date, sys->date);
+    if (today && today_has(&sys->today, uid, vac->vid))
+        return VMS_EDOUBLEVAC;
+    if (uid == -1 && (uid = intern_add(&sys->usernames, user)) == -1)
+        return VMS_ENOMEMORY;
+    if (today && today_add(&sys->today, uid, vac->vid)) return VMS_ENOMEMORY;
+
+    if (recall_add(&sys->recall, vac->bid, uid, chk->date, seq) ||
+        stats_add(&sys->stats, vac, chk->date)) return VMS_ENOMEMORY;
+    rank_add(&sys->rank, uid, sys->usernames.str[uid], 1);
+    feed_emit(&sys->feed, FEED_APPLY, chk->date, vac->avdoses, vac->apdoses,
+            3, sys->usernames.str[uid], vac->batch, vac->name);
+
+    rec->inoc.user = sys->usernames.str[uid];
+    rec->inoc.vaccine = vac;
+    rec->inoc.apdate = chk->date;
+    rec->inoc.seq = seq;
+    rec->uid = uid;
+    rec->shard = shard_of(rec->inoc.user, sys->nshards);
+    return VMS_OK;
+}
+
+
+/**
+ * @brief Merges imported inoculations, sorted by shard and date, into the 
+ * months they fall in, and freezes the past months left in the arrays.
+ *
+ * @return VMS_OK or VMS_ENOMEMORY.
+ */
+static int import_merge(Sys *sys, ImpRec *recs, long n) {
+    Inoc *add = (Inoc *) malloc((n ? n : 1) * sizeof(Inoc));
+    int *uids = (int *) malloc((n ? n : 1) * sizeof(int));
+    int s, status = add && uids ? VMS_OK : VMS_ENOMEMORY;
+    long k, from;
+
+    for (k = 0; k < n && status == VMS_OK; k++) {
+        add[k] = recs[k].inoc;
+        uids[k] = recs[k].uid;
+    }
+
+    for (s = 0, k = 0; s < sys->nshards && status == VMS_OK; s++) {
+        for (from = k; k < n && recs[k].shard == s; k++);
+        shard_sync(&sys->shards[s]);
+        if (k > from && shard_merge(&sys->shards[s], add + from,
+                                    uids + from, k - from, sys->is_mapped))
+            status = VMS_ENOMEMORY;
+        else if (k > from)
+            shard_freeze(&sys->shards[s], sys->date, sys->is_mapped);
+    }
+    free(add);
+    free(uids);
+    return status;
+}
+
+
+/**
+ * @brief Adds the inoculations of an imported file, reporting the rows 
+ * rejected.
+ *
+ * @return VMS_OK or VMS_ENOMEMORY.
+ */
+static int import_inocs(Sys *sys, ImpTable *table, const char *file,
+                        VmsRejectFn reject, void *ctx, long *n) {
+    Vaccine **bybid = (Vaccine **) calloc(sys->batchnames.n + 1, 
+                                        sizeof(Vaccine *));
+    ImpRec *recs = (ImpRec *) malloc((table->n ? table->n : 1) * 
+                                    sizeof(ImpRec));
+    ImpCheck *chk = (ImpCheck *) malloc((table->n ? table->n : 1) *
+                                        sizeof(ImpCheck));
+    int i, status = VMS_OK;
+    ImpRow *row;
+    long k;
+
+    // Intern and count the users without growing the tables on the way
+    if (!bybid || !recs || !chk ||
+        intern_reserve(&sys->usernames, table->n) ||
+        rank_reserve(&sys->rank, sys->usernames.n + table->n))
+        status = VMS_ENOMEMORY;
+    for (i = sys->nb - 1; bybid && i >= 0; i--)
+        bybid[sys->batches[i]->bid] = sys->batches[i];
+
+    // The rows are checked in parallel; the users are interned and counted
+    // in the file's order, which decides the doses rejected as doubles
+    if (status == VMS_OK) check_inocs(sys, table, bybid, chk);
+
+    for (k = 0; k < table->n && status == VMS_OK; k++) {
+        row = &table->rows[k];
+
+        // After the records on file of the same date, in the file's order
+        status = chk[k].status;
+        if (status == VMS_OK)
+            status = import_inoc(sys, row->field[0], &chk[k],
+                                sys->seq + *n, &recs[*n]);
+        if (status == VMS_OK) {
+            (*n)++;
+            continue;
+        }
+        if (status != VMS_ENOMEMORY) {
+            reject(ctx, file, row->line, status, status == VMS_ENOVACINE ?
+                    row->field[2] : status == VMS_ENOBATCH ? row->field[1] :
+                    row->field[0]);
+            status = VMS_OK;
+        }
+    }
+
+    sys->seq += *n;
+    if (status == VMS_OK && *n) {
+        qsort(recs, *n, sizeof(ImpRec), compare_imports);
+        status = import_merge(sys, recs, *n);
+    }
+
+    // Past records were added to the batches' lists after newer ones
+    if (recall_sort(&sys->recall)) status = VMS_ENOMEMORY;
+    free(bybid);
+    free(recs);
+    free(chk);
+    return status;
+}
+
+
+int vms_import(Sys *sys, const char *path, VmsRejectFn reject, void *ctx,
+            int *nbatches, long *ninocs) {
+    char *bfile = table_file(path, "batches", 0);
+    char *ifile = table_file(path, "inocs", 0);
+    ImpTable batches = {NULL, NULL, 0}, inocs = {NULL, NULL, 0};
+    int s, status = bfile && ifile ? VMS_OK : VMS_ENOMEMORY;
+
+    *nbatches = 0;
+    *ninocs = 0;
+    for (s = 0; s < sys->nshards; s++)
+        if (worker_failed(&sys->shards[s].worker)) status = VMS_ENOMEMORY;
+    if (worker_failed(&sys->lister)) status = VMS_ENOMEMORY;
+
+    // Both files are read, in parallel chunks, before anything changes
+    if (status == VMS_OK) status = import_read(bfile, 5, &batches);
+    if (status == VMS_OK) status = import_read(ifile, 4, &inocs);
+
+    if (status == VMS_OK)
+        status = import_batches(sys, &batches, bfile, reject, ctx, nbatches);
+    if (status == VMS_OK)
+        status = import_inocs(sys, &inocs, ifile, reject, ctx, ninocs);
+
+    import_free(&batches);
+    import_free(&inocs);
+    free(bfile);
+    free(ifile);
+    return status;
+}
+
+
+/**
+ * @brief Runs the applications of the same vaccine at the start of `ops` 
+ * with one bulk call.
+ *
+ * @return The number of operations run (0 if there was only one, or no 
+ *          memory to group them).
+ */
+static int submit_applies(Sys *sys, VmsOp *ops, int n) {
+    const char **users, **batches;
+    int k, run, *status;
+
+    for (run = 1; run < n && ops[run].kind == VMS_APPLY && 
+        !strcmp(ops[run].name, ops[0].name); run++);
+    if (run == 1) return 0;
+
+    users = (const char **) malloc(run * sizeof(char *));
+    batches = (const char **) malloc(run * sizeof(char *));
+    status = (int *) malloc(run * sizeof(int));
+
+    if (users && batches && status) {
+        for (k = 0; k < run; k++) users[k] = ops[k].user;
+        vms_apply_bulk(sys, ops[0].name, users, run, batches, status);
+
+        for (k = 0; k < run; k++) {
+            ops[k].status = status[k];
+            ops[k].result = 0;
+            ops[k].applied = batches[k];
+        }
+    }
+    else run = 0;
+
+    free(users);
+    free(batches);
+    free(status);
+    return run;
+}
+
+
+int vms_submit(Sys *sys, VmsOp *ops, int n) {
+    VmsOp *op;
+    int i, k, run;
+
+    for (i = 0; i < n; i++) {
+        op = &ops[i];
+
+        // Consecutive applications of a vaccine hand out doses in one pass
+        if (op->kind == VMS_APPLY && (run = submit_applies(sys, op, n - i))) {
+            for (k = 0; k < run; k++)
+                if (op[k].status == VMS_ENOMEMORY) return i + k + 1;
+            i += run - 1;
+            continue;
+        }
+
+        op->result = 0;
+        op->applied = NULL;
+
+        switch (op->kind) {
+            case VMS_BATCH:
+                op->status = vms_add_batch(sys, op->batch, op->date,
+                                        op->doses, op->name);
+                break;
+            case VMS_APPLY:
+                op->status = vms_apply(sys, op->user, op->name, &op->applied);
+                break;
+            case VMS_REMOVE:
+                op->status = vms_remove_batch(sys, op->batch, &op->result);
+                break;
+            case VMS_DELETE:
+                op->status = vms_delete(sys, op->user,
+                                    op->has_date ? &op->date : NULL,
+                                    op->batch, &op->result);
+                break;
+            case VMS_DATE:
+                op->status = vms_set_date(sys, op->date);
+                break;
+        }
+
+        // Stop once memory runs out: later operations would fail too
+        if (op->status == VMS_ENOMEMORY) return i + 1;
+    }
+    return n;
+}
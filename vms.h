@@ -0,0 +1,453 @@
+/**
+ * @file vms.h
+ * @brief Library interface of the Vaccine Management System.
+ *
+ * Programs that embed the system call these functions instead of writing
+ * commands to the text interface. Each call takes typed arguments and
+ * returns a `VmsStatus` (from errors.h) instead of printing a message;
+ * results are written to caller-supplied variables and buffers. Listings
+ * are read in pages, through a cursor, or exported whole to files with
+ * `vms_export`; `vms_import` reads such files back in bulk, and several
+ * changes can be submitted in one call with `vms_submit`.
+ *
+ * A system is used by one thread at a time. Strings returned by the
+ * listings belong to the system and stay valid until it is closed. The
+ * cursors of `vms_list_batches` and `vms_list_inocs` are stable positions
+ * in the listing's order, so a listing can be read a page at a time
+ * between changes (an import numbers the inoculations again, though); the
+ * other cursors stay valid until the next change.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _VMS_H_
+#define _VMS_H_
+
+#include "errors.h"
+#include "system.h"
+#include "date.h"
+
+
+/**
+ * @struct VmsBatch
+ * @brief A vaccine batch, as listed by `vms_list_batches`.
+ */
+typedef struct {
+    const char *name;       /**< Vaccine name   */
+    const char *batch;      /**< Batch ID   */
+    Date expdate;       /**< Expiration date    */
+    int avdoses;        /**< Doses available    */
+    int apdoses;        /**< Doses applied  */
+} VmsBatch;
+
+
+/**
+ * @struct VmsInoc
+ * @brief An inoculation, as listed by `vms_list_inocs` or `vms_recall`.
+ */
+typedef struct {
+    const char *user;       /**< Username   */
+    const char *batch;      /**< Batch ID applied   */
+    const char *vaccine;        /**< Vaccine name   */
+    Date date;      /**< Application date   */
+} VmsInoc;
+
+
+/**
+ * @struct VmsUser
+ * @brief A user, as ranked by `vms_top_users` or listed by `vms_list_users`.
+ */
+typedef struct {
+    const char *user;       /**< Username   */
+    int ninocs;     /**< Inoculations on file   */
+} VmsUser;
+
+
+/**
+ * @brief Kinds of operations accepted by `vms_submit`.
+ */
+typedef enum {
+    VMS_BATCH,      /**< `vms_add_batch`    */
+    VMS_APPLY,      /**< `vms_apply`    */
+    VMS_REMOVE,     /**< `vms_remove_batch` */
+    VMS_DELETE,     /**< `vms_delete`   */
+    VMS_DATE        /**< `vms_set_date` */
+} VmsKind;
+
+
+/**
+ * @struct VmsOp
+ * @brief One operation of a `vms_submit` call, with its inputs and results.
+ */
+typedef struct {
+    VmsKind kind;       /**< Operation to run   */
+    const char *user;       /**< APPLY, DELETE: username    */
+    const char *name;       /**< BATCH, APPLY: vaccine name */
+    const char *batch;      /**< BATCH, REMOVE: batch ID; DELETE: optional  */
+    Date date;      /**< BATCH: expiration; DELETE: filter; DATE: new date  */
+    int has_date;       /**< DELETE: 1 to filter by `date`  */
+    int doses;      /**< BATCH: number of doses */
+
+    int status;     /**< Result: a `VmsStatus`  */
+    int result;     /**< Result: REMOVE doses applied, DELETE records removed */
+    const char *applied;        /**< Result: APPLY batch applied    */
+} VmsOp;
+
+
+/**
+ * @brief Creates an empty system, dated 01-01-2025.
+ *
+ * @param nshards   Number of shards of inoculation records (see `sys_open`).
+ *
+ * @return The new system, or NULL if out of memory.
+ */
+Sys *vms_open(int nshards);
+
+
+/**
+ * @brief Frees a system created by `vms_open`.
+ *
+ * @param sys   The system.
+ */
+void vms_close(Sys *sys);
+
+
+/**
+ * @brief Publishes every later change in a shared-memory ring that other
+ * processes can tail (see feed.h), replacing any feed already open.
+ *
+ * @param sys   The system.
+ * @param name  Name of the shared memory object.
+ *
+ * @return VMS_OK or VMS_EFILE if the ring could not be created.
+ */
+int vms_feed(Sys *sys, const char *name);
+
+
+/**
+ * @brief Adds a vaccine batch (command 'c').
+ *
+ * @param sys       The system.
+ * @param batch     Batch ID: up to 20 uppercase hex digits.
+ * @param expdate   Expiration date.
+ * @param doses     Number of doses.
+ * @param name      Vaccine name.
+ *
+ * @return VMS_OK, VMS_E2MANYVAC, VMS_EDUPBATCH, VMS_EINVBATCH, VMS_EINVNAME,
+ *          VMS_EINVDATE, VMS_EINVQUANT or VMS_ENOMEMORY.
+ */
+int vms_add_batch(Sys *sys, const char *batch, Date expdate, int doses,
+                const char *name);
+
+
+/**
+ * @brief Applies a dose of a vaccine to a user (command 'a'), from the
+ * batch that expires first.
+ *
+ * @param sys       The system.
+ * @param user      Username.
+ * @param vaccine   Vaccine name.
+ * @param batch     Where to store the batch applied (may be NULL).
+ *
+ * @return VMS_OK, VMS_EDOUBLEVAC, VMS_ENOSTOCK or VMS_ENOMEMORY.
+ */
+int vms_apply(Sys *sys, const char *user, const char *vaccine,
+            const char **batch);
+
+
+/**
+ * @brief Applies a dose of a vaccine to each of many users, with the same
+ * results as calling `vms_apply` for each user in order.
+ *
+ * The batches are sorted once and walked once, in expiry order, and the
+ * room for the new records is made before the first dose.
+ *
+ * @param sys       The system.
+ * @param vaccine   Vaccine name.
+ * @param users     Usernames.
+ * @param n         Number of users.
+ * @param batches   Where to store the batch applied to each user (NULL
+ *                  where none was).
+ * @param status    Where to store the status of each user's application.
+ *
+ * @return VMS_OK, or VMS_ENOMEMORY if memory ran out (the users from the
+ *          one that failed on are marked VMS_ENOMEMORY).
+ */
+int vms_apply_bulk(Sys *sys, const char *vaccine, const char **users, int n,
+                const char **batches, int *status);
+
+
+/**
+ * @brief Takes a batch out of use (command 'r'). Batches with doses applied
+ * or inoculations on file are kept with no doses available; the others are
+ * removed.
+ *
+ * @param sys       The system.
+ * @param batch     Batch ID.
+ * @param apdoses   Where to store the doses applied from the batch.
+ *
+ * @return VMS_OK or VMS_ENOBATCH.
+ */
+int vms_remove_batch(Sys *sys, const char *batch, int *apdoses);
+
+
+/**
+ * @brief Deletes a user's inoculations (command 'd'), optionally only those
+ * of a date, or of a date and a batch.
+ *
+ * @param sys       The system.
+ * @param user      Username.
+ * @param date      Date of the records to delete, or NULL for all.
+ * @param batch     Batch of the records to delete, or NULL for all (only
+ *                  used with a date).
+ * @param removed   Where to store the number of records deleted.
+ *
+ * @return VMS_OK, VMS_EINVUSER, VMS_EINVDATE, VMS_ENOBATCH or VMS_ENOMEMORY.
+ */
+int vms_delete(Sys *sys, const char *user, const Date *date,
+            const char *batch, int *removed);
+
+
+/**
+ * @brief Hands a deletion of a user's inoculations (command 'd') to the
+ * worker of the user's shard, which writes the number deleted, or the
+ * error, in place in the output of a pipeline run, as 'd' prints them. The
+ * records removed are accounted for by `vms_settle`.
+ *
+ * @param sys       The system.
+ * @param user      Username.
+ * @param date      Date of the records to delete, or NULL for all.
+ * @param batch     Batch of the records to delete, or NULL for all (only
+ *                  used with a date).
+ *
+ * @return 1 if it was handed off, 0 if it must be run with `vms_delete`
+ *          instead (no worker, no pipeline or a feed open), or -1 if out of
+ *          memory.
+ */
+int vms_delete_defer(Sys *sys, const char *user, const Date *date,
+                    const char *batch);
+
+
+/**
+ * @brief Waits for the deletions handed to the workers and accounts for the
+ * records they removed, so that the dose counters, today's pairs, the
+ * batches' records and the users' counts are up to date.
+ *
+ * @param sys   The system.
+ *
+ * @return VMS_OK, or VMS_ENOMEMORY if a deletion ran out of memory.
+ */
+int vms_settle(Sys *sys);
+
+
+/**
+ * @brief Moves the system date forward (command 't').
+ *
+ * @param sys   The system.
+ * @param date  The new date; it may not be before the current one.
+ *
+ * @return VMS_OK or VMS_EINVDATE.
+ */
+int vms_set_date(Sys *sys, Date date);
+
+
+/**
+ * @brief Gets the system date.
+ *
+ * @param sys   The system.
+ *
+ * @return The current date.
+ */
+Date vms_get_date(Sys *sys);
+
+
+/**
+ * @brief Lists vaccine batches (command 'l'), by expiration date and batch
+ * ID, a page at a time.
+ *
+ * The cursor packs the expiration date and batch ID of the next batch, and
+ * resumes by binary search, after any change.
+ *
+ * @param sys       The system.
+ * @param vaccine   Only list the batches of this vaccine (NULL for all);
+ *                  a name ending in '*' matches every vaccine whose name
+ *                  starts with the rest.
+ * @param exact     1 to take `vaccine` as a name even if it ends in '*'.
+ * @param cursor    Set to 0 for the first page; updated for the next page,
+ *                  or to -1 after the last one.
+ * @param out       Where to store the batches.
+ * @param max       Room in `out`.
+ * @param n         Where to store the number of batches stored.
+ *
+ * @return VMS_OK, VMS_ENOVACINE if there are no batches of `vaccine`,
+ *          VMS_EINVCURSOR or VMS_ENOMEMORY.
+ */
+int vms_list_batches(Sys *sys, const char *vaccine, int exact, long *cursor,
+                    VmsBatch *out, int max, int *n);
+
+
+/**
+ * @brief Lists inoculations (command 'u'), in order of application, a page
+ * at a time.
+ *
+ * The cursor is the place of the next record in the order of application,
+ * its date and sequence number, which keeps its place when records are
+ * added, deleted or imported; it resumes by binary search.
+ *
+ * @param sys       The system.
+ * @param user      Only list the inoculations of this user (NULL for all).
+ * @param cursor    Set to 0 for the first page; updated for the next page,
+ *                  or to -1 after the last one.
+ * @param out       Where to store the inoculations.
+ * @param max       Room in `out`.
+ * @param n         Where to store the number of inoculations stored.
+ *
+ * @return VMS_OK, VMS_EINVUSER if `user` has no inoculations or
+ *          VMS_ENOMEMORY.
+ */
+int vms_list_inocs(Sys *sys, const char *user, long *cursor, VmsInoc *out,
+                int max, int *n);
+
+
+/**
+ * @brief Lists the inoculations of a batch (command 'w'), for a recall, in
+ * order of application, a page at a time. The batch's posting list is read
+ * in O(k), without looking at the other records.
+ *
+ * @param sys       The system.
+ * @param batch     The batch ID.
+ * @param cursor    Set to 0 for the first page; updated for the next page
+ *                  (the place of the next record in the order of
+ *                  application, which stays valid as records are deleted),
+ *                  or to -1 after the last one.
+ * @param out       Where to store the inoculations.
+ * @param max       Room in `out`.
+ * @param n         Where to store the number of inoculations stored.
+ *
+ * @return VMS_OK or VMS_ENOBATCH if there is no such batch.
+ */
+int vms_recall(Sys *sys, const char *batch, long *cursor, VmsInoc *out,
+            int max, int *n);
+
+
+/**
+ * @brief Lists the batches with doses available that expire first (command
+ * 'k'), from a heap kept up to date by 'c', 'a' and 'r', in O(k log k).
+ *
+ * @param sys   The system.
+ * @param k     Number of batches wanted.
+ * @param out   Where to store the batches (room for `k`).
+ * @param n     Where to store the number of batches stored.
+ *
+ * @return VMS_OK, VMS_EINVQUANT if `k` is not positive or VMS_ENOMEMORY.
+ */
+int vms_top_stock(Sys *sys, int k, VmsBatch *out, int *n);
+
+
+/**
+ * @brief Lists the users with the most inoculations on file (command 'k'),
+ * ties by username, from counters kept up to date by 'a' and 'd', in 
+ * O(k log k).
+ *
+ * @param sys   The system.
+ * @param k     Number of users wanted.
+ * @param out   Where to store the users (room for `k`).
+ * @param n     Where to store the number of users stored.
+ *
+ * @return VMS_OK, VMS_EINVQUANT if `k` is not positive or VMS_ENOMEMORY.
+ */
+int vms_top_users(Sys *sys, int k, VmsUser *out, int *n);
+
+
+/**
+ * @brief Lists the users with inoculations on file (command 'n'), in
+ * alphabetical order, a page at a time. The first page is found in
+ * O(log n) from an ordered index of the usernames.
+ *
+ * @param sys       The system.
+ * @param prefix    Only list the users whose name starts with this ("" or
+ *                  NULL for all).
+ * @param cursor    Set to 0 for the first page; updated for the next page
+ *                  (the last name read, which stays valid as users are
+ *                  added), or to -1 after the last one.
+ * @param out       Where to store the users.
+ * @param max       Room in `out`.
+ * @param n         Where to store the number of users stored.
+ *
+ * @return VMS_OK, VMS_EINVCURSOR or VMS_ENOMEMORY.
+ */
+int vms_list_users(Sys *sys, const char *prefix, long *cursor, VmsUser *out,
+                int max, int *n);
+
+
+/**
+ * @brief Exports the batches and the inoculations (command 'e') to the files
+ * `<path>-batches` and `<path>-inocs`, with the extension ".csv" or ".col"
+ * (see export.h).
+ *
+ * @param sys       The system.
+ * @param path      Path and name prefix of the files.
+ * @param columns   1 for the columnar format, 0 for CSV.
+ * @param ninocs    Where to store the number of inoculations exported.
+ *
+ * @return VMS_OK, VMS_EFILE if a file could not be written or
+ *          VMS_ENOMEMORY.
+ */
+int vms_export(Sys *sys, const char *path, int columns, long *ninocs);
+
+
+/**
+ * @brief Reports a row rejected by `vms_import`.
+ *
+ * @param ctx       Context given to `vms_import`.
+ * @param file      Name of the file.
+ * @param line      Line of the row in the file.
+ * @param status    Why the row was rejected (a `VmsStatus`).
+ * @param name      Name the status refers to (user, batch or vaccine).
+ */
+typedef void (*VmsRejectFn)(void *ctx, const char *file, long line,
+                            int status, const char *name);
+
+
+/**
+ * @brief Imports batches and inoculations (command 'm') from the CSV files
+ * `<path>-batches.csv` and `<path>-inocs.csv`, as written by `vms_export`.
+ *
+ * Batches are checked like by `vms_add_batch` and keep the doses of the
+ * file, but may have expired before the current date: they are then added
+ * as expired, with no doses to apply. Inoculations are checked like by
+ * `vms_apply`, except that they may be dated in the past and use no doses;
+ * they are merged with the records already kept in order of date, and every
+ * record is numbered again.
+ * Rejected rows are reported to `reject` and skipped.
+ *
+ * @param sys       The system.
+ * @param path      Path and name prefix of the files.
+ * @param reject    Called for each row rejected.
+ * @param ctx       Passed to `reject`.
+ * @param nbatches  Where to store the number of batches added.
+ * @param ninocs    Where to store the number of inoculations added.
+ *
+ * @return VMS_OK, VMS_EFILE if a file could not be read (then nothing is
+ *          imported) or VMS_ENOMEMORY.
+ */
+int vms_import(Sys *sys, const char *path, VmsRejectFn reject, void *ctx,
+            int *nbatches, long *ninocs);
+
+
+/**
+ * @brief Runs a sequence of changes, in order, storing each one's results
+ * in the operation. Failed operations do not stop the sequence, except when
+ * memory runs out. Consecutive applications of the same vaccine are run
+ * with `vms_apply_bulk`.
+ *
+ * @param sys   The system.
+ * @param ops   The operations.
+ * @param n     Number of operations.
+ *
+ * @return The number of operations run.
+ */
+int vms_submit(Sys *sys, VmsOp *ops, int n);
+
+#endif
@@ -0,0 +1,419 @@
+/**
+ * @file wire.c
+ * @brief Binary protocol for high-rate clients.
+ *
+ * Requests are read in large blocks and answered into one output buffer,
+ * which is written out after each block, so a client that pipelines its
+ * requests costs one `read` and one `write` per block.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "wire.h"
+
+
+/**
+ * @struct WireIn
+ * @brief The fields of a request not read yet.
+ */
+typedef struct {
+    const unsigned char *p;     /**< Next byte  */
+    const unsigned char *end;       /**< End of the request */
+    int bad;        /**< 1 once a field was missing or an ID unknown    */
+} WireIn;
+
+
+/**
+ * @struct WireOut
+ * @brief Responses not written yet.
+ */
+typedef struct {
+    unsigned char *buf;     /**< Encoded responses  */
+    size_t len, cap;        /**< Bytes used and allocated   */
+    int err;        /**< 1 once memory ran out  */
+} WireOut;
+
+
+/**
+ * @struct WireNames
+ * @brief Names given to IDs by the client.
+ */
+typedef struct {
+    char **str;     /**< Name of each ID (NULL if unnamed)  */
+    uint32_t cap;       /**< Number of IDs allocated    */
+} WireNames;
+
+
+/**
+ * @brief Decodes a little-endian u32.
+ */
+static uint32_t le32(const unsigned char *p) {
+
+    return (uint32_t) p[0] | (uint32_t) p[1] << 8 | (uint32_t) p[2] << 16 |
+            (uint32_t) p[3] << 24;
+}
+
+
+static uint32_t get_u32(WireIn *in) {
+    uint32_t v;
+
+    if (in->end - in->p < 4) { in->bad = 1; return 0; }
+    v = le32(in->p);
+    in->p += 4;
+    return v;
+}
+
+
+static int get_u8(WireIn *in) {
+
+    if (in->p == in->end) { in->bad = 1; return 0; }
+    return *in->p++;
+}
+
+
+static Date get_date(WireIn *in) {
+    Date date;
+
+    date.dd = get_u8(in);
+    date.mm = get_u8(in);
+    date.yy = get_u8(in);
+    date.yy |= get_u8(in) << 8;
+    return date;
+}
+
+
+/**
+ * @brief Reads an ID and returns its name.
+ *
+ * @return The name, or NULL (and the request is marked bad) if the ID has
+ *          no name.
+ */
+static const char *get_name(WireIn *in, WireNames *names) {
+    uint32_t id = get_u32(in);
+
+    if (!in->bad && id < names->cap && names->str[id]) return names->str[id];
+    in->bad = 1;
+    return NULL;
+}
+
+
+/**
+ * @brief Makes room for `n` more bytes of output.
+ *
+ * @return 0 on success, -1 if out of memory (then `err` is set).
+ */
+static int out_room(WireOut *out, size_t n) {
+    size_t cap = out->cap ? out->cap : OUTCHUNK;
+    unsigned char *buf;
+
+    if (out->err) return -1;
+    if (out->len + n <= out->cap) return 0;
+
+    while (cap < out->len + n) cap *= 2;
+    buf = (unsigned char *) realloc(out->buf, cap);
+    if (!buf) { out->err = 1; return -1; }
+
+    out->buf = buf;
+    out->cap = cap;
+    return 0;
+}
+
+
+static void put_u8(WireOut *out, int v) {
+
+    if (!out_room(out, 1)) out->buf[out->len++] = (unsigned char) v;
+}
+
+
+static void put_u32(WireOut *out, uint32_t v) {
+
+    if (out_room(out, 4)) return;
+    out->buf[out->len++] = v & 0xFF;
+    out->buf[out->len++] = (v >> 8) & 0xFF;
+    out->buf[out->len++] = (v >> 16) & 0xFF;
+    out->buf[out->len++] = v >> 24;
+}
+
+
+static void put_date(WireOut *out, Date date) {
+
+    put_u8(out, date.dd);
+    put_u8(out, date.mm);
+    put_u8(out, date.yy & 0xFF);
+    put_u8(out, date.yy >> 8);
+}
+
+
+static void put_str(WireOut *out, const char *str) {
+    size_t n = strlen(str);
+
+    if (n > 0xFFFF) n = 0xFFFF;
+    put_u8(out, n & 0xFF);
+    put_u8(out, n >> 8);
+    if (out_room(out, n)) return;
+    memcpy(out->buf + out->len, str, n);
+    out->len += n;
+}
+
+
+/**
+ * @brief Starts a response; its length is filled in by `frame_end`.
+ *
+ * @return Offset of the response's length.
+ */
+static size_t frame_begin(WireOut *out, uint32_t reqid, int status, 
+                        int more) {
+    size_t at = out->len;
+
+    put_u32(out, 0);
+    put_u32(out, reqid);
+    put_u8(out, status);
+    put_u8(out, more);
+    return at;
+}
+
+
+static void frame_end(WireOut *out, size_t at) {
+    uint32_t len = (uint32_t) (out->len - at - 4);
+
+    if (out->err) return;
+    out->buf[at] = len & 0xFF;
+    out->buf[at + 1] = (len >> 8) & 0xFF;
+    out->buf[at + 2] = (len >> 16) & 0xFF;
+    out->buf[at + 3] = len >> 24;
+}
+
+
+/**
+ * @brief Writes out the responses, retrying short writes.
+ */
+static void out_flush(WireOut *out, int fd) {
+    size_t done;
+    ssize_t n;
+
+    for (done = 0; done < out->len; done += n) {
+        n = write(fd, out->buf + done, out->len - done);
+        if (n < 0 && errno == EINTR) n = 0;
+        else if (n < 0) break;      // Output closed: drop the rest
+    }
+    out->len = 0;
+}
+
+
+/**
+ * @brief Names an ID, replacing its previous name.
+ *
+ * @return 0 on success, -1 if out of memory.
+ */
+static int name_set(WireNames *names, uint32_t id, const unsigned char *str,
+                    size_t n) {
+    uint32_t cap = names->cap ? names->cap : 64, i;
+    char **tab, *copy;
+
+    if (id >= names->cap) {
+        while (cap <= id) cap *= 2;
+        tab = (char **) realloc(names->str, cap * sizeof(char *));
+        if (!tab) return -1;
+
+        for (i = names->cap; i < cap; i++) tab[i] = NULL;
+        names->str = tab;
+        names->cap = cap;
+    }
+
+    copy = (char *) malloc(n + 1);
+    if (!copy) return -1;
+    memcpy(copy, str, n);
+    copy[n] = '\0';
+
+    free(names->str[id]);
+    names->str[id] = copy;
+    return 0;
+}
+
+
+/**
+ * @brief Answers the listing requests, a page per response.
+ */
+static void serve_list(Sys *sys, WireOut *out, uint32_t reqid, int op,
+                    const char *filter) {
+    VmsBatch batches[WIRE_PAGE];
+    VmsInoc inocs[WIRE_PAGE];
+    int i, n, status;
+    long cursor = 0;
+    size_t at;
+
+    do {
+        status = op == WIRE_BATCHES ?
+            vms_list_batches(sys, filter, 0, &cursor, batches, WIRE_PAGE,
+                            &n) :
+            vms_list_inocs(sys, filter, &cursor, inocs, WIRE_PAGE, &n);
+
+        at = frame_begin(out, reqid, status, status == VMS_OK && cursor != -1);
+        if (status == VMS_OK) put_u32(out, n);
+
+        for (i = 0; status == VMS_OK && i < n; i++) {
+            if (op == WIRE_BATCHES) {
+                put_str(out, batches[i].name);
+                put_str(out, batches[i].batch);
+                put_date(out, batches[i].expdate);
+                put_u32(out, batches[i].avdoses);
+                put_u32(out, batches[i].apdoses);
+            }
+            else {
+                put_str(out, inocs[i].user);
+                put_str(out, inocs[i].batch);
+                put_str(out, inocs[i].vaccine);
+                put_date(out, inocs[i].date);
+            }
+        }
+        frame_end(out, at);
+    } while (status == VMS_OK && cursor != -1 && !out->err);
+
+    if (status == VMS_ENOMEMORY) out->err = 1;
+}
+
+
+/**
+ * @brief Answers one request.
+ *
+ * @param sys       The system.
+ * @param names     Names of the client's IDs.
+ * @param out       Where to add the response.
+ * @param req       The request, after its length.
+ * @param len       Length of the request.
+ */
+static void serve(Sys *sys, WireNames *names, WireOut *out,
+                const unsigned char *req, size_t len) {
+    WireIn in = {req, req + len, 0};
+    const char *user = NULL, *vac = NULL, *batch = NULL, *filter = NULL;
+    int op, flags, doses, status = VMS_OK, result = 0;
+    uint32_t reqid, id;
+    Date date;
+    size_t at;
+
+    reqid = get_u32(&in);
+    op = get_u8(&in);
+
+    switch (op) {
+        case WIRE_NAME:
+            id = get_u32(&in);
+            if (in.bad || id >= WIRE_MAXID) { in.bad = 1; break; }
+            if (name_set(names, id, in.p, in.end - in.p))
+                status = VMS_ENOMEMORY;
+            break;
+        case WIRE_BATCH:
+            batch = get_name(&in, names);
+            vac = get_name(&in, names);
+            date = get_date(&in);
+            doses = (int) get_u32(&in);
+            if (!in.bad) status = vms_add_batch(sys, batch, date, doses, vac);
+            break;
+        case WIRE_APPLY:
+            user = get_name(&in, names);
+            vac = get_name(&in, names);
+            if (!in.bad) status = vms_apply(sys, user, vac, &batch);
+            break;
+        case WIRE_REMOVE:
+            batch = get_name(&in, names);
+            if (!in.bad) status = vms_remove_batch(sys, batch, &result);
+            break;
+        case WIRE_DELETE:
+            user = get_name(&in, names);
+            flags = get_u8(&in);
+            date = get_date(&in);
+            if (flags & 2) batch = get_name(&in, names);
+            if (!in.bad)
+                status = vms_delete(sys, user, flags & 1 ? &date : NULL,
+                                    batch, &result);
+            break;
+        case WIRE_DATE:
+            flags = get_u8(&in);
+            date = get_date(&in);
+            if (!in.bad && flags) status = vms_set_date(sys, date);
+            break;
+        case WIRE_BATCHES:
+        case WIRE_INOCS:
+            id = get_u32(&in);
+            if (id != WIRE_ALL) {
+                in.p -= 4;
+                filter = get_name(&in, names);
+            }
+            if (!in.bad) { serve_list(sys, out, reqid, op, filter); return; }
+            break;
+        default: in.bad = 1; break;
+    }
+
+    if (in.bad) status = WIRE_EFRAME;
+    if (status == VMS_ENOMEMORY) out->err = 1;
+
+    at = frame_begin(out, reqid, status, 0);
+    if (status == VMS_OK) {
+        if (op == WIRE_APPLY) put_str(out, batch);
+        else if (op == WIRE_REMOVE || op == WIRE_DELETE) put_u32(out, result);
+        else if (op == WIRE_DATE) put_date(out, vms_get_date(sys));
+    }
+    frame_end(out, at);
+}
+
+
+int wire_run(int fd_in, int fd_out, Sys *sys) {
+    size_t size = INBLOCK, have = 0, pos, len;
+    unsigned char *raw = (unsigned char *) malloc(size), *grown;
+    WireNames names = {NULL, 0};
+    WireOut out = {NULL, 0, 0, 0};
+    int ret = raw ? 0 : -1;
+    uint32_t i;
+    ssize_t got;
+
+    while (!ret) {
+        got = read(fd_in, raw + have, size - have);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        have += got;
+
+        // Answer every complete request in the buffer
+        for (pos = 0; have - pos >= 4 && !out.err; pos += 4 + len) {
+            len = le32(raw + pos);
+            if (len > WIRE_MAXFRAME) { ret = -1; break; }
+            if (have - pos - 4 < len) break;
+
+            serve(sys, &names, &out, raw + pos + 4, len);
+            if (out.len >= INBLOCK) out_flush(&out, fd_out);
+        }
+        if (out.err) ret = -1;
+
+        // Keep the incomplete request, making room for all of it
+        memmove(raw, raw + pos, have - pos);
+        have -= pos;
+        if (!ret && have >= 4 && 4 + (size_t) le32(raw) > size) {
+            size = 4 + (size_t) le32(raw);
+            grown = (unsigned char *) realloc(raw, size);
+            if (grown) raw = grown;
+            else ret = -1;
+        }
+
+        out_flush(&out, fd_out);
+    }
+
+    // Tell the client when memory ran out
+    if (out.err) {
+        out.err = 0;
+        out.len = 0;
+        frame_end(&out, frame_begin(&out, 0, VMS_ENOMEMORY, 0));
+        out_flush(&out, fd_out);
+    }
+
+    for (i = 0; i < names.cap; i++) free(names.str[i]);
+    free(names.str);
+    free(out.buf);
+    free(raw);
+    return ret;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file wire.h
+ * @brief Binary protocol for high-rate clients.
+ *
+ * The binary protocol carries the same commands as the text one, run
+ * through the library interface (vms.h). Every request and response is a
+ * frame that starts with its length, so there is no quoting, and clients
+ * may send many requests before reading the responses, which come back in
+ * order and carry the request's ID.
+ *
+ * All integers are little-endian. A string is a u16 length followed by its
+ * bytes; a date is u8 day, u8 month, u16 year. Users, vaccines and batches
+ * are named once with `WIRE_NAME` and then referred to by a u32 ID chosen
+ * by the client.
+ *
+ * Request:  u32 length of the rest, u32 request ID, u8 operation, fields.
+ * Response: u32 length of the rest, u32 request ID, u8 status (`VmsStatus`
+ *           or `WIRE_EFRAME`), u8 1 if more responses to the request follow,
+ *           fields (only when the status is `VMS_OK`).
+ *
+ * | Operation          | Request fields               | Response fields  |
+ * |--------------------|------------------------------|------------------|
+ * | `WIRE_NAME`        | u32 id, the name's bytes     |                  |
+ * | `WIRE_BATCH`       | u32 batch, u32 vaccine,      |                  |
+ * |                    | date, i32 doses              |                  |
+ * | `WIRE_APPLY`       | u32 user, u32 vaccine        | string batch     |
+ * | `WIRE_REMOVE`      | u32 batch                    | i32 doses applied|
+ * | `WIRE_DELETE`      | u32 user, u8 flags (1 date,  | i32 removed      |
+ * |                    | 2 batch), date, u32 batch    |                  |
+ * | `WIRE_DATE`        | u8 1 to set, date            | date             |
+ * | `WIRE_BATCHES`     | u32 vaccine or `WIRE_ALL`    | u32 n, n x (name,|
+ * |                    |                              | batch, expiration|
+ * |                    |                              | i32 av., i32 ap.)|
+ * | `WIRE_INOCS`       | u32 user or `WIRE_ALL`       | u32 n, n x (user,|
+ * |                    |                              | batch, vaccine,  |
+ * |                    |                              | date)            |
+ *
+ * Listings are split over several responses, all but the last marked as
+ * having more to follow.
+ *
+ * @author ist1114493 (Tomás Gomes)
+ * @date 2025
+ */
+
+#ifndef _WIRE_H_
+#define _WIRE_H_
+
+#include "vms.h"
+
+#define WIRE_NAME       'n'     /**< name an ID */
+#define WIRE_BATCH      'c'     /**< add a batch    */
+#define WIRE_APPLY      'a'     /**< apply a vaccine    */
+#define WIRE_REMOVE     'r'     /**< remove a batch */
+#define WIRE_DELETE     'd'     /**< delete inoculations    */
+#define WIRE_DATE       't'     /**< get or set the date    */
+#define WIRE_BATCHES    'l'     /**< list batches   */
+#define WIRE_INOCS      'u'     /**< list inoculations  */
+
+#define WIRE_ALL        0xFFFFFFFFu     /**< no filter, in listings */
+#define WIRE_EFRAME     0xFF        /**< malformed request or unknown ID    */
+#define WIRE_MAXID      (1 << 24)       /**< max. ID of a name  */
+#define WIRE_MAXFRAME   (1 << 20)       /**< max. length of a request   */
+#define WIRE_PAGE       256     /**< entries per listing response   */
+
+
+/**
+ * @brief Serves binary requests until the end of the input.
+ *
+ * @param fd_in     Input file descriptor.
+ * @param fd_out    Output file descriptor.
+ * @param sys       The system.
+ *
+ * @return 0 at the end of the input, -1 if a request was too long or memory
+ *          ran out (after answering `VMS_ENOMEMORY`).
+ */
+int wire_run(int fd_in, int fd_out, Sys *sys);
+
+#endif